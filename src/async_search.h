@@ -0,0 +1,131 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <utility>
+
+#include "search_executor.h"
+
+// Thrown when a search request is cancelled through its stop_token
+class OperationCancelled : public std::runtime_error {
+public:
+    OperationCancelled():
+        std::runtime_error{"Search request was cancelled"}
+    {
+    }
+};
+
+inline void ThrowIfStopRequested(const std::stop_token& stop_token)
+{
+    if (stop_token.stop_requested()) {
+        throw OperationCancelled{};
+    }
+}
+
+// Awaitable returned by the SearchServer::*Async methods. The job runs on
+// the executor and the awaiting coroutine is resumed on the executor thread
+// once the result (or the exception) is ready.
+template <typename Result>
+class SearchAwaitable {
+public:
+    using Job = std::function<Result(const std::stop_token&)>;
+
+    SearchAwaitable(SearchExecutor& executor, Job job,
+                    std::stop_token stop_token);
+
+    SearchAwaitable(const SearchAwaitable&) = delete;
+    SearchAwaitable& operator=(const SearchAwaitable&) = delete;
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> awaiting);
+    Result await_resume();
+
+private:
+    SearchExecutor& executor_;
+    Job job_;
+    std::stop_token stop_token_;
+    std::optional<Result> result_;
+    std::exception_ptr exception_;
+};
+
+template <typename Result>
+SearchAwaitable<Result>::SearchAwaitable(SearchExecutor& executor,
+                                         Job job,
+                                         std::stop_token stop_token):
+    executor_{executor},
+    job_{std::move(job)},
+    stop_token_{std::move(stop_token)}
+{
+}
+
+template <typename Result>
+bool SearchAwaitable<Result>::await_ready() const noexcept
+{
+    return false;
+}
+
+template <typename Result>
+void SearchAwaitable<Result>::await_suspend(std::coroutine_handle<> awaiting)
+{
+    executor_.Post([this, awaiting]{
+        try {
+            ThrowIfStopRequested(stop_token_);
+            result_.emplace(job_(stop_token_));
+        } catch (...) {
+            exception_ = std::current_exception();
+        }
+        // the awaitable may be destroyed by the resumed coroutine,
+        // so nothing must touch it after this point
+        awaiting.resume();
+    });
+}
+
+template <typename Result>
+Result SearchAwaitable<Result>::await_resume()
+{
+    if (exception_) {
+        std::rethrow_exception(exception_);
+    }
+    return std::move(*result_);
+}
+
+namespace async_search_detail {
+
+struct SyncWaitTask {
+    struct promise_type {
+        SyncWaitTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+template <typename Awaitable, typename Result>
+SyncWaitTask AwaitInto(Awaitable& awaitable, std::promise<Result>& promise)
+{
+    try {
+        promise.set_value(co_await awaitable);
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+} // namespace async_search_detail
+
+// Blocks the calling thread until the awaitable completes. Intended for
+// callers that are not coroutines themselves.
+template <typename Awaitable>
+auto SyncWait(Awaitable&& awaitable)
+{
+    using Result = decltype(awaitable.await_resume());
+    std::promise<Result> promise;
+    auto future = promise.get_future();
+    async_search_detail::AwaitInto(awaitable, promise);
+    return future.get();
+}
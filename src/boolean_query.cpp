@@ -0,0 +1,319 @@
+#include <optional>
+
+#include "boolean_query.h"
+
+using namespace std;
+
+namespace {
+
+enum class Occur {
+    // decided by the sequence
+    UNMARKED,
+    REQUIRED,
+    OPTIONAL,
+    EXCLUDED,
+};
+
+struct Clause {
+    BooleanQueryNode node;
+    Occur occur;
+};
+
+bool IsParenthesis(char c)
+{
+    return c == '(' || c == ')';
+}
+
+bool IsOperator(string_view token)
+{
+    return token == "AND"sv || token == "OR"sv || token == "NOT"sv;
+}
+
+// Words split by spaces, a parenthesis is a token of its own
+template <typename TokenHandler>
+void ForEachToken(string_view text, TokenHandler handle_token)
+{
+    size_t begin = 0;
+    while (begin < text.size()) {
+        if (text[begin] == ' ') {
+            ++begin;
+            continue;
+        }
+        size_t end = begin + 1;
+        if (!IsParenthesis(text[begin])) {
+            while (end < text.size() && text[end] != ' '
+                   && !IsParenthesis(text[end])) {
+                ++end;
+            }
+        }
+        if (!handle_token(text.substr(begin, end - begin))) {
+            return;
+        }
+        begin = end;
+    }
+}
+
+class Parser {
+public:
+    Parser(vector<string_view> tokens, bool words_required):
+        tokens_{move(tokens)},
+        words_required_{words_required}
+    {
+    }
+
+    Expected<BooleanQueryNode> Parse(string_view& invalid_token) {
+        optional<BooleanQueryNode> query = ParseQuery();
+        if (query && position_ != tokens_.size()) {
+            // a parenthesis without a pair
+            Fail(SearchError::INVALID_QUERY);
+        }
+        if (error_) {
+            invalid_token = invalid_token_;
+            return *error_;
+        }
+        return move(*query);
+    }
+
+private:
+    vector<string_view> tokens_;
+    bool words_required_;
+    size_t position_{0};
+    // of the parentheses around the position
+    size_t depth_{0};
+    optional<SearchError> error_;
+    string_view invalid_token_;
+
+    bool IsAtEnd() const {
+        return position_ == tokens_.size();
+    }
+
+    bool IsAt(string_view token) const {
+        return !IsAtEnd() && tokens_[position_] == token;
+    }
+
+    // at the token at fault, or at the last one when the tokens ended
+    void Fail(SearchError error) {
+        if (!error_) {
+            error_ = error;
+            invalid_token_ = tokens_.empty()
+                    ? string_view{}
+                    : tokens_[min(position_, tokens_.size() - 1)];
+        }
+    }
+
+    optional<BooleanQueryNode> ParseQuery() {
+        BooleanQueryNode query;
+        do {
+            if (!query.optional.empty()) {
+                ++position_;
+            }
+            optional<BooleanQueryNode> sequence = ParseSequence();
+            if (!sequence) {
+                return nullopt;
+            }
+            query.optional.push_back(move(*sequence));
+        } while (IsAt("OR"sv));
+        if (query.optional.size() == 1) {
+            return move(query.optional.front());
+        }
+        return query;
+    }
+
+    optional<BooleanQueryNode> ParseSequence() {
+        vector<Clause> clauses;
+        while (!IsAtEnd() && !IsAt(")"sv) && !IsAt("OR"sv)) {
+            optional<Clause> clause = ParseConjunction();
+            if (!clause) {
+                return nullopt;
+            }
+            clauses.push_back(move(*clause));
+        }
+        if (clauses.empty()) {
+            Fail(SearchError::INVALID_QUERY);
+            return nullopt;
+        }
+        if (clauses.size() == 1 && clauses.front().occur != Occur::EXCLUDED) {
+            return move(clauses.front().node);
+        }
+        BooleanQueryNode sequence;
+        for (Clause& clause : clauses) {
+            if (clause.occur == Occur::UNMARKED) {
+                clause.occur = words_required_ ? Occur::REQUIRED : Occur::OPTIONAL;
+            }
+            AddClause(sequence, move(clause));
+        }
+        return sequence;
+    }
+
+    optional<Clause> ParseConjunction() {
+        optional<Clause> first = ParseClause();
+        if (!first || !IsAt("AND"sv)) {
+            return first;
+        }
+        // every operand of AND is required
+        const auto add_operand = [](BooleanQueryNode& group, Clause clause) {
+            if (clause.occur != Occur::EXCLUDED) {
+                clause.occur = Occur::REQUIRED;
+            }
+            AddClause(group, move(clause));
+        };
+        Clause conjunction{BooleanQueryNode{}, Occur::UNMARKED};
+        add_operand(conjunction.node, move(*first));
+        while (IsAt("AND"sv)) {
+            ++position_;
+            optional<Clause> clause = ParseClause();
+            if (!clause) {
+                return nullopt;
+            }
+            add_operand(conjunction.node, move(*clause));
+        }
+        return conjunction;
+    }
+
+    optional<Clause> ParseClause() {
+        if (IsAt("NOT"sv)) {
+            ++position_;
+            // a clause can be excluded once, NOT NOT fails before going deeper
+            const size_t operand = position_;
+            if (IsAt("NOT"sv)) {
+                Fail(SearchError::INVALID_QUERY);
+                return nullopt;
+            }
+            optional<Clause> clause = ParseClause();
+            if (!clause) {
+                return nullopt;
+            }
+            if (clause->occur == Occur::EXCLUDED) {
+                position_ = operand;
+                Fail(SearchError::INVALID_QUERY);
+                return nullopt;
+            }
+            clause->occur = Occur::EXCLUDED;
+            return clause;
+        }
+        if (IsAtEnd()) {
+            Fail(SearchError::INVALID_QUERY);
+            return nullopt;
+        }
+
+        const string_view token = tokens_[position_];
+        if (token[0] != '+' && token[0] != '-') {
+            optional<BooleanQueryNode> primary = ParsePrimary();
+            if (!primary) {
+                return nullopt;
+            }
+            return Clause{move(*primary), Occur::UNMARKED};
+        }
+        const Occur occur = token[0] == '+' ? Occur::REQUIRED : Occur::EXCLUDED;
+        const SearchError error = token[0] == '+' ? SearchError::INVALID_QUERY
+                                                  : SearchError::INVALID_MINUS_WORD;
+        const string_view word = token.substr(1);
+        if (word.empty()) {
+            // +( and -( mark a group
+            ++position_;
+            if (!IsAt("("sv)) {
+                --position_;
+                Fail(error);
+                return nullopt;
+            }
+            optional<BooleanQueryNode> primary = ParsePrimary();
+            if (!primary) {
+                return nullopt;
+            }
+            return Clause{move(*primary), occur};
+        }
+        if (word[0] == '+' || word[0] == '-') {
+            Fail(error);
+            return nullopt;
+        }
+        if (word.find('"') != word.npos) {
+            Fail(SearchError::INVALID_QUERY);
+            return nullopt;
+        }
+        ++position_;
+        return Clause{BooleanQueryNode{word, {}, {}, {}}, occur};
+    }
+
+    optional<BooleanQueryNode> ParsePrimary() {
+        const string_view token = tokens_[position_];
+        if (token == "("sv) {
+            if (depth_ == MAX_BOOLEAN_QUERY_DEPTH) {
+                Fail(SearchError::INVALID_QUERY);
+                return nullopt;
+            }
+            ++position_;
+            ++depth_;
+            optional<BooleanQueryNode> query = ParseQuery();
+            --depth_;
+            if (!query) {
+                return nullopt;
+            }
+            if (!IsAt(")"sv)) {
+                Fail(SearchError::INVALID_QUERY);
+                return nullopt;
+            }
+            ++position_;
+            return query;
+        }
+        // phrases are not a part of the boolean syntax
+        if (token == ")"sv || IsOperator(token) || token.find('"') != token.npos) {
+            Fail(SearchError::INVALID_QUERY);
+            return nullopt;
+        }
+        ++position_;
+        return BooleanQueryNode{token, {}, {}, {}};
+    }
+
+    // A required group of excluded clauses only, as (NOT a), excludes
+    // them from the group it is in instead of matching nothing
+    static void AddClause(BooleanQueryNode& group, Clause clause) {
+        const bool is_negation = !clause.node.IsWord() 
+                && clause.node.required.empty() && clause.node.optional.empty();
+        if (clause.occur == Occur::REQUIRED && is_negation) {
+            for (BooleanQueryNode& node : clause.node.excluded) {
+                group.excluded.push_back(move(node));
+            }
+            return;
+        }
+        switch (clause.occur) {
+        case Occur::REQUIRED:
+            group.required.push_back(move(clause.node));
+            break;
+        case Occur::EXCLUDED:
+            group.excluded.push_back(move(clause.node));
+            break;
+        default:
+            group.optional.push_back(move(clause.node));
+        }
+    }
+};
+
+} // namespace
+
+bool BooleanQueryNode::IsWord() const
+{
+    return !word.empty();
+}
+
+bool IsBooleanQuery(string_view text)
+{
+    bool is_boolean = false;
+    ForEachToken(text, [&is_boolean](string_view token) {
+        is_boolean = IsParenthesis(token[0]) || token[0] == '+' 
+                || IsOperator(token);
+        return !is_boolean;
+    });
+    return is_boolean;
+}
+
+Expected<BooleanQueryNode> ParseBooleanQuery(string_view text,
+                                             bool words_required,
+                                             string_view& invalid_token)
+{
+    vector<string_view> tokens;
+    ForEachToken(text, [&tokens](string_view token) {
+        tokens.push_back(token);
+        return true;
+    });
+    return Parser{move(tokens), words_required}.Parse(invalid_token);
+}
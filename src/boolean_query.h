@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "search_error.h"
+
+// A word or a group of clauses of a boolean query. A group matches
+// the documents which match all its required clauses and none of its
+// excluded ones, and at least one optional clause when it has no required
+// ones; the optional clauses of a group with required ones add relevance
+// only. A group without required and optional clauses matches nothing.
+struct BooleanQueryNode {
+    // the word as written, without + or -, may end with '*';
+    // empty for a group
+    std::string_view word;
+    std::vector<BooleanQueryNode> required;
+    std::vector<BooleanQueryNode> optional;
+    std::vector<BooleanQueryNode> excluded;
+
+    bool IsWord() const;
+};
+
+// Deepest nesting of parentheses a boolean query may have; the parser,
+// the compiled query and the destruction of the nodes recurse by it
+constexpr size_t MAX_BOOLEAN_QUERY_DEPTH = 128;
+
+// True when the text uses the boolean syntax: parentheses, the AND, OR
+// or NOT operator or a word with a leading '+'
+bool IsBooleanQuery(std::string_view text);
+
+// Parses by the grammar, from the lowest precedence:
+//   query       := sequence {OR sequence}
+//   sequence    := conjunction {conjunction}
+//   conjunction := clause {AND clause}
+//   clause      := NOT clause | +primary | -primary | primary
+//   primary     := word | ( query )
+// Parentheses need no spaces around them. The unmarked clauses of
+// a sequence are optional, or required when words_required is set, so
+// a plain query "a b -c" means what it means without the boolean syntax.
+// A required group of excluded clauses, as in "a AND (NOT b)", excludes
+// them from the enclosing group.
+// A query nested deeper than MAX_BOOLEAN_QUERY_DEPTH is invalid.
+// On error invalid_token is the token at fault; the words are validated
+// by the server.
+Expected<BooleanQueryNode> ParseBooleanQuery(std::string_view text,
+                                             bool words_required,
+                                             std::string_view& invalid_token);
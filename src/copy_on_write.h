@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+// A structure shared by the copies of its owner until one of them changes
+// it: GetMutable copies the structure into the resource it allocates from
+// when another copy still holds it. T is a pmr container or a class with
+// get_allocator() and a (const T&, std::pmr::memory_resource*) copy.
+// The object itself lives on the global heap, only its contents
+// allocate from the resource.
+template <typename T>
+class CopyOnWrite {
+public:
+    explicit CopyOnWrite(std::pmr::memory_resource* resource);
+    // a copy of value allocated from the resource, shared with nothing
+    CopyOnWrite(const T& value, std::pmr::memory_resource* resource);
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    // Must not race with the copies of this object sharing the structure
+    // being made, reads of other copies may go on
+    T& GetMutable();
+
+private:
+    std::shared_ptr<T> value_;
+};
+
+// A value of a pmr container shared the same way. The value and its
+// control block allocate from the allocator of the container, so they
+// count as memory of the container. Copies made by the container share
+// the value, whatever the allocator: the resource it was created with
+// must outlive every container holding it.
+template <typename T>
+class CopyOnWriteValue {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    explicit CopyOnWriteValue(const allocator_type& allocator);
+    CopyOnWriteValue(const CopyOnWriteValue& other, const allocator_type& allocator);
+    CopyOnWriteValue(CopyOnWriteValue&& other, const allocator_type& allocator);
+    // a copy of value allocated by the allocator, shared with nothing
+    CopyOnWriteValue(const T& value, const allocator_type& allocator);
+
+    const T& operator*() const;
+    const T* operator->() const;
+
+    T& GetMutable();
+
+private:
+    std::shared_ptr<T> value_;
+};
+
+
+
+template <typename T>
+CopyOnWrite<T>::CopyOnWrite(std::pmr::memory_resource* resource):
+    value_{std::make_shared<T>(resource)}
+{
+}
+
+template <typename T>
+CopyOnWrite<T>::CopyOnWrite(const T& value, std::pmr::memory_resource* resource):
+    value_{std::make_shared<T>(value, resource)}
+{
+}
+
+template <typename T>
+const T& CopyOnWrite<T>::operator*() const
+{
+    return *value_;
+}
+
+template <typename T>
+const T* CopyOnWrite<T>::operator->() const
+{
+    return value_.get();
+}
+
+template <typename T>
+T& CopyOnWrite<T>::GetMutable()
+{
+    if (value_.use_count() > 1) {
+        value_ = std::make_shared<T>(*value_, value_->get_allocator().resource());
+    } else {
+        // the last copy which dropped the structure may have read it
+        // on another thread
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *value_;
+}
+
+template <typename T>
+CopyOnWriteValue<T>::CopyOnWriteValue(const allocator_type& allocator):
+    value_{std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(allocator))}
+{
+}
+
+template <typename T>
+CopyOnWriteValue<T>::CopyOnWriteValue(const CopyOnWriteValue& other,
+                                      const allocator_type& ):
+    value_{other.value_}
+{
+}
+
+template <typename T>
+CopyOnWriteValue<T>::CopyOnWriteValue(CopyOnWriteValue&& other,
+                                      const allocator_type& ):
+    value_{std::move(other.value_)}
+{
+}
+
+template <typename T>
+CopyOnWriteValue<T>::CopyOnWriteValue(const T& value,
+                                      const allocator_type& allocator):
+    value_{std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(allocator),
+                                   value)}
+{
+}
+
+template <typename T>
+const T& CopyOnWriteValue<T>::operator*() const
+{
+    return *value_;
+}
+
+template <typename T>
+const T* CopyOnWriteValue<T>::operator->() const
+{
+    return value_.get();
+}
+
+template <typename T>
+T& CopyOnWriteValue<T>::GetMutable()
+{
+    if (value_.use_count() > 1) {
+        value_ = std::allocate_shared<T>(
+                    std::pmr::polymorphic_allocator<T>(value_->get_allocator()),
+                    *value_);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *value_;
+}
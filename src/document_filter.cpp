@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "document_filter.h"
+#include "simd.h"
+
+using namespace std;
+
+namespace {
+
+// none for the status of the removed rows
+uint32_t StatusBit(int status)
+{
+    return static_cast<uint32_t>(status) < 32 ? 1u << status : 0u;
+}
+
+#ifdef SEARCH_SERVER_AVX2
+
+// Eight rows per step, returns the number of rows done
+__attribute__((target("avx2")))
+size_t EvaluateAvx2(const DocumentFilter& filter, const int* ids,
+                    const int* ratings, const int* statuses,
+                    size_t row_count, uint64_t* bitmap)
+{
+    const __m256i min_id = _mm256_set1_epi32(filter.min_id);
+    const __m256i max_id = _mm256_set1_epi32(filter.max_id);
+    const __m256i min_rating = _mm256_set1_epi32(filter.min_rating);
+    const __m256i max_rating = _mm256_set1_epi32(filter.max_rating);
+    const __m256i status_mask = _mm256_set1_epi32(
+                static_cast<int>(filter.statuses));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t row = 0;
+    for (; row + 8 <= row_count; row += 8) {
+        const __m256i id = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(ids + row));
+        const __m256i rating = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(ratings + row));
+        const __m256i status = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(statuses + row));
+
+        __m256i rejected = _mm256_or_si256(_mm256_cmpgt_epi32(min_id, id),
+                                           _mm256_cmpgt_epi32(id, max_id));
+        rejected = _mm256_or_si256(rejected,
+                                   _mm256_cmpgt_epi32(min_rating, rating));
+        rejected = _mm256_or_si256(rejected,
+                                   _mm256_cmpgt_epi32(rating, max_rating));
+        const __m256i status_bit = _mm256_sllv_epi32(one, status);
+        rejected = _mm256_or_si256(rejected, _mm256_cmpeq_epi32(
+                        _mm256_and_si256(status_bit, status_mask), zero));
+
+        const uint64_t passed = ~static_cast<uint64_t>(_mm256_movemask_ps(
+                    _mm256_castsi256_ps(rejected))) & 0xff;
+        bitmap[row / 64] |= passed << (row % 64);
+    }
+    return row;
+}
+
+#endif
+
+} // namespace
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status,
+                                int rating) const
+{
+    return document_id >= min_id && document_id <= max_id
+            && rating >= min_rating && rating <= max_rating
+            && (statuses & StatusBit(static_cast<int>(status))) != 0
+            && (ids.empty() || binary_search(ids.begin(), ids.end(), document_id));
+}
+
+uint32_t StatusMask(initializer_list<DocumentStatus> statuses)
+{
+    uint32_t mask = 0;
+    for (const DocumentStatus status : statuses) {
+        mask |= StatusBit(static_cast<int>(status));
+    }
+    return mask;
+}
+
+DocumentColumns::DocumentColumns(pmr::memory_resource* resource):
+    ids_{resource},
+    ratings_{resource},
+    statuses_{resource},
+    word_counts_{resource}
+{
+}
+
+DocumentColumns::DocumentColumns(const DocumentColumns& other,
+                                 pmr::memory_resource* resource):
+    ids_{other.ids_, resource},
+    ratings_{other.ratings_, resource},
+    statuses_{other.statuses_, resource},
+    word_counts_{other.word_counts_, resource},
+    removed_row_count_{other.removed_row_count_}
+{
+}
+
+pmr::polymorphic_allocator<byte> DocumentColumns::get_allocator() const
+{
+    return ids_.get_allocator();
+}
+
+void DocumentColumns::Add(int document_id, DocumentStatus status, int rating,
+                          int word_count)
+{
+    const size_t row = ids_.empty() || ids_.back() < document_id
+            ? ids_.size()
+            : lower_bound(ids_.begin(), ids_.end(), document_id) - ids_.begin();
+    if (row < ids_.size() && ids_[row] == document_id) {
+        // the row of a removed document is taken again
+        ratings_[row] = rating;
+        statuses_[row] = static_cast<int>(status);
+        word_counts_[row] = word_count;
+        --removed_row_count_;
+        return;
+    }
+    ids_.insert(ids_.begin() + row, document_id);
+    ratings_.insert(ratings_.begin() + row, rating);
+    statuses_.insert(statuses_.begin() + row, static_cast<int>(status));
+    word_counts_.insert(word_counts_.begin() + row, word_count);
+}
+
+void DocumentColumns::Remove(int document_id)
+{
+    const size_t row = FindRow(document_id);
+    if (row == ids_.size() || ids_[row] != document_id) {
+        return;
+    }
+    statuses_[row] = REMOVED_ROW_STATUS;
+    ++removed_row_count_;
+    if (removed_row_count_ * COMPACTION_RATIO > ids_.size()) {
+        Compact();
+    }
+}
+
+void DocumentColumns::Compact()
+{
+    size_t live_row = 0;
+    for (size_t row = 0; row < ids_.size(); ++row) {
+        if (statuses_[row] == REMOVED_ROW_STATUS) {
+            continue;
+        }
+        ids_[live_row] = ids_[row];
+        ratings_[live_row] = ratings_[row];
+        statuses_[live_row] = statuses_[row];
+        word_counts_[live_row] = word_counts_[row];
+        ++live_row;
+    }
+    ids_.resize(live_row);
+    ratings_.resize(live_row);
+    statuses_.resize(live_row);
+    word_counts_.resize(live_row);
+    removed_row_count_ = 0;
+    // the columns of an empty index hold no memory, as the maps
+    if (ids_.empty()) {
+        decltype(ids_){ids_.get_allocator()}.swap(ids_);
+        decltype(ratings_){ratings_.get_allocator()}.swap(ratings_);
+        decltype(statuses_){statuses_.get_allocator()}.swap(statuses_);
+        decltype(word_counts_){word_counts_.get_allocator()}.swap(word_counts_);
+    }
+}
+
+void DocumentColumns::SetStatus(int document_id, DocumentStatus status)
+{
+    const size_t row = FindRow(document_id);
+    if (row == ids_.size() || ids_[row] != document_id) {
+        throw out_of_range{"Document id in not exsist: " + to_string(document_id)};
+    }
+    statuses_[row] = static_cast<int>(status);
+}
+
+size_t DocumentColumns::GetRowCount() const
+{
+    return ids_.size();
+}
+
+const pmr::vector<int>& DocumentColumns::GetIds() const
+{
+    return ids_;
+}
+
+const pmr::vector<int>& DocumentColumns::GetRatings() const
+{
+    return ratings_;
+}
+
+const pmr::vector<int>& DocumentColumns::GetStatuses() const
+{
+    return statuses_;
+}
+
+const pmr::vector<int>& DocumentColumns::GetWordCounts() const
+{
+    return word_counts_;
+}
+
+size_t DocumentColumns::FindRow(int document_id, size_t first_row) const
+{
+    size_t step = 1;
+    size_t last_row = first_row;
+    while (last_row < ids_.size() && ids_[last_row] < document_id) {
+        first_row = last_row + 1;
+        last_row += step;
+        step *= 2;
+    }
+    last_row = min(last_row, ids_.size());
+    size_t row = lower_bound(ids_.begin() + first_row, ids_.begin() + last_row,
+                             document_id) - ids_.begin();
+    while (row < ids_.size() && statuses_[row] == REMOVED_ROW_STATUS) {
+        ++row;
+    }
+    return row;
+}
+
+void DocumentColumns::Evaluate(const DocumentFilter& filter,
+                               vector<uint64_t>& bitmap) const
+{
+    bitmap.assign((ids_.size() + 63) / 64, 0);
+    size_t row = 0;
+#ifdef SEARCH_SERVER_AVX2
+    if (HasAvx2()) {
+        row = EvaluateAvx2(filter, ids_.data(), ratings_.data(),
+                           statuses_.data(), ids_.size(), bitmap.data());
+    }
+#endif
+    EvaluateScalar(filter, row, bitmap.data());
+
+    if (filter.ids.empty()) {
+        return;
+    }
+    // both the id column and the ids of the filter are ascending
+    auto id = filter.ids.begin();
+    for (row = 0; row < ids_.size(); ++row) {
+        while (id != filter.ids.end() && *id < ids_[row]) {
+            ++id;
+        }
+        if (id == filter.ids.end() || *id != ids_[row]) {
+            bitmap[row / 64] &= ~(uint64_t{1} << (row % 64));
+        }
+    }
+}
+
+void DocumentColumns::EvaluateScalar(const DocumentFilter& filter,
+                                     size_t first_row, uint64_t* bitmap) const
+{
+    for (size_t row = first_row; row < ids_.size(); ++row) {
+        const bool passed = ids_[row] >= filter.min_id
+                && ids_[row] <= filter.max_id
+                && ratings_[row] >= filter.min_rating
+                && ratings_[row] <= filter.max_rating
+                && (filter.statuses & StatusBit(statuses_[row])) != 0;
+        bitmap[row / 64] |= uint64_t{passed} << (row % 64);
+    }
+}
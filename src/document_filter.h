@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+#include "document.h"
+
+// Structured document predicate: inclusive ranges of ids and ratings, a set
+// of statuses and an optional set of ids. It can be passed wherever a
+// DocumentPredicate is expected; the sequential FindTopDocuments evaluates
+// it over the attribute columns for all documents at once instead of
+// calling it per posting.
+struct DocumentFilter {
+    int min_id{std::numeric_limits<int>::min()};
+    int max_id{std::numeric_limits<int>::max()};
+    int min_rating{std::numeric_limits<int>::min()};
+    int max_rating{std::numeric_limits<int>::max()};
+    // a bit per accepted status, see StatusMask
+    uint32_t statuses{~0u};
+    // when not empty, only these ids; must be ascending
+    std::vector<int> ids{};
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const;
+};
+
+uint32_t StatusMask(std::initializer_list<DocumentStatus> statuses);
+
+// Attributes of the documents as columns in ascending order of ids,
+// the row of a document is its index in the id column. A removed document
+// leaves its row behind with a status no filter accepts, the columns are
+// compacted once such rows make up more than a quarter of them.
+class DocumentColumns {
+public:
+    explicit DocumentColumns(std::pmr::memory_resource* resource);
+    DocumentColumns(const DocumentColumns& other,
+                    std::pmr::memory_resource* resource);
+
+    DocumentColumns& operator=(const DocumentColumns&) = delete;
+
+    std::pmr::polymorphic_allocator<std::byte> get_allocator() const;
+
+    // Appending is O(1), an id lower than the last one shifts the rows
+    // unless it takes the row it had before a removal
+    void Add(int document_id, DocumentStatus status, int rating, int word_count);
+    // O(1) amortised
+    void Remove(int document_id);
+    void SetStatus(int document_id, DocumentStatus status);
+
+    // The removed rows included
+    size_t GetRowCount() const;
+    const std::pmr::vector<int>& GetIds() const;
+    const std::pmr::vector<int>& GetRatings() const;
+    const std::pmr::vector<int>& GetStatuses() const;
+    const std::pmr::vector<int>& GetWordCounts() const;
+
+    // The row of the lowest id not less than document_id which is not
+    // removed, searched onwards from the row first_row with galloping steps
+    size_t FindRow(int document_id, size_t first_row = 0) const;
+
+    // Sets the bit of every row in bitmap to whether the document passes
+    // the filter, those of the removed rows are clear. Uses AVX2 when the CPU has it. The bitmap is reused,
+    // it allocates only when the rows outgrow it.
+    void Evaluate(const DocumentFilter& filter,
+                  std::vector<uint64_t>& bitmap) const;
+
+private:
+    static constexpr int REMOVED_ROW_STATUS = 32;
+    static constexpr size_t COMPACTION_RATIO = 4;
+
+    std::pmr::vector<int> ids_;
+    std::pmr::vector<int> ratings_;
+    // DocumentStatus values, as wide as the other columns for SIMD
+    std::pmr::vector<int> statuses_;
+    // lengths of the documents for the scoring kernels
+    std::pmr::vector<int> word_counts_;
+    size_t removed_row_count_ = 0;
+
+    void Compact();
+    void EvaluateScalar(const DocumentFilter& filter, size_t first_row,
+                        uint64_t* bitmap) const;
+};
+
+inline bool IsRowSelected(const std::vector<uint64_t>& bitmap, size_t row)
+{
+    return (bitmap[row / 64] >> (row % 64)) & 1;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "fuzzy_index.h"
+#include "term_set_fingerprint.h"
+
+using namespace std;
+
+namespace {
+
+// FNV-1a of the word without the characters at skip_first and skip_second
+uint64_t HashWithout(string_view word, size_t skip_first, size_t skip_second)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (i == skip_first || i == skip_second) {
+            continue;
+        }
+        hash ^= static_cast<unsigned char>(word[i]);
+        hash *= 1099511628211ULL;
+    }
+    return MixHash(hash ^ (word.size() - (skip_first < word.size())
+                           - (skip_second < word.size())));
+}
+
+} // namespace
+
+FuzzyIndex::FuzzyIndex(pmr::memory_resource* resource):
+    variants_{resource}
+{
+}
+
+FuzzyIndex::FuzzyIndex(const FuzzyIndex& other, pmr::memory_resource* resource):
+    max_distance_{other.max_distance_},
+    variants_{other.variants_, resource}
+{
+}
+
+pmr::polymorphic_allocator<byte> FuzzyIndex::get_allocator() const
+{
+    return variants_.get_allocator();
+}
+
+void FuzzyIndex::Reset(int max_distance)
+{
+    if (max_distance < 0 || max_distance > MAX_DISTANCE) {
+        throw invalid_argument{"Fuzzy distance must be from 0 to 2"};
+    }
+    max_distance_ = max_distance;
+    // clear() would keep the buckets
+    decltype(variants_){variants_.get_allocator()}.swap(variants_);
+}
+
+int FuzzyIndex::GetMaxDistance() const
+{
+    return max_distance_;
+}
+
+template <typename Action>
+void FuzzyIndex::ForEachVariantHash(string_view word, Action action) const
+{
+    const size_t none = word.npos;
+    action(HashWithout(word, none, none));
+    for (size_t i = 0; max_distance_ >= 1 && i < word.size(); ++i) {
+        action(HashWithout(word, i, none));
+        for (size_t j = i + 1; max_distance_ >= 2 && j < word.size(); ++j) {
+            action(HashWithout(word, i, j));
+        }
+    }
+}
+
+void FuzzyIndex::AddWord(string_view word)
+{
+    if (max_distance_ == 0 || word.size() > MAX_LENGTH) {
+        return;
+    }
+    ForEachVariantHash(word, [this, word](uint64_t hash) {
+        auto& words = variants_[hash];
+        // equal variants of the word come one after another
+        if (words.empty() || words.back() != word) {
+            words.push_back(word);
+        }
+    });
+}
+
+void FuzzyIndex::FindCandidates(string_view word,
+                                vector<pair<string_view, int>>& candidates) const
+{
+    if (max_distance_ == 0 || word.size() > MAX_LENGTH) {
+        return;
+    }
+    const size_t first_candidate = candidates.size();
+    ForEachVariantHash(word, [&](uint64_t hash) {
+        const auto it = variants_.find(hash);
+        if (it == variants_.end()) {
+            return;
+        }
+        for (const string_view candidate : it->second) {
+            if (candidate == word) {
+                continue;
+            }
+            const bool is_found = any_of(
+                        candidates.begin() + first_candidate, candidates.end(),
+                        [candidate](const auto& found) {
+                return found.first == candidate;
+            });
+            if (is_found) {
+                continue;
+            }
+            const int distance = ComputeBoundedEditDistance(word, candidate,
+                                                            max_distance_);
+            if (distance <= max_distance_) {
+                candidates.emplace_back(candidate, distance);
+            }
+        }
+    });
+}
+
+int ComputeBoundedEditDistance(string_view lhs, string_view rhs, int max_distance)
+{
+    const int length_difference = static_cast<int>(lhs.size())
+            - static_cast<int>(rhs.size());
+    if (abs(length_difference) > max_distance) {
+        return max_distance + 1;
+    }
+    array<int, FuzzyIndex::MAX_LENGTH + 1> previous;
+    array<int, FuzzyIndex::MAX_LENGTH + 1> current;
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<int>(i);
+        int row_minimum = current[0];
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            const int substitution = previous[j - 1] + (lhs[i - 1] != rhs[j - 1]);
+            current[j] = min({substitution, previous[j] + 1, current[j - 1] + 1});
+            row_minimum = min(row_minimum, current[j]);
+        }
+        if (row_minimum > max_distance) {
+            return max_distance + 1;
+        }
+        swap(previous, current);
+    }
+    return min(previous[rhs.size()], max_distance + 1);
+}
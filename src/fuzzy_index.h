@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Symmetric-delete index of words for typo-tolerant lookup. Every word is
+// filed under the hashes of its variants with up to max_distance characters
+// deleted. Two words within the Levenshtein distance d share a variant with
+// at most d deletions from each, so the candidates of a query word are found
+// by hashing its own deletion variants and verified with a bounded distance.
+// Words longer than MAX_LENGTH are not indexed and find nothing.
+class FuzzyIndex {
+public:
+    static constexpr size_t MAX_LENGTH = 64;
+    static constexpr int MAX_DISTANCE = 2;
+
+    explicit FuzzyIndex(std::pmr::memory_resource* resource);
+    // Keeps the views of other
+    FuzzyIndex(const FuzzyIndex& other, std::pmr::memory_resource* resource);
+
+    FuzzyIndex(const FuzzyIndex&) = delete;
+    FuzzyIndex& operator=(const FuzzyIndex&) = delete;
+
+    std::pmr::polymorphic_allocator<std::byte> get_allocator() const;
+
+    // Replaces the words by the words of other mapped by own_word
+    template <typename WordMapper>
+    void CopyFrom(const FuzzyIndex& other, WordMapper own_word);
+
+    // Drops the words, 0 disables the index
+    void Reset(int max_distance);
+    int GetMaxDistance() const;
+
+    // The word must outlive the index
+    void AddWord(std::string_view word);
+
+    // Appends the indexed words other than word within the distance with
+    // their distances. Every word is appended once, no allocation happens
+    // unless candidates grows.
+    void FindCandidates(std::string_view word,
+                        std::vector<std::pair<std::string_view, int>>& candidates) const;
+
+private:
+    int max_distance_{0};
+    std::pmr::unordered_map<uint64_t, std::pmr::vector<std::string_view>> variants_;
+
+    template <typename Action>
+    void ForEachVariantHash(std::string_view word, Action action) const;
+};
+
+// Levenshtein distance, or max_distance + 1 when it is larger.
+// The words must not be longer than FuzzyIndex::MAX_LENGTH.
+int ComputeBoundedEditDistance(std::string_view lhs, std::string_view rhs,
+                               int max_distance);
+
+
+
+template <typename WordMapper>
+void FuzzyIndex::CopyFrom(const FuzzyIndex& other, WordMapper own_word)
+{
+    Reset(other.max_distance_);
+    if (other.variants_.empty()) {
+        return;
+    }
+    variants_.reserve(other.variants_.size());
+    for (const auto& [hash, other_words] : other.variants_) {
+        auto& words = variants_[hash];
+        words.reserve(other_words.size());
+        for (const std::string_view word : other_words) {
+            words.push_back(own_word(word));
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "latency_histogram.h"
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram():
+    stripes_{make_unique<Stripe[]>(stripe_count_)}
+{
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other):
+    LatencyHistogram()
+{
+    *this = other;
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+{
+    if (this != &other) {
+        for (size_t stripe = 0; stripe < stripe_count_; ++stripe) {
+            for (size_t i = 0; i < bucket_count_; ++i) {
+                stripes_[stripe].counts[i].store(
+                            other.stripes_[stripe].counts[i].load(memory_order_relaxed),
+                            memory_order_relaxed);
+            }
+        }
+    }
+    return *this;
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds latency)
+{
+    const uint64_t value = static_cast<uint64_t>(max<int64_t>(latency.count(), 0));
+    stripes_[GetThreadStripe()].counts[GetBucketIndex(value)].fetch_add(
+                1, memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::GetSummary() const
+{
+    vector<uint64_t> merged(bucket_count_);
+    LatencySummary summary;
+    for (size_t stripe = 0; stripe < stripe_count_; ++stripe) {
+        for (size_t i = 0; i < bucket_count_; ++i) {
+            const uint64_t count = stripes_[stripe].counts[i].load(memory_order_relaxed);
+            merged[i] += count;
+            summary.count += count;
+        }
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    const auto percentile = [&merged, &summary](double percent) {
+        // rank of the requested value, counted from 1
+        const uint64_t rank = max<uint64_t>(
+                    1, static_cast<uint64_t>(percent / 100.0 * summary.count + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < merged.size(); ++i) {
+            seen += merged[i];
+            if (seen >= rank) {
+                return chrono::nanoseconds{GetBucketValue(i)};
+            }
+        }
+        return chrono::nanoseconds{GetBucketValue(merged.size() - 1)};
+    };
+
+    summary.p50 = percentile(50.0);
+    summary.p90 = percentile(90.0);
+    summary.p99 = percentile(99.0);
+    summary.p999 = percentile(99.9);
+    summary.max = percentile(100.0);
+    return summary;
+}
+
+void LatencyHistogram::Reset()
+{
+    for (size_t stripe = 0; stripe < stripe_count_; ++stripe) {
+        for (auto& count : stripes_[stripe].counts) {
+            count.store(0, memory_order_relaxed);
+        }
+    }
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+    if (value < sub_bucket_count_) {
+        return value;
+    }
+    value = min(value, (uint64_t{1} << max_value_bits_) - 1);
+    // value >> shift is in [half_sub_bucket_count_, sub_bucket_count_)
+    const int shift = bit_width(value) - sub_bucket_bits_;
+    return sub_bucket_count_ + (shift - 1) * half_sub_bucket_count_
+            + ((value >> shift) - half_sub_bucket_count_);
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index)
+{
+    if (index < sub_bucket_count_) {
+        return index;
+    }
+    const size_t shift = (index - sub_bucket_count_) / half_sub_bucket_count_ + 1;
+    const uint64_t sub_bucket = (index - sub_bucket_count_) % half_sub_bucket_count_
+            + half_sub_bucket_count_;
+    return (sub_bucket << shift) + ((uint64_t{1} << shift) >> 1);
+}
+
+size_t LatencyHistogram::GetThreadStripe()
+{
+    static atomic<size_t> next_thread{0};
+    thread_local const size_t stripe = next_thread.fetch_add(1) % stripe_count_;
+    return stripe;
+}
+
+ScopedLatency::ScopedLatency(LatencyHistogram* histogram):
+    histogram_{histogram}
+{
+    if (histogram_) {
+        start_ = Clock::now();
+    }
+}
+
+ScopedLatency::~ScopedLatency()
+{
+    if (histogram_) {
+        histogram_->Record(Clock::now() - start_);
+    }
+}
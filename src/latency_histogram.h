@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+struct LatencySummary {
+    uint64_t count{0};
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+    std::chrono::nanoseconds max{0};
+};
+
+// HDR-style histogram of latencies: values below 32 ns are counted exactly,
+// every next power of two is split into 16 linear buckets, so the relative
+// error of a percentile is below 1/16. Values above ~9.7 hours are clamped.
+// Every thread records into one of the stripes with relaxed atomic
+// increments; a summary merges the stripes without locking.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram& other);
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    void Record(std::chrono::nanoseconds latency);
+    LatencySummary GetSummary() const;
+    void Reset();
+
+private:
+    static constexpr int sub_bucket_bits_ = 5;
+    static constexpr uint64_t sub_bucket_count_ = uint64_t{1} << sub_bucket_bits_;
+    static constexpr uint64_t half_sub_bucket_count_ = sub_bucket_count_ / 2;
+    static constexpr int max_value_bits_ = 45;
+    static constexpr size_t bucket_count_ = sub_bucket_count_
+            + (max_value_bits_ - sub_bucket_bits_ + 1) * half_sub_bucket_count_;
+    static constexpr size_t stripe_count_ = 16;
+
+    struct alignas(64) Stripe {
+        std::array<std::atomic<uint64_t>, bucket_count_> counts{};
+    };
+
+    std::unique_ptr<Stripe[]> stripes_;
+
+    static size_t GetBucketIndex(uint64_t value);
+    // middle of the range of values counted by the bucket
+    static uint64_t GetBucketValue(size_t index);
+    static size_t GetThreadStripe();
+};
+
+// Records the time of its own life into the histogram, does nothing
+// (not even reading the clock) when the histogram is null
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* histogram);
+    ~ScopedLatency();
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyHistogram* histogram_;
+    Clock::time_point start_;
+};
@@ -0,0 +1,40 @@
+#include "memory_accounting.h"
+
+using namespace std;
+
+AccountingResource::AccountingResource(pmr::memory_resource* upstream):
+    upstream_{upstream}
+{
+}
+
+MemoryUsage AccountingResource::GetUsage() const
+{
+    return MemoryUsage{live_bytes_.load(memory_order_relaxed),
+                       live_allocations_.load(memory_order_relaxed)};
+}
+
+pmr::memory_resource* AccountingResource::GetUpstream() const
+{
+    return upstream_;
+}
+
+void* AccountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void* p = upstream_->allocate(bytes, alignment);
+    live_bytes_.fetch_add(bytes, memory_order_relaxed);
+    live_allocations_.fetch_add(1, memory_order_relaxed);
+    return p;
+}
+
+void AccountingResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    upstream_->deallocate(p, bytes, alignment);
+    live_bytes_.fetch_sub(bytes, memory_order_relaxed);
+    live_allocations_.fetch_sub(1, memory_order_relaxed);
+}
+
+bool AccountingResource::do_is_equal(
+        const pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+struct MemoryUsage {
+    size_t bytes{0};
+    size_t allocations{0};
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        bytes += other.bytes;
+        allocations += other.allocations;
+        return *this;
+    }
+};
+
+// Memory resource which forwards every request to the upstream resource
+// and counts the live bytes and allocations. Counters are atomic, so the
+// resource is as thread-safe as its upstream.
+class AccountingResource : public std::pmr::memory_resource {
+public:
+    explicit AccountingResource(
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    AccountingResource(const AccountingResource&) = delete;
+    AccountingResource& operator=(const AccountingResource&) = delete;
+
+    MemoryUsage GetUsage() const;
+    std::pmr::memory_resource* GetUpstream() const;
+
+private:
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> live_bytes_{0};
+    std::atomic<size_t> live_allocations_{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
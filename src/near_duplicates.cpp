@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "search_server.h"
+#include "term_set_fingerprint.h"
+
+#include "near_duplicates.h"
+
+using namespace std;
+
+namespace {
+
+using WordFrequencies = remove_cvref_t<
+        decltype(declval<const SearchServer&>().GetWordFrequencies(0))>;
+
+struct BucketEntry {
+    uint64_t key;
+    uint32_t index;
+
+    bool operator<(const BucketEntry& other) const {
+        return key < other.key || (key == other.key && index < other.index);
+    }
+};
+
+using CandidatePair = pair<uint32_t, uint32_t>;
+
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size):
+        parent_(size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            parent_[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    uint32_t Find(uint32_t item) {
+        while (parent_[item] != item) {
+            parent_[item] = parent_[parent_[item]];
+            item = parent_[item];
+        }
+        return item;
+    }
+
+    // the lowest index becomes the root
+    void Union(uint32_t lhs, uint32_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs != rhs) {
+            parent_[max(lhs, rhs)] = min(lhs, rhs);
+        }
+    }
+
+private:
+    vector<uint32_t> parent_;
+};
+
+double ComputeJaccard(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    size_t common = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        } else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        } else {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    const size_t united = lhs.size() + rhs.size() - common;
+    return united == 0 ? 1.0 : static_cast<double>(common) / united;
+}
+
+// Combines MinHash values of the band's rows into a single bucket key
+uint64_t ComputeBandKey(const vector<uint64_t>& word_hashes,
+                        int band, int rows_per_band) {
+    uint64_t key = 0;
+    for (int row = 0; row < rows_per_band; ++row) {
+        const uint64_t seed = MixHash(
+                    static_cast<uint64_t>(band) * rows_per_band + row + 1);
+        uint64_t min_hash = numeric_limits<uint64_t>::max();
+        for (const uint64_t word_hash : word_hashes) {
+            min_hash = min(min_hash, MixHash(word_hash ^ seed));
+        }
+        key = MixHash(key ^ min_hash);
+    }
+    return key;
+}
+
+void CheckOptions(const NearDuplicateOptions& options) {
+    if (options.bands <= 0 || options.rows_per_band <= 0) {
+        throw invalid_argument{"bands and rows_per_band must be positive"};
+    }
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0)) {
+        throw invalid_argument{"jaccard_threshold must be in (0, 1]"};
+    }
+}
+
+} // namespace
+
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server,
+                                       const NearDuplicateOptions& options)
+{
+    CheckOptions(options);
+
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+    if (document_count < 2) {
+        return {};
+    }
+
+    const size_t fixed_bytes = document_count * (sizeof(int)
+                                                 + sizeof(WordFrequencies*)
+                                                 + sizeof(uint32_t)
+                                                 + sizeof(CandidatePair) + 1);
+    const size_t band_bytes = document_count * sizeof(BucketEntry);
+    if (options.memory_budget_bytes < fixed_bytes + band_bytes) {
+        throw invalid_argument{"Memory budget is too small for "
+                               + to_string(document_count) + " documents"};
+    }
+    const int bands_per_pass = static_cast<int>(min<size_t>(
+                options.bands,
+                (options.memory_budget_bytes - fixed_bytes) / band_bytes));
+
+    vector<const WordFrequencies*> words(document_count);
+    transform(document_ids.begin(), document_ids.end(), words.begin(),
+              [&search_server](const int document_id){
+        return &search_server.GetWordFrequencies(document_id);
+    });
+
+    DisjointSets clusters{document_count};
+    vector<BucketEntry> entries;
+    vector<CandidatePair> candidates;
+    vector<char> is_similar;
+
+    for (int first_band = 0; first_band < options.bands;
+         first_band += bands_per_pass) {
+        const int pass_bands = min(bands_per_pass, options.bands - first_band);
+        entries.resize(document_count * pass_bands);
+
+        for_each(execution::par, words.begin(), words.end(),
+                 [&](const WordFrequencies* const& document_words){
+            const size_t index = &document_words - words.data();
+            thread_local vector<uint64_t> word_hashes;
+            word_hashes.clear();
+            for (const auto& [word, _] : *document_words) {
+                word_hashes.push_back(hash<string_view>{}(word));
+            }
+            for (int band = 0; band < pass_bands; ++band) {
+                entries[band * document_count + index] = BucketEntry{
+                    ComputeBandKey(word_hashes, first_band + band,
+                                   options.rows_per_band),
+                    static_cast<uint32_t>(index)};
+            }
+        });
+
+        for (int band = 0; band < pass_bands; ++band) {
+            const auto band_begin = entries.begin() + band * document_count;
+            const auto band_end = band_begin + document_count;
+            sort(execution::par, band_begin, band_end);
+
+            // every document of a bucket is compared with the first one
+            candidates.clear();
+            for (auto bucket = band_begin; bucket != band_end;) {
+                const auto bucket_end = find_if(
+                            bucket, band_end, [bucket](const BucketEntry& entry){
+                    return entry.key != bucket->key;
+                });
+                const uint32_t leader = bucket->index;
+                for (auto member = next(bucket); member != bucket_end; ++member) {
+                    if (!words[leader]->empty()
+                            && clusters.Find(leader) != clusters.Find(member->index)) {
+                        candidates.emplace_back(leader, member->index);
+                    }
+                }
+                bucket = bucket_end;
+            }
+
+            is_similar.resize(candidates.size());
+            transform(execution::par,
+                      candidates.begin(), candidates.end(), is_similar.begin(),
+                      [&words, &options](const CandidatePair& candidate) -> char {
+                return ComputeJaccard(*words[candidate.first],
+                                      *words[candidate.second])
+                        >= options.jaccard_threshold;
+            });
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                if (is_similar[i]) {
+                    clusters.Union(candidates[i].first, candidates[i].second);
+                }
+            }
+        }
+    }
+
+    // the root of a cluster is its lowest index, hence its lowest id
+    candidates.clear();
+    for (uint32_t index = 0; index < document_count; ++index) {
+        const uint32_t root = clusters.Find(index);
+        if (root != index) {
+            candidates.emplace_back(root, index);
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+
+    vector<vector<int>> result;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (i == 0 || candidates[i].first != candidates[i - 1].first) {
+            result.push_back({document_ids[candidates[i].first]});
+        }
+        result.back().push_back(document_ids[candidates[i].second]);
+    }
+    return result;
+}
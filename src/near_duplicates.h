@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class SearchServer;
+
+struct NearDuplicateOptions {
+    // documents are clustered when the Jaccard similarity of their sets
+    // of words is not lower than the threshold
+    double jaccard_threshold{0.8};
+    // bands * rows_per_band MinHash values are computed per document.
+    // The probability to become a candidate pair is 1 - (1 - J^rows)^bands.
+    int bands{16};
+    int rows_per_band{8};
+    // upper bound of the working memory; bands are processed in passes
+    // so that the bucket keys of a pass fit into the budget
+    size_t memory_budget_bytes{size_t{256} << 20};
+};
+
+// Clusters of near-duplicate documents found with MinHash signatures and
+// locality-sensitive hashing. Candidates sharing a band bucket are checked
+// against the first document of the bucket with the exact Jaccard similarity.
+// Every cluster is sorted by id, clusters are ordered by their lowest id.
+std::vector<std::vector<int>> FindNearDuplicates(
+        const SearchServer& search_server,
+        const NearDuplicateOptions& options = {});
@@ -0,0 +1,190 @@
+#include <algorithm>
+
+#include "positional_index.h"
+
+using namespace std;
+
+namespace {
+
+void AppendVarint(uint32_t value, pmr::vector<uint8_t>& data)
+{
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+} // namespace
+
+PositionalIndex::PositionalIndex(pmr::memory_resource* resource):
+    documents_{resource}
+{
+}
+
+PositionalIndex::PositionalIndex(const PositionalIndex& other,
+                                 pmr::memory_resource* resource):
+    documents_{other.documents_, resource}
+{
+}
+
+pmr::polymorphic_allocator<byte> PositionalIndex::get_allocator() const
+{
+    return documents_.get_allocator();
+}
+
+PositionalIndex::DocumentPositions::DocumentPositions(
+        const allocator_type& allocator):
+    words{allocator},
+    offsets{allocator},
+    data{allocator}
+{
+}
+
+void PositionalIndex::AddDocument(int document_id,
+                                  vector<pair<string_view, uint32_t>> positions)
+{
+    // grouped by word, the positions of a word stay ascending
+    stable_sort(positions.begin(), positions.end(),
+                [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    const shared_ptr<DocumentPositions> added = MakeDocumentPositions();
+    DocumentPositions& document_positions = *added;
+    document_positions.data.reserve(positions.size());
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        uint32_t previous = 0;
+        if (i == 0 || positions[i].first != positions[i - 1].first) {
+            document_positions.words.push_back(positions[i].first);
+            document_positions.offsets.push_back(
+                        static_cast<uint32_t>(document_positions.data.size()));
+        } else {
+            previous = positions[i - 1].second;
+        }
+        AppendVarint(positions[i].second - previous, document_positions.data);
+    }
+    document_positions.offsets.push_back(
+                static_cast<uint32_t>(document_positions.data.size()));
+
+    document_positions.words.shrink_to_fit();
+    document_positions.offsets.shrink_to_fit();
+    document_positions.data.shrink_to_fit();
+    documents_.insert_or_assign(document_id, added);
+}
+
+shared_ptr<PositionalIndex::DocumentPositions> 
+    PositionalIndex::MakeDocumentPositions() const
+{
+    return allocate_shared<DocumentPositions>(
+                pmr::polymorphic_allocator<DocumentPositions>(
+                    documents_.get_allocator()));
+}
+
+void PositionalIndex::RemoveDocument(int document_id)
+{
+    documents_.erase(document_id);
+}
+
+void PositionalIndex::Clear()
+{
+    documents_.clear();
+}
+
+size_t PositionalIndex::DecodePositions(int document_id, string_view word,
+                                        vector<uint32_t>& positions) const
+{
+    const auto document = documents_.find(document_id);
+    if (document == documents_.end()) {
+        return 0;
+    }
+    const DocumentPositions& document_positions = *document->second;
+    const auto& words = document_positions.words;
+    const auto it = lower_bound(words.begin(), words.end(), word);
+    if (it == words.end() || *it != word) {
+        return 0;
+    }
+
+    const size_t index = it - words.begin();
+    const size_t size_before = positions.size();
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (size_t i = document_positions.offsets[index];
+         i < document_positions.offsets[index + 1]; ++i) {
+        const uint8_t byte = document_positions.data[i];
+        delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+    return positions.size() - size_before;
+}
+
+bool HasPhrase(const vector<uint32_t>& positions,
+               vector<PhrasePositions>& lists)
+{
+    if (lists.empty()) {
+        return false;
+    }
+    // the lowest start of the phrase which is not ruled out yet
+    int64_t start = 0;
+    bool is_aligned = false;
+    while (!is_aligned) {
+        is_aligned = true;
+        for (PhrasePositions& list : lists) {
+            while (list.begin != list.end
+                   && int64_t{positions[list.begin]} - list.offset < start) {
+                ++list.begin;
+            }
+            if (list.begin == list.end) {
+                return false;
+            }
+            const int64_t list_start = int64_t{positions[list.begin]} - list.offset;
+            if (list_start > start) {
+                start = list_start;
+                is_aligned = false;
+            }
+        }
+    }
+    return true;
+}
+
+bool HasProximity(const vector<uint32_t>& positions,
+                  vector<PhrasePositions>& lists,
+                  uint32_t max_span)
+{
+    if (lists.empty()) {
+        return false;
+    }
+    for (const PhrasePositions& list : lists) {
+        if (list.end - list.begin < list.count) {
+            return false;
+        }
+    }
+    // the window spans the count positions of every list from its current
+    // one, it moves by advancing the list with the lowest current position
+    while (true) {
+        PhrasePositions* lowest = &lists.front();
+        uint32_t highest_position = 0;
+        for (PhrasePositions& list : lists) {
+            if (positions[list.begin] < positions[lowest->begin]) {
+                lowest = &list;
+            }
+            highest_position = max(highest_position, 
+                                   positions[list.begin + list.count - 1]);
+        }
+        if (highest_position - positions[lowest->begin] <= max_span) {
+            return true;
+        }
+        if (++lowest->begin + lowest->count > lowest->end) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Token positions of the words of every document. The positions of a word
+// in a document are stored as deltas in LEB128 varints, so an occurrence
+// takes a byte in most documents. The words are views owned by the caller.
+// The positions of a document do not change once added, so copies of
+// the index share them.
+class PositionalIndex {
+public:
+    explicit PositionalIndex(std::pmr::memory_resource* resource);
+    // Shares the positions of the documents and the views of other
+    PositionalIndex(const PositionalIndex& other,
+                    std::pmr::memory_resource* resource);
+
+    PositionalIndex(const PositionalIndex&) = delete;
+    PositionalIndex& operator=(const PositionalIndex&) = delete;
+
+    std::pmr::polymorphic_allocator<std::byte> get_allocator() const;
+
+    // Replaces the documents by the documents of other,
+    // keyed by own_word(word) instead of the views of other
+    template <typename WordMapper>
+    void CopyFrom(const PositionalIndex& other, WordMapper own_word);
+
+    // Words of the document with their token positions in ascending order
+    void AddDocument(int document_id,
+                     std::vector<std::pair<std::string_view, uint32_t>> positions);
+    void RemoveDocument(int document_id);
+    void Clear();
+
+    // Appends the positions of the word in the document in ascending order
+    // and returns their number. Allocates only when positions grows.
+    size_t DecodePositions(int document_id, std::string_view word,
+                           std::vector<uint32_t>& positions) const;
+
+private:
+    struct DocumentPositions {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit DocumentPositions(const allocator_type& allocator);
+
+        // sorted distinct words of the document
+        std::pmr::vector<std::string_view> words;
+        // the positions of words[i] are data[offsets[i], offsets[i + 1])
+        std::pmr::vector<uint32_t> offsets;
+        std::pmr::vector<uint8_t> data;
+    };
+
+    std::pmr::map<int, std::shared_ptr<const DocumentPositions>> documents_;
+
+    std::shared_ptr<DocumentPositions> MakeDocumentPositions() const;
+};
+
+// Positions of one phrase word, the range [begin, end) of a buffer shared
+// by the words of the phrase. The word stands offset tokens after the
+// first word of the phrase, count times in the phrase.
+struct PhrasePositions {
+    size_t begin;
+    size_t end;
+    uint32_t offset;
+    uint32_t count{1};
+};
+
+// True when the words stand at their offsets from a common start, which
+// is found by intersecting the position lists shifted by the offsets.
+// The ranges are consumed.
+bool HasPhrase(const std::vector<uint32_t>& positions,
+               std::vector<PhrasePositions>& lists);
+
+// True when a window of max_span + 1 tokens holds count positions of every
+// list, in any order. The offsets are ignored, the ranges are consumed.
+bool HasProximity(const std::vector<uint32_t>& positions,
+                  std::vector<PhrasePositions>& lists,
+                  uint32_t max_span);
+
+
+
+template <typename WordMapper>
+void PositionalIndex::CopyFrom(const PositionalIndex& other, WordMapper own_word)
+{
+    documents_.clear();
+    for (const auto& [document_id, other_positions] : other.documents_) {
+        std::shared_ptr<DocumentPositions> document_positions = 
+                MakeDocumentPositions();
+        document_positions->words.reserve(other_positions->words.size());
+        for (const std::string_view word : other_positions->words) {
+            document_positions->words.push_back(own_word(word));
+        }
+        document_positions->offsets = other_positions->offsets;
+        document_positions->data = other_positions->data;
+        documents_.emplace_hint(documents_.end(), document_id, 
+                                std::move(document_positions));
+    }
+}
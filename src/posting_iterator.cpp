@@ -0,0 +1,294 @@
+#include <algorithm>
+
+#include "posting_iterator.h"
+
+using namespace std;
+
+TermIterator::TermIterator(string_view word, const TermPostings& postings,
+                           size_t document_freq):
+    word_{word},
+    postings_{&postings},
+    current_{postings.begin()},
+    document_freq_{document_freq}
+{
+    Update();
+}
+
+void TermIterator::Next()
+{
+    ++current_;
+    Update();
+}
+
+void TermIterator::Advance(int target)
+{
+    if (document_id_ < target) {
+        current_ = SeekPosting(*postings_, current_, target);
+        Update();
+    }
+}
+
+size_t TermIterator::GetCost() const
+{
+    return postings_->size();
+}
+
+void TermIterator::CollectTerms(vector<const TermIterator*>& terms) const
+{
+    terms.push_back(this);
+}
+
+string_view TermIterator::GetWord() const
+{
+    return word_;
+}
+
+size_t TermIterator::GetDocumentFreq() const
+{
+    return document_freq_;
+}
+
+uint32_t TermIterator::GetCount() const
+{
+    return current_->second;
+}
+
+void TermIterator::Update()
+{
+    document_id_ = current_ == postings_->end() ? END : current_->first;
+}
+
+void EmptyIterator::Next()
+{
+}
+
+void EmptyIterator::Advance(int )
+{
+}
+
+size_t EmptyIterator::GetCost() const
+{
+    return 0;
+}
+
+void EmptyIterator::CollectTerms(vector<const TermIterator*>& ) const
+{
+}
+
+ConjunctionIterator::ConjunctionIterator(
+        vector<unique_ptr<PostingIterator>> children):
+    children_{move(children)}
+{
+    sort(children_.begin(), children_.end(),
+         [](const auto& lhs, const auto& rhs) {
+        return lhs->GetCost() < rhs->GetCost();
+    });
+    Align(children_.front()->GetDocumentId());
+}
+
+void ConjunctionIterator::Next()
+{
+    children_.front()->Next();
+    Align(children_.front()->GetDocumentId());
+}
+
+void ConjunctionIterator::Advance(int target)
+{
+    if (document_id_ < target) {
+        children_.front()->Advance(target);
+        Align(children_.front()->GetDocumentId());
+    }
+}
+
+size_t ConjunctionIterator::GetCost() const
+{
+    return children_.front()->GetCost();
+}
+
+void ConjunctionIterator::CollectTerms(vector<const TermIterator*>& terms) const
+{
+    for (const auto& child : children_) {
+        child->CollectTerms(terms);
+    }
+}
+
+void ConjunctionIterator::Align(int target)
+{
+    bool is_aligned = false;
+    while (target != END && !is_aligned) {
+        is_aligned = true;
+        for (const auto& child : children_) {
+            child->Advance(target);
+            if (child->GetDocumentId() != target) {
+                target = child->GetDocumentId();
+                is_aligned = false;
+                break;
+            }
+        }
+    }
+    document_id_ = target;
+}
+
+DisjunctionIterator::DisjunctionIterator(
+        vector<unique_ptr<PostingIterator>> children):
+    children_{move(children)}
+{
+    Update();
+}
+
+void DisjunctionIterator::Next()
+{
+    for (const auto& child : children_) {
+        if (child->GetDocumentId() == document_id_) {
+            child->Next();
+        }
+    }
+    Update();
+}
+
+void DisjunctionIterator::Advance(int target)
+{
+    if (document_id_ < target) {
+        for (const auto& child : children_) {
+            child->Advance(target);
+        }
+        Update();
+    }
+}
+
+size_t DisjunctionIterator::GetCost() const
+{
+    size_t cost = 0;
+    for (const auto& child : children_) {
+        cost += child->GetCost();
+    }
+    return cost;
+}
+
+void DisjunctionIterator::CollectTerms(vector<const TermIterator*>& terms) const
+{
+    for (const auto& child : children_) {
+        if (child->GetDocumentId() == document_id_) {
+            child->CollectTerms(terms);
+        }
+    }
+}
+
+void DisjunctionIterator::Update()
+{
+    document_id_ = END;
+    for (const auto& child : children_) {
+        document_id_ = min(document_id_, child->GetDocumentId());
+    }
+}
+
+ExclusionIterator::ExclusionIterator(unique_ptr<PostingIterator> positive,
+                                     unique_ptr<PostingIterator> excluded):
+    positive_{move(positive)},
+    excluded_{move(excluded)}
+{
+    Skip();
+}
+
+void ExclusionIterator::Next()
+{
+    positive_->Next();
+    Skip();
+}
+
+void ExclusionIterator::Advance(int target)
+{
+    if (document_id_ < target) {
+        positive_->Advance(target);
+        Skip();
+    }
+}
+
+size_t ExclusionIterator::GetCost() const
+{
+    return positive_->GetCost();
+}
+
+void ExclusionIterator::CollectTerms(vector<const TermIterator*>& terms) const
+{
+    positive_->CollectTerms(terms);
+}
+
+void ExclusionIterator::Skip()
+{
+    while (positive_->GetDocumentId() != END) {
+        excluded_->Advance(positive_->GetDocumentId());
+        if (excluded_->GetDocumentId() != positive_->GetDocumentId()) {
+            break;
+        }
+        positive_->Next();
+    }
+    document_id_ = positive_->GetDocumentId();
+}
+
+OptionalIterator::OptionalIterator(unique_ptr<PostingIterator> required,
+                                   unique_ptr<PostingIterator> optional):
+    required_{move(required)},
+    optional_{move(optional)}
+{
+    Update();
+}
+
+void OptionalIterator::Next()
+{
+    required_->Next();
+    Update();
+}
+
+void OptionalIterator::Advance(int target)
+{
+    if (document_id_ < target) {
+        required_->Advance(target);
+        Update();
+    }
+}
+
+size_t OptionalIterator::GetCost() const
+{
+    return required_->GetCost();
+}
+
+void OptionalIterator::CollectTerms(vector<const TermIterator*>& terms) const
+{
+    required_->CollectTerms(terms);
+    if (optional_->GetDocumentId() == document_id_) {
+        optional_->CollectTerms(terms);
+    }
+}
+
+void OptionalIterator::Update()
+{
+    document_id_ = required_->GetDocumentId();
+    if (document_id_ != END) {
+        optional_->Advance(document_id_);
+    }
+}
+
+unique_ptr<PostingIterator> MakeConjunction(
+        vector<unique_ptr<PostingIterator>> children)
+{
+    if (children.empty()) {
+        return make_unique<EmptyIterator>();
+    }
+    if (children.size() == 1) {
+        return move(children.front());
+    }
+    return make_unique<ConjunctionIterator>(move(children));
+}
+
+unique_ptr<PostingIterator> MakeDisjunction(
+        vector<unique_ptr<PostingIterator>> children)
+{
+    if (children.empty()) {
+        return make_unique<EmptyIterator>();
+    }
+    if (children.size() == 1) {
+        return move(children.front());
+    }
+    return make_unique<DisjunctionIterator>(move(children));
+}
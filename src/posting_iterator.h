@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Documents of a word by id with the occurrences of the word in each one
+using TermPostings = std::pmr::map<int, uint32_t>;
+
+// The first posting from it on with an id not less than document_id:
+// a few steps along the list, then a descent from the root of its tree,
+// which serves as the skip pointers of the list
+TermPostings::const_iterator SeekPosting(const TermPostings& postings,
+                                         TermPostings::const_iterator it,
+                                         int document_id);
+
+class TermIterator;
+
+// A node of a compiled query: the documents matching the node in ascending
+// order of ids, found lazily in the postings of its terms, so no node holds
+// a set of documents. A new iterator stands at its first document.
+class PostingIterator {
+public:
+    // the id of an iterator past its last document
+    static constexpr int END = std::numeric_limits<int>::max();
+
+    virtual ~PostingIterator() = default;
+
+    int GetDocumentId() const;
+    // Moves to the next document, the iterator must not be at END
+    virtual void Next() = 0;
+    // Moves to the first document not less than target, never back
+    virtual void Advance(int target) = 0;
+    // Upper bound of the number of documents
+    virtual size_t GetCost() const = 0;
+    // Appends the terms at the current document, but for excluded ones
+    virtual void CollectTerms(std::vector<const TermIterator*>& terms) const = 0;
+
+protected:
+    int document_id_{END};
+};
+
+// The postings of a word, which must outlive the iterator
+class TermIterator : public PostingIterator {
+public:
+    // document_freq is the number of documents of the word in the index,
+    // which may be more than postings holds
+    TermIterator(std::string_view word, const TermPostings& postings,
+                 size_t document_freq);
+
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+
+    std::string_view GetWord() const;
+    size_t GetDocumentFreq() const;
+    // the occurrences of the word in the current document
+    uint32_t GetCount() const;
+
+    // set by the server for the scorer
+    double word_weight{1.0};
+    size_t word_index{0};
+
+private:
+    std::string_view word_;
+    const TermPostings* postings_;
+    TermPostings::const_iterator current_;
+    size_t document_freq_;
+
+    void Update();
+};
+
+// No documents
+class EmptyIterator : public PostingIterator {
+public:
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+};
+
+// The documents of all the children. The children are sought from
+// the one with the fewest documents: a child without the document makes
+// its own next document the next candidate.
+class ConjunctionIterator : public PostingIterator {
+public:
+    explicit ConjunctionIterator(
+            std::vector<std::unique_ptr<PostingIterator>> children);
+
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+
+private:
+    std::vector<std::unique_ptr<PostingIterator>> children_;
+
+    void Align(int target);
+};
+
+// The documents of any of the children
+class DisjunctionIterator : public PostingIterator {
+public:
+    explicit DisjunctionIterator(
+            std::vector<std::unique_ptr<PostingIterator>> children);
+
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+
+private:
+    std::vector<std::unique_ptr<PostingIterator>> children_;
+
+    void Update();
+};
+
+// The documents of positive which excluded has not
+class ExclusionIterator : public PostingIterator {
+public:
+    ExclusionIterator(std::unique_ptr<PostingIterator> positive,
+                      std::unique_ptr<PostingIterator> excluded);
+
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+
+private:
+    std::unique_ptr<PostingIterator> positive_;
+    std::unique_ptr<PostingIterator> excluded_;
+
+    void Skip();
+};
+
+// The documents of required; the terms of optional at them are collected
+// too, optional is advanced to every document of required
+class OptionalIterator : public PostingIterator {
+public:
+    OptionalIterator(std::unique_ptr<PostingIterator> required,
+                     std::unique_ptr<PostingIterator> optional);
+
+    void Next() override;
+    void Advance(int target) override;
+    size_t GetCost() const override;
+    void CollectTerms(std::vector<const TermIterator*>& terms) const override;
+
+private:
+    std::unique_ptr<PostingIterator> required_;
+    std::unique_ptr<PostingIterator> optional_;
+
+    void Update();
+};
+
+// The only child itself, an EmptyIterator for none
+std::unique_ptr<PostingIterator> MakeConjunction(
+        std::vector<std::unique_ptr<PostingIterator>> children);
+std::unique_ptr<PostingIterator> MakeDisjunction(
+        std::vector<std::unique_ptr<PostingIterator>> children);
+
+
+
+inline TermPostings::const_iterator SeekPosting(const TermPostings& postings,
+                                                TermPostings::const_iterator it,
+                                                int document_id)
+{
+    constexpr int step_count = 4;
+    for (int step = 0; step < step_count; ++step) {
+        if (it == postings.end() || it->first >= document_id) {
+            return it;
+        }
+        ++it;
+    }
+    if (it != postings.end() && it->first < document_id) {
+        return postings.lower_bound(document_id);
+    }
+    return it;
+}
+
+inline int PostingIterator::GetDocumentId() const
+{
+    return document_id_;
+}
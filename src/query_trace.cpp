@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "query_trace.h"
+
+using namespace std;
+
+namespace {
+
+// id of the query traced on this thread, 0 when the query is not sampled
+thread_local uint64_t traced_query_id{0};
+thread_local int query_depth{0};
+
+uint32_t GetThreadId()
+{
+    static atomic<uint32_t> next_thread_id{1};
+    thread_local const uint32_t thread_id = next_thread_id.fetch_add(1);
+    return thread_id;
+}
+
+uint64_t NextRandom()
+{
+    // xorshift64*, seeded per thread
+    thread_local uint64_t state = 0x9e3779b97f4a7c15ULL * GetThreadId();
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+void WriteMicroseconds(ostream& out, chrono::nanoseconds value)
+{
+    out << value.count() / 1000 << '.';
+    const int64_t fraction = value.count() % 1000;
+    if (fraction < 100) {
+        out << '0';
+    }
+    if (fraction < 10) {
+        out << '0';
+    }
+    out << fraction;
+}
+
+void WriteJsonString(ostream& out, const char* text)
+{
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+QueryTracer& QueryTracer::Instance()
+{
+    static QueryTracer tracer;
+    return tracer;
+}
+
+QueryTracer::QueryTracer():
+    epoch_{Clock::now()},
+    sample_threshold_{0},
+    capacity_{size_t{1} << 20}
+{
+    SetSampleRate(0.01);
+}
+
+void QueryTracer::SetSampleRate(double rate)
+{
+    rate = clamp(rate, 0.0, 1.0);
+    const uint64_t threshold = rate >= 1.0
+            ? numeric_limits<uint64_t>::max()
+            : static_cast<uint64_t>(ldexp(rate, 64));
+    sample_threshold_.store(threshold, memory_order_relaxed);
+}
+
+double QueryTracer::GetSampleRate() const
+{
+    const uint64_t threshold = sample_threshold_.load(memory_order_relaxed);
+    if (threshold == numeric_limits<uint64_t>::max()) {
+        return 1.0;
+    }
+    return ldexp(static_cast<double>(threshold), -64);
+}
+
+void QueryTracer::SetCapacity(size_t max_event_count)
+{
+    lock_guard<mutex> guard{events_mutex_};
+    capacity_ = max_event_count;
+}
+
+bool QueryTracer::ShouldSample()
+{
+    const uint64_t threshold = sample_threshold_.load(memory_order_relaxed);
+    if (threshold == 0) {
+        return false;
+    }
+    return threshold == numeric_limits<uint64_t>::max()
+            || NextRandom() < threshold;
+}
+
+uint64_t QueryTracer::NextQueryId()
+{
+    return next_query_id_.fetch_add(1, memory_order_relaxed);
+}
+
+void QueryTracer::Record(const TraceEvent& event)
+{
+    lock_guard<mutex> guard{events_mutex_};
+    if (events_.size() >= capacity_) {
+        ++dropped_;
+        return;
+    }
+    events_.push_back(event);
+}
+
+vector<TraceEvent> QueryTracer::GetEvents() const
+{
+    lock_guard<mutex> guard{events_mutex_};
+    return events_;
+}
+
+size_t QueryTracer::GetDroppedEventCount() const
+{
+    lock_guard<mutex> guard{events_mutex_};
+    return dropped_;
+}
+
+void QueryTracer::Clear()
+{
+    lock_guard<mutex> guard{events_mutex_};
+    events_.clear();
+    dropped_ = 0;
+}
+
+void QueryTracer::WriteChromeTrace(ostream& out) const
+{
+    const vector<TraceEvent> events = GetEvents();
+
+    out << "{\"traceEvents\":[";
+    bool is_first = true;
+    for (const TraceEvent& event : events) {
+        if (!is_first) {
+            out << ',';
+        }
+        is_first = false;
+        out << "\n{\"name\":";
+        WriteJsonString(out, event.name);
+        out << ",\"cat\":\"search\",\"ph\":\"X\",\"ts\":";
+        WriteMicroseconds(out, event.start);
+        out << ",\"dur\":";
+        WriteMicroseconds(out, event.duration);
+        out << ",\"pid\":1,\"tid\":" << event.thread_id
+            << ",\"args\":{\"query_id\":" << event.query_id << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+chrono::nanoseconds QueryTracer::Now() const
+{
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - epoch_);
+}
+
+TraceQueryScope::TraceQueryScope(const char* name):
+    name_{name},
+    is_outermost_{query_depth++ == 0}
+{
+    if (!is_outermost_) {
+        return;
+    }
+    QueryTracer& tracer = QueryTracer::Instance();
+    if (tracer.ShouldSample()) {
+        traced_query_id = tracer.NextQueryId();
+        start_ = tracer.Now();
+    }
+}
+
+TraceQueryScope::~TraceQueryScope()
+{
+    --query_depth;
+    if (!is_outermost_ || traced_query_id == 0) {
+        return;
+    }
+    QueryTracer& tracer = QueryTracer::Instance();
+    tracer.Record(TraceEvent{name_, traced_query_id, GetThreadId(),
+                             start_, tracer.Now() - start_});
+    traced_query_id = 0;
+}
+
+TraceSpan::TraceSpan(const char* name):
+    name_{name},
+    query_id_{traced_query_id}
+{
+    if (query_id_ != 0) {
+        start_ = QueryTracer::Instance().Now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (query_id_ == 0) {
+        return;
+    }
+    QueryTracer& tracer = QueryTracer::Instance();
+    tracer.Record(TraceEvent{name_, query_id_, GetThreadId(),
+                             start_, tracer.Now() - start_});
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// Sampled tracing of query phases. The TRACE_* macros expand to nothing
+// unless the library is built with SEARCH_SERVER_TRACING defined; the
+// collected spans are exported in the Chrome trace-event JSON format
+// understood by chrome://tracing and ui.perfetto.dev.
+
+struct TraceEvent {
+    // must point to a string literal
+    const char* name;
+    uint64_t query_id;
+    uint32_t thread_id;
+    std::chrono::nanoseconds start;
+    std::chrono::nanoseconds duration;
+};
+
+class QueryTracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static QueryTracer& Instance();
+
+    // Share of the queries which are traced, from 0 to 1
+    void SetSampleRate(double rate);
+    double GetSampleRate() const;
+
+    // Events beyond the capacity are dropped and counted
+    void SetCapacity(size_t max_event_count);
+
+    bool ShouldSample();
+    uint64_t NextQueryId();
+
+    void Record(const TraceEvent& event);
+    std::vector<TraceEvent> GetEvents() const;
+    size_t GetDroppedEventCount() const;
+    void Clear();
+
+    void WriteChromeTrace(std::ostream& out) const;
+
+    std::chrono::nanoseconds Now() const;
+
+private:
+    QueryTracer();
+
+    const Clock::time_point epoch_;
+    std::atomic<uint64_t> sample_threshold_;
+    std::atomic<uint64_t> next_query_id_{1};
+
+    mutable std::mutex events_mutex_;
+    std::vector<TraceEvent> events_;
+    size_t capacity_;
+    size_t dropped_{0};
+};
+
+// Makes the sampling decision for a query and traces the query as a whole.
+// Nested scopes (one public overload calling another) reuse the decision
+// of the outermost one.
+class TraceQueryScope {
+public:
+    explicit TraceQueryScope(const char* name);
+    ~TraceQueryScope();
+
+    TraceQueryScope(const TraceQueryScope&) = delete;
+    TraceQueryScope& operator=(const TraceQueryScope&) = delete;
+
+private:
+    const char* name_;
+    bool is_outermost_;
+    std::chrono::nanoseconds start_{0};
+};
+
+// Span of a phase of the query traced on the current thread
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t query_id_;
+    std::chrono::nanoseconds start_{0};
+};
+
+#define TRACE_CONCAT_INTERNAL(X, Y) X ## Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_TRACING
+#define TRACE_QUERY(name) TraceQueryScope TRACE_CONCAT(traceQuery, __LINE__)(name)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define TRACE_QUERY(name)
+#define TRACE_SPAN(name)
+#endif
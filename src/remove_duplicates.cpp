@@ -1,62 +1,67 @@
 #include <iostream>
 #include <algorithm>
+#include <execution>
 #include <iterator>
+#include <unordered_map>
 
 #include "search_server.h"
+#include "term_set_fingerprint.h"
 
 #include "remove_duplicates.h"
 
 
 using namespace std;
 
-template <typename Key, typename Value>
-set<Key> ExtractKeysFromMap(const map<Key, Value>& container)
+vector<int> FindDuplicates(const SearchServer& search_server)
 {
-    set<Key> out;
-        
-    transform(container.begin(), container.end(), 
-              insert_iterator(out, out.begin()),
-              [](const auto& key_value){
-        return key_value.first;
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+
+    vector<uint64_t> fingerprints(document_ids.size());
+    transform(execution::par,
+              document_ids.begin(), document_ids.end(),
+              fingerprints.begin(),
+              [&search_server](const int document_id){
+        return ComputeTermSetFingerprint(
+                    search_server.GetWordFrequencies(document_id));
     });
-    
-    return out;            
-}
 
-void RemoveDuplicates(SearchServer& search_server)
-{
-    set<int> duplicate_for_remove;
-    
-    set<set<string_view>> verified;
-    
-    for(const int document_id : search_server)
+    // documents with the same fingerprint but different sets of words
+    // (hash collisions) are kept side by side
+    unordered_map<uint64_t, vector<int>> originals;
+    originals.reserve(document_ids.size());
+
+    vector<int> duplicates;
+    for(size_t i{0}; i < document_ids.size(); ++i)
     {
-        set<string_view> wordsOfDocument = ExtractKeysFromMap(
-                                          search_server.GetWordFrequencies(
-                                              document_id));
-        
-        if(0 == verified.count(wordsOfDocument))
+        const int document_id{document_ids[i]};
+        const auto& words{search_server.GetWordFrequencies(document_id)};
+        vector<int>& same_fingerprint{originals[fingerprints[i]]};
+
+        const bool is_duplicate{any_of(
+                    same_fingerprint.begin(), same_fingerprint.end(),
+                    [&](const int original_id){
+            return HasSameTermSet(
+                        words, search_server.GetWordFrequencies(original_id));
+        })};
+
+        if(is_duplicate)
+        {
+            duplicates.push_back(document_id);
+        }
+        else
         {
-            verified.insert(wordsOfDocument);
-            continue;
+            same_fingerprint.push_back(document_id);
         }
-        
-        duplicate_for_remove.insert(document_id);
     }
-    
-    for(const int id: duplicate_for_remove)
+
+    return duplicates;
+}
+
+void RemoveDuplicates(SearchServer& search_server)
+{
+    for(const int id: FindDuplicates(search_server))
     {
         search_server.RemoveDocument(id);
         cout<<"Found duplicate document id "<<id<<"\n";
     }
 }
-
-
-
-
-
-
-
-
-
-
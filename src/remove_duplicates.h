@@ -7,15 +7,8 @@
 
 class SearchServer;
 
-void RemoveDuplicates(SearchServer& search_server);
-
-
-
-
-
-
-
-
-
-
+// Ids of documents whose set of words equals the set of words of a document
+// with a lower id, in ascending order. Fingerprints are computed in parallel.
+std::vector<int> FindDuplicates(const SearchServer& search_server);
 
+void RemoveDuplicates(SearchServer& search_server);
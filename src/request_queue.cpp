@@ -44,3 +44,34 @@ void RequestQueue::AddRequest(int results_num) {
         ++no_results_requests_;
     }
 }
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(
+        const SearchServer& search_server,
+        RequestStatistics::Clock::duration window,
+        size_t per_thread_capacity)
+    : search_server_(search_server)
+    , statistics_(window, per_thread_capacity) {
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(
+        const string_view raw_query, 
+        DocumentStatus status) {
+    const auto start = RequestStatistics::Clock::now();
+    const auto result = search_server_.FindTopDocuments(raw_query, status);
+    const auto finish = RequestStatistics::Clock::now();
+    statistics_.Record(finish, finish - start, result.size());
+    return result;
+}
+
+vector<Document> ConcurrentRequestQueue::AddFindRequest(
+        const string_view raw_query) {
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const {
+    return static_cast<int>(statistics_.GetReport().no_result_requests);
+}
+
+RequestStatisticsReport ConcurrentRequestQueue::GetStatistics() const {
+    return statistics_.GetReport();
+}
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "document.h"
+#include "request_statistics.h"
 #include "search_server.h"
 
 class RequestQueue {
@@ -43,3 +44,39 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
     return result;
 }
 
+
+// Thread-safe counterpart of RequestQueue. Requests are timestamped with
+// a monotonic clock and kept in RequestStatistics for the given window.
+class ConcurrentRequestQueue {
+public:
+    explicit ConcurrentRequestQueue(
+            const SearchServer& search_server,
+            RequestStatistics::Clock::duration window = std::chrono::hours{24},
+            size_t per_thread_capacity = 4096);
+    
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(const std::string_view raw_query,
+                                         DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(const std::string_view raw_query, 
+                                         DocumentStatus status);
+    std::vector<Document> AddFindRequest(const std::string_view raw_query);
+    
+    int GetNoResultRequests() const;
+    RequestStatisticsReport GetStatistics() const;
+    
+private:
+    const SearchServer& search_server_;
+    RequestStatistics statistics_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(
+        const std::string_view raw_query,
+        DocumentPredicate document_predicate) {
+    const auto start = RequestStatistics::Clock::now();
+    const auto result = search_server_.FindTopDocuments(raw_query, 
+                                                        document_predicate);
+    const auto finish = RequestStatistics::Clock::now();
+    statistics_.Record(finish, finish - start, result.size());
+    return result;
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <utility>
+
+#include "request_statistics.h"
+
+using namespace std;
+
+namespace {
+
+atomic<uint64_t> next_statistics_id{0};
+
+chrono::nanoseconds Percentile(vector<int64_t>& latencies, double percent)
+{
+    if (latencies.empty()) {
+        return chrono::nanoseconds{0};
+    }
+    const size_t rank = min(latencies.size() - 1,
+                            static_cast<size_t>(percent / 100.0 * latencies.size()));
+    nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+    return chrono::nanoseconds{latencies[rank]};
+}
+
+} // namespace
+
+RequestStatistics::RequestStatistics(Clock::duration window,
+                                     size_t per_thread_capacity):
+    id_{next_statistics_id.fetch_add(1)},
+    window_{window},
+    per_thread_capacity_{max<size_t>(per_thread_capacity, 1)},
+    created_{Clock::now()}
+{
+}
+
+void RequestStatistics::Record(Clock::time_point finished,
+                               Clock::duration latency,
+                               size_t result_count)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    Entry& entry = buffer.entries[buffer.written % buffer.entries.size()];
+    ++buffer.written;
+
+    const uint64_t sequence = entry.sequence.load(memory_order_relaxed);
+    entry.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry.finished.store(chrono::duration_cast<chrono::nanoseconds>(
+                             finished.time_since_epoch()).count(),
+                         memory_order_relaxed);
+    entry.latency.store(chrono::duration_cast<chrono::nanoseconds>(
+                            latency).count(),
+                        memory_order_relaxed);
+    entry.result_count.store(result_count, memory_order_relaxed);
+    entry.sequence.store(sequence + 2, memory_order_release);
+}
+
+RequestStatisticsReport RequestStatistics::GetReport() const
+{
+    return GetReport(Clock::now());
+}
+
+RequestStatisticsReport RequestStatistics::GetReport(Clock::time_point now) const
+{
+    const int64_t window_end = chrono::duration_cast<chrono::nanoseconds>(
+                now.time_since_epoch()).count();
+    const int64_t window_begin = window_end
+            - chrono::duration_cast<chrono::nanoseconds>(window_).count();
+
+    RequestStatisticsReport report;
+    vector<int64_t> latencies;
+    {
+        lock_guard<mutex> guard{buffers_mutex_};
+        for (const auto& buffer : buffers_) {
+            for (const Entry& entry : buffer->entries) {
+                const uint64_t sequence = entry.sequence.load(memory_order_acquire);
+                if (sequence == 0 || sequence % 2 == 1) {
+                    continue;
+                }
+                const int64_t finished = entry.finished.load(memory_order_relaxed);
+                const int64_t latency = entry.latency.load(memory_order_relaxed);
+                const uint64_t result_count =
+                        entry.result_count.load(memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (entry.sequence.load(memory_order_relaxed) != sequence) {
+                    // overwritten while being read
+                    continue;
+                }
+                if (finished <= window_begin || finished > window_end) {
+                    continue;
+                }
+                ++report.requests;
+                if (result_count == 0) {
+                    ++report.no_result_requests;
+                }
+                latencies.push_back(latency);
+            }
+        }
+    }
+
+    if (report.requests == 0) {
+        return report;
+    }
+    report.no_result_rate =
+            static_cast<double>(report.no_result_requests) / report.requests;
+
+    // a young object has not observed the whole window yet
+    const Clock::duration observed = min(window_, max(now - created_,
+                                                      Clock::duration{1}));
+    report.queries_per_second = report.requests
+            / chrono::duration<double>(observed).count();
+
+    report.latency_p50 = Percentile(latencies, 50.0);
+    report.latency_p90 = Percentile(latencies, 90.0);
+    report.latency_p99 = Percentile(latencies, 99.0);
+    return report;
+}
+
+RequestStatistics::Clock::duration RequestStatistics::GetWindow() const
+{
+    return window_;
+}
+
+RequestStatistics::ThreadBuffer& RequestStatistics::GetThreadBuffer()
+{
+    // buffers are owned by the statistics object, the unique id makes
+    // entries of destroyed objects unreachable; a thread drops them when
+    // it adds a buffer, so it keeps entries of live objects only
+    struct ThreadBufferRef {
+        uint64_t owner_id;
+        weak_ptr<ThreadBuffer> owner_buffer;
+        ThreadBuffer* buffer;
+    };
+    thread_local vector<ThreadBufferRef> thread_buffers;
+
+    for (auto it = thread_buffers.rbegin(); it != thread_buffers.rend(); ++it) {
+        if (it->owner_id == id_) {
+            return *it->buffer;
+        }
+    }
+
+    shared_ptr<ThreadBuffer> buffer = make_shared<ThreadBuffer>(per_thread_capacity_);
+    {
+        lock_guard<mutex> guard{buffers_mutex_};
+        buffers_.push_back(buffer);
+    }
+    erase_if(thread_buffers, [](const ThreadBufferRef& ref) {
+        return ref.owner_buffer.expired();
+    });
+    thread_buffers.push_back({id_, buffer, buffer.get()});
+    return *buffer;
+}
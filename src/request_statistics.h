@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct RequestStatisticsReport {
+    size_t requests{0};
+    size_t no_result_requests{0};
+    double no_result_rate{0.0};
+    double queries_per_second{0.0};
+    std::chrono::nanoseconds latency_p50{0};
+    std::chrono::nanoseconds latency_p90{0};
+    std::chrono::nanoseconds latency_p99{0};
+};
+
+// Statistics of search requests over a sliding window of wall-clock time.
+// Every recording thread writes into its own lock-free ring buffer, reports
+// are built by scanning all buffers. A ring keeps the latest
+// per_thread_capacity requests of its thread, older requests are forgotten
+// even if they are still inside the window.
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestStatistics(
+            Clock::duration window = std::chrono::minutes{1},
+            size_t per_thread_capacity = 4096);
+
+    RequestStatistics(const RequestStatistics&) = delete;
+    RequestStatistics& operator=(const RequestStatistics&) = delete;
+
+    void Record(Clock::time_point finished, Clock::duration latency,
+                size_t result_count);
+
+    // Report over the window ending at now
+    RequestStatisticsReport GetReport() const;
+    RequestStatisticsReport GetReport(Clock::time_point now) const;
+
+    Clock::duration GetWindow() const;
+
+private:
+    // Written by the owning thread only, protected by a per-entry
+    // sequence counter (seqlock) against concurrent readers
+    struct Entry {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> finished{0};
+        std::atomic<int64_t> latency{0};
+        std::atomic<uint64_t> result_count{0};
+    };
+
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t capacity):
+            entries(capacity)
+        {
+        }
+
+        std::vector<Entry> entries;
+        uint64_t written{0};
+    };
+
+    const uint64_t id_;
+    const Clock::duration window_;
+    const size_t per_thread_capacity_;
+    const Clock::time_point created_;
+
+    mutable std::mutex buffers_mutex_;
+    // shared, so that the threads see when the buffers are gone
+    std::deque<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    ThreadBuffer& GetThreadBuffer();
+};
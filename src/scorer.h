@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+// Relevance policy of SearchServer. The relevance of a document is the sum
+// of ComputeTermScore over its matched words, where
+//  - word_weight is ComputeWordWeight of the word, computed once per query
+//    (and multiplied by the penalty of a fuzzy match),
+//  - count is the number of occurrences of the word in the document,
+//    term_freq is its share count / word_count among the words,
+//  - document_norm is ComputeDocumentNorm of the document, computed once
+//    per matched document from the length stored by AddDocument.
+// The scorer is a template argument of the scoring loops, so the calls are
+// inlined into them.
+template <typename T>
+concept Scorer = requires(const T& scorer, int count, size_t document_freq,
+                          uint32_t term_count, double value) {
+    { scorer.ComputeWordWeight(count, document_freq) } -> std::convertible_to<double>;
+    { scorer.ComputeDocumentNorm(count, value) } -> std::convertible_to<double>;
+    { scorer.ComputeTermScore(value, term_count, count, value, value) }
+            -> std::convertible_to<double>;
+};
+
+// tf * log(N / df), the default relevance
+struct TfIdfScorer {
+    double ComputeWordWeight(int document_count, size_t document_freq) const {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    double ComputeDocumentNorm(int, double) const {
+        return 0.0;
+    }
+
+    double ComputeTermScore(double term_freq, uint32_t, int, double word_weight,
+                            double) const {
+        return term_freq * word_weight;
+    }
+};
+
+// Okapi BM25 with the non-negative idf log(1 + (N - df + 0.5) / (df + 0.5))
+struct Bm25Scorer {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    double ComputeWordWeight(int document_count, size_t document_freq) const {
+        const double freq = static_cast<double>(document_freq);
+        return std::log(1.0 + (document_count - freq + 0.5) / (freq + 0.5));
+    }
+
+    double ComputeDocumentNorm(int word_count, double average_word_count) const {
+        if (average_word_count <= 0.0) {
+            return k1;
+        }
+        return k1 * (1.0 - b + b * word_count / average_word_count);
+    }
+
+    double ComputeTermScore(double, uint32_t count, int, double word_weight,
+                            double document_norm) const {
+        return word_weight * count * (k1 + 1.0) / (count + document_norm);
+    }
+};
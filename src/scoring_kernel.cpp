@@ -0,0 +1,234 @@
+#include <cmath>
+
+#include "scoring_kernel.h"
+#include "simd.h"
+
+using namespace std;
+
+namespace {
+
+// The scalar kernels finish what the AVX2 ones leave, from first on
+
+template <typename Real>
+void ComputeTfIdfScoresScalar(const Real* term_freqs, size_t first, size_t size,
+                              Real word_weight, Real* scores)
+{
+    for (size_t i = first; i < size; ++i) {
+        scores[i] = term_freqs[i] * word_weight;
+    }
+}
+
+void ComputeBm25ScoresScalar(const Bm25Scorer& scorer, const uint32_t* counts,
+                             const uint32_t* rows, const int* word_counts,
+                             size_t first, size_t size, double word_weight,
+                             double average_word_count, double* scores)
+{
+    for (size_t i = first; i < size; ++i) {
+        const int word_count = word_counts[rows[i]];
+        // BM25 does not use the term frequency
+        scores[i] = scorer.ComputeTermScore(
+                    0.0, counts[i], word_count, word_weight,
+                    scorer.ComputeDocumentNorm(word_count, average_word_count));
+    }
+}
+
+// Bm25Scorer in single precision
+void ComputeBm25ScoresScalar(const Bm25Scorer& scorer, const uint32_t* counts,
+                             const uint32_t* rows, const int* word_counts,
+                             size_t first, size_t size, float word_weight,
+                             double average_word_count, float* scores)
+{
+    const float k1 = static_cast<float>(scorer.k1);
+    const float b = static_cast<float>(scorer.b);
+    const float average = static_cast<float>(average_word_count);
+    for (size_t i = first; i < size; ++i) {
+        const float word_count = static_cast<float>(word_counts[rows[i]]);
+        const float norm = average > 0.0f
+                ? k1 * (1.0f - b + b * word_count / average) : k1;
+        const float count = static_cast<float>(counts[i]);
+        scores[i] = word_weight * count * (k1 + 1.0f) / (count + norm);
+    }
+}
+
+template <typename Real>
+void AccumulateScoresScalar(const uint32_t* rows, const Real* scores, size_t size,
+                            Real* accumulator, uint64_t* touched)
+{
+    for (size_t i = 0; i < size; ++i) {
+        accumulator[rows[i]] += scores[i];
+        touched[rows[i] / 64] |= uint64_t{1} << (rows[i] % 64);
+    }
+}
+
+#ifdef SEARCH_SERVER_AVX2
+
+// The AVX2 kernels return the number of postings done
+
+__attribute__((target("avx2")))
+size_t ComputeTfIdfScoresAvx2(const double* term_freqs, size_t size,
+                              double word_weight, double* scores)
+{
+    const __m256d weight = _mm256_set1_pd(word_weight);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm256_storeu_pd(scores + i, _mm256_mul_pd(
+                             _mm256_loadu_pd(term_freqs + i), weight));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t ComputeTfIdfScoresAvx2(const float* term_freqs, size_t size,
+                              float word_weight, float* scores)
+{
+    const __m256 weight = _mm256_set1_ps(word_weight);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(scores + i, _mm256_mul_ps(
+                             _mm256_loadu_ps(term_freqs + i), weight));
+    }
+    return i;
+}
+
+// The operations go in the order of Bm25Scorer, without FMA, so the result
+// is that of the scalar code
+__attribute__((target("avx2")))
+size_t ComputeBm25ScoresAvx2(const Bm25Scorer& scorer, const uint32_t* counts,
+                             const uint32_t* rows, const int* word_counts,
+                             size_t size, double word_weight,
+                             double average_word_count, double* scores)
+{
+    const __m256d k1 = _mm256_set1_pd(scorer.k1);
+    const __m256d b = _mm256_set1_pd(scorer.b);
+    const __m256d one_minus_b = _mm256_set1_pd(1.0 - scorer.b);
+    const __m256d k1_plus_one = _mm256_set1_pd(scorer.k1 + 1.0);
+    const __m256d average = _mm256_set1_pd(average_word_count);
+    const __m256d weight = _mm256_set1_pd(word_weight);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m128i row = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(rows + i));
+        const __m256d word_count = _mm256_cvtepi32_pd(
+                    _mm_i32gather_epi32(word_counts, row, 4));
+        const __m256d norm = _mm256_mul_pd(k1, _mm256_add_pd(
+                    one_minus_b, _mm256_div_pd(_mm256_mul_pd(b, word_count),
+                                               average)));
+        // the counts fit in int32
+        const __m256d count = _mm256_cvtepi32_pd(_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(counts + i)));
+        _mm256_storeu_pd(scores + i, _mm256_div_pd(
+                             _mm256_mul_pd(_mm256_mul_pd(weight, count),
+                                           k1_plus_one),
+                             _mm256_add_pd(count, norm)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t ComputeBm25ScoresAvx2(const Bm25Scorer& scorer, const uint32_t* counts,
+                             const uint32_t* rows, const int* word_counts,
+                             size_t size, float word_weight,
+                             double average_word_count, float* scores)
+{
+    const float k1_value = static_cast<float>(scorer.k1);
+    const float b_value = static_cast<float>(scorer.b);
+    const __m256 k1 = _mm256_set1_ps(k1_value);
+    const __m256 b = _mm256_set1_ps(b_value);
+    const __m256 one_minus_b = _mm256_set1_ps(1.0f - b_value);
+    const __m256 k1_plus_one = _mm256_set1_ps(k1_value + 1.0f);
+    const __m256 average = _mm256_set1_ps(static_cast<float>(average_word_count));
+    const __m256 weight = _mm256_set1_ps(word_weight);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        const __m256i row = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(rows + i));
+        const __m256 word_count = _mm256_cvtepi32_ps(
+                    _mm256_i32gather_epi32(word_counts, row, 4));
+        const __m256 norm = _mm256_mul_ps(k1, _mm256_add_ps(
+                    one_minus_b, _mm256_div_ps(_mm256_mul_ps(b, word_count),
+                                               average)));
+        const __m256 count = _mm256_cvtepi32_ps(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(counts + i)));
+        _mm256_storeu_ps(scores + i, _mm256_div_ps(
+                             _mm256_mul_ps(_mm256_mul_ps(weight, count),
+                                           k1_plus_one),
+                             _mm256_add_ps(count, norm)));
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void ComputeTfIdfScores(const double* term_freqs, size_t size,
+                        double word_weight, double* scores)
+{
+    size_t first = 0;
+#ifdef SEARCH_SERVER_AVX2
+    if (HasAvx2()) {
+        first = ComputeTfIdfScoresAvx2(term_freqs, size, word_weight, scores);
+    }
+#endif
+    ComputeTfIdfScoresScalar(term_freqs, first, size, word_weight, scores);
+}
+
+void ComputeTfIdfScores(const float* term_freqs, size_t size,
+                        float word_weight, float* scores)
+{
+    size_t first = 0;
+#ifdef SEARCH_SERVER_AVX2
+    if (HasAvx2()) {
+        first = ComputeTfIdfScoresAvx2(term_freqs, size, word_weight, scores);
+    }
+#endif
+    ComputeTfIdfScoresScalar(term_freqs, first, size, word_weight, scores);
+}
+
+void ComputeBm25Scores(const Bm25Scorer& scorer, const uint32_t* counts,
+                       const uint32_t* rows, const int* word_counts, size_t size,
+                       double word_weight, double average_word_count,
+                       double* scores)
+{
+    size_t first = 0;
+#ifdef SEARCH_SERVER_AVX2
+    // the scorer has a branch for an empty index
+    if (HasAvx2() && average_word_count > 0.0) {
+        first = ComputeBm25ScoresAvx2(scorer, counts, rows, word_counts,
+                                      size, word_weight, average_word_count,
+                                      scores);
+    }
+#endif
+    ComputeBm25ScoresScalar(scorer, counts, rows, word_counts, first, size,
+                            word_weight, average_word_count, scores);
+}
+
+void ComputeBm25Scores(const Bm25Scorer& scorer, const uint32_t* counts,
+                       const uint32_t* rows, const int* word_counts, size_t size,
+                       float word_weight, double average_word_count,
+                       float* scores)
+{
+    size_t first = 0;
+#ifdef SEARCH_SERVER_AVX2
+    if (HasAvx2() && average_word_count > 0.0) {
+        first = ComputeBm25ScoresAvx2(scorer, counts, rows, word_counts,
+                                      size, word_weight, average_word_count,
+                                      scores);
+    }
+#endif
+    ComputeBm25ScoresScalar(scorer, counts, rows, word_counts, first, size,
+                            word_weight, average_word_count, scores);
+}
+
+// AVX2 has gathers but no scatters, the sums go one by one
+void AccumulateScores(const uint32_t* rows, const double* scores, size_t size,
+                      double* accumulator, uint64_t* touched)
+{
+    AccumulateScoresScalar(rows, scores, size, accumulator, touched);
+}
+
+void AccumulateScores(const uint32_t* rows, const float* scores, size_t size,
+                      float* accumulator, uint64_t* touched)
+{
+    AccumulateScoresScalar(rows, scores, size, accumulator, touched);
+}
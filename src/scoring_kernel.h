@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "scorer.h"
+
+// Kernels of the accumulating scoring mode. A block holds the decoded
+// postings of one word: the rows of the documents in DocumentColumns and
+// the term frequencies, in double or in float, or the counts. The double kernels compute
+// exactly what the scorers compute, operation by operation.
+constexpr size_t SCORING_BLOCK_SIZE = 256;
+
+void ComputeTfIdfScores(const double* term_freqs, size_t size,
+                        double word_weight, double* scores);
+void ComputeTfIdfScores(const float* term_freqs, size_t size,
+                        float word_weight, float* scores);
+
+// The lengths of the documents are gathered from word_counts by the rows
+void ComputeBm25Scores(const Bm25Scorer& scorer, const uint32_t* counts,
+                       const uint32_t* rows, const int* word_counts, size_t size,
+                       double word_weight, double average_word_count,
+                       double* scores);
+void ComputeBm25Scores(const Bm25Scorer& scorer, const uint32_t* counts,
+                       const uint32_t* rows, const int* word_counts, size_t size,
+                       float word_weight, double average_word_count,
+                       float* scores);
+
+// accumulator[rows[i]] += scores[i], and the bits of the rows are set
+// in touched
+void AccumulateScores(const uint32_t* rows, const double* scores, size_t size,
+                      double* accumulator, uint64_t* touched);
+void AccumulateScores(const uint32_t* rows, const float* scores, size_t size,
+                      float* accumulator, uint64_t* touched);
@@ -0,0 +1,33 @@
+#include "search_error.h"
+
+using namespace std;
+
+string_view GetErrorMessage(SearchError error)
+{
+    switch (error) {
+    case SearchError::EMPTY_WORD:
+        return "empty word"sv;
+    case SearchError::INVALID_MINUS_WORD:
+        return "invalid minus word"sv;
+    case SearchError::INVALID_CHARACTERS:
+        return "contains invalid characters"sv;
+    case SearchError::INVALID_DOCUMENT_ID:
+        return "document_id is invalid"sv;
+    case SearchError::DUPLICATE_DOCUMENT_ID:
+        return "document_id is already added"sv;
+    case SearchError::DOCUMENT_NOT_FOUND:
+        return "document is not found"sv;
+    case SearchError::INVALID_PHRASE:
+        return "invalid phrase"sv;
+    case SearchError::POSITIONAL_INDEX_DISABLED:
+        return "positional index is disabled"sv;
+    case SearchError::INVALID_QUERY:
+        return "invalid query"sv;
+    }
+    return "unknown error"sv;
+}
+
+ostream& operator<<(ostream& os, SearchError error)
+{
+    return os << GetErrorMessage(error);
+}
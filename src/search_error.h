@@ -0,0 +1,130 @@
+#pragma once
+
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Errors reported by the non-throwing SearchServer overloads
+enum class SearchError {
+    EMPTY_WORD,
+    // a bare "-" or a word starting with "--"
+    INVALID_MINUS_WORD,
+    INVALID_CHARACTERS,
+    INVALID_DOCUMENT_ID,
+    DUPLICATE_DOCUMENT_ID,
+    DOCUMENT_NOT_FOUND,
+    // an unterminated or empty quoted phrase, a minus word in a phrase
+    // or a malformed ~N suffix
+    INVALID_PHRASE,
+    // a quoted phrase on a server without the positional index
+    POSITIONAL_INDEX_DISABLED,
+    // a boolean query with a parenthesis without a pair, an operator
+    // without an operand or a phrase; a phrase in a query of
+    // SearchServer::FindAllDocumentsRange
+    INVALID_QUERY,
+};
+
+// Static text, never allocates
+std::string_view GetErrorMessage(SearchError error);
+
+std::ostream& operator<<(std::ostream& os, SearchError error);
+
+// Value or error code, the part of C++23 std::expected the server needs
+template <typename T>
+class Expected {
+public:
+    Expected(T value):
+        value_{std::move(value)}
+    {
+    }
+
+    Expected(SearchError error):
+        error_{error}
+    {
+    }
+
+    bool HasValue() const {
+        return value_.has_value();
+    }
+
+    explicit operator bool() const {
+        return HasValue();
+    }
+
+    // Throws std::logic_error when the result holds an error
+    T& GetValue() & {
+        CheckValue();
+        return *value_;
+    }
+
+    const T& GetValue() const & {
+        CheckValue();
+        return *value_;
+    }
+
+    T&& GetValue() && {
+        CheckValue();
+        return std::move(*value_);
+    }
+
+    T& operator*() & {
+        return *value_;
+    }
+
+    const T& operator*() const & {
+        return *value_;
+    }
+
+    T* operator->() {
+        return &*value_;
+    }
+
+    const T* operator->() const {
+        return &*value_;
+    }
+
+    // Meaningful only when the result holds no value
+    SearchError GetError() const {
+        return error_;
+    }
+
+private:
+    std::optional<T> value_;
+    SearchError error_{};
+
+    void CheckValue() const {
+        if (!value_) {
+            throw std::logic_error{std::string{GetErrorMessage(error_)}};
+        }
+    }
+};
+
+template <>
+class Expected<void> {
+public:
+    Expected() = default;
+
+    Expected(SearchError error):
+        error_{error}
+    {
+    }
+
+    bool HasValue() const {
+        return !error_.has_value();
+    }
+
+    explicit operator bool() const {
+        return HasValue();
+    }
+
+    // Meaningful only when the result holds an error
+    SearchError GetError() const {
+        return error_.value_or(SearchError{});
+    }
+
+private:
+    std::optional<SearchError> error_;
+};
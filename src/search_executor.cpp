@@ -0,0 +1,69 @@
+#include <utility>
+
+#include "search_executor.h"
+
+using namespace std;
+
+SearchExecutor::SearchExecutor(size_t thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]{ WorkerLoop(); });
+    }
+}
+
+SearchExecutor::~SearchExecutor()
+{
+    {
+        lock_guard<mutex> guard{mutex_};
+        is_stopped_ = true;
+    }
+    has_jobs_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void SearchExecutor::Post(Job job)
+{
+    {
+        lock_guard<mutex> guard{mutex_};
+        jobs_.push_back(move(job));
+    }
+    has_jobs_.notify_one();
+}
+
+size_t SearchExecutor::GetThreadCount() const
+{
+    return workers_.size();
+}
+
+SearchExecutor& SearchExecutor::Default()
+{
+    static SearchExecutor executor;
+    return executor;
+}
+
+void SearchExecutor::WorkerLoop()
+{
+    while (true) {
+        Job job;
+        {
+            unique_lock<mutex> lock{mutex_};
+            has_jobs_.wait(lock, [this]{
+                return is_stopped_ || !jobs_.empty();
+            });
+            // pending jobs are drained before the workers stop, otherwise
+            // suspended coroutines would never be resumed
+            if (jobs_.empty()) {
+                return;
+            }
+            job = move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool on which asynchronous search requests are executed
+class SearchExecutor {
+public:
+    using Job = std::function<void()>;
+
+    explicit SearchExecutor(size_t thread_count =
+            std::thread::hardware_concurrency());
+    ~SearchExecutor();
+
+    SearchExecutor(const SearchExecutor&) = delete;
+    SearchExecutor& operator=(const SearchExecutor&) = delete;
+
+    void Post(Job job);
+
+    size_t GetThreadCount() const;
+
+    // Executor shared by all SearchServer instances
+    static SearchExecutor& Default();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_jobs_;
+    std::deque<Job> jobs_;
+    bool is_stopped_{false};
+    std::vector<std::thread> workers_;
+
+    void WorkerLoop();
+};
@@ -0,0 +1,62 @@
+#include <bit>
+#include <charconv>
+#include <cstdint>
+
+#include "search_page.h"
+
+using namespace std;
+
+namespace {
+
+// Appends the number and a separator
+template <typename Integer>
+void AppendNumber(string& text, Integer value, int base, char separator)
+{
+    char buffer[24];
+    const auto [last, code] = to_chars(begin(buffer), end(buffer), value, base);
+    text.append(buffer, last);
+    text.push_back(separator);
+}
+
+// Reads a number followed by the separator from the front of the text
+template <typename Integer>
+bool ReadNumber(string_view& text, Integer& value, int base, char separator)
+{
+    const auto [last, code] = from_chars(text.data(), text.data() + text.size(),
+                                         value, base);
+    if (code != errc{} || last == text.data() + text.size() || *last != separator) {
+        return false;
+    }
+    text.remove_prefix(last - text.data() + 1);
+    return true;
+}
+
+} // namespace
+
+SearchCursor::SearchCursor(const Document& document):
+    document_{document}
+{
+}
+
+// The relevance is kept bit for bit, the ranking after the cursor has to
+// compare it with recomputed relevances exactly
+string SearchCursor::ToString() const
+{
+    string text;
+    AppendNumber(text, bit_cast<uint64_t>(document_.relevance), 16, '.');
+    AppendNumber(text, document_.rating, 10, '.');
+    AppendNumber(text, document_.id, 10, ';');
+    return text;
+}
+
+optional<SearchCursor> SearchCursor::FromString(string_view text)
+{
+    uint64_t relevance = 0;
+    int rating = 0;
+    int document_id = 0;
+    if (!ReadNumber(text, relevance, 16, '.') || !ReadNumber(text, rating, 10, '.')
+            || !ReadNumber(text, document_id, 10, ';') || !text.empty()) {
+        return nullopt;
+    }
+    return SearchCursor{Document{document_id, bit_cast<double>(relevance), rating}};
+}
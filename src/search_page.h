@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Search-after position of SearchServer::FindDocumentsPage: the ranking
+// key of the last document of a page. The next page is made of the
+// documents ranked after it, so the pages before it are not selected again.
+class SearchCursor {
+public:
+    // A string for a client to send back with the request of the next page
+    std::string ToString() const;
+    // nullopt when the text is not a cursor
+    static std::optional<SearchCursor> FromString(std::string_view text);
+
+private:
+    friend class SearchServer;
+
+    explicit SearchCursor(const Document& document);
+
+    Document document_;
+};
+
+struct DocumentPage {
+    std::vector<Document> documents;
+    // where the next page starts, nullopt after the last page
+    std::optional<SearchCursor> next;
+};
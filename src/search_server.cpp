@@ -1,49 +1,262 @@
 #include <algorithm>
+#include <charconv>
 #include <cmath>
 #include <utility>
 
 #include "search_server.h"
+#include "term_set_fingerprint.h"
 
 
 using namespace std;
     
 
-SearchServer::SearchServer(const string_view stop_words_text):
-    SearchServer{SplitIntoWords(stop_words_text)}
+SearchServer::IndexMemory::IndexMemory(pmr::memory_resource* upstream):
+    stop_words{upstream},
+    unique_words{upstream},
+    word_to_document{upstream},
+    document_to_word{upstream},
+    documents{upstream},
+    fingerprints{upstream},
+    positions{upstream},
+    fuzzy{upstream},
+    status_postings{upstream}
+{
+}
+
+SearchServer::SearchServer(pmr::memory_resource* upstream,
+                           const set<string, less<>>& stop_words):
+    memory_{make_shared<IndexMemory>(upstream)},
+    stop_words_{make_shared<const pmr::set<pmr::string, less<>>>(
+                    stop_words.begin(), stop_words.end(), 
+                    &memory_->stop_words)},
+    word_to_document_freqs_{&memory_->word_to_document},
+    documents_{&memory_->documents},
+    document_columns_{&memory_->documents},
+    document_ids_{&memory_->documents},
+    document_to_word_freqs_{&memory_->document_to_word},
+    unique_words_{&memory_->unique_words},
+    fingerprint_to_documents_{&memory_->fingerprints},
+    positional_index_{&memory_->positions},
+    fuzzy_index_{&memory_->fuzzy},
+    status_postings_{MakeStatusPostings(&memory_->status_postings)}
+{
+    if(!all_of(stop_words_->cbegin(), stop_words_->cend(),
+              [](const pmr::string& word){
+                    return IsValidWord(word);
+                }))
+    {
+        throw invalid_argument{"Contains invalid characters in stop words"};
+    }
+}
+
+SearchServer::SearchServer(const string_view stop_words_text,
+                           pmr::memory_resource* resource):
+    SearchServer{SplitIntoWords(stop_words_text), resource}
 {    
 }
 
-SearchServer::SearchServer(const string& stop_words_text)
-    : SearchServer(string_view(stop_words_text))  
+SearchServer::SearchServer(const string& stop_words_text,
+                           pmr::memory_resource* resource)
+    : SearchServer(string_view(stop_words_text), resource)  
+{
+}
+
+SearchServer::SearchServer(const SearchServer& other) = default;
+
+SearchServer::SearchServer(const SearchServer& other,
+                           pmr::memory_resource* resource):
+    memory_{make_shared<IndexMemory>(resource)},
+    stop_words_{make_shared<const pmr::set<pmr::string, less<>>>(
+                    *other.stop_words_, &memory_->stop_words)},
+    word_to_document_freqs_{&memory_->word_to_document},
+    documents_{*other.documents_, &memory_->documents},
+    document_columns_{*other.document_columns_, &memory_->documents},
+    total_word_count_{other.total_word_count_},
+    document_ids_{*other.document_ids_, &memory_->documents},
+    document_to_word_freqs_{&memory_->document_to_word},
+    unique_words_{other.unique_words_, &memory_->unique_words},
+    is_duplicate_detection_enabled_{other.is_duplicate_detection_enabled_},
+    fingerprint_to_documents_{*other.fingerprint_to_documents_, 
+                              &memory_->fingerprints},
+    is_positional_index_enabled_{other.is_positional_index_enabled_},
+    positional_index_{&memory_->positions},
+    max_prefix_expansions_{other.max_prefix_expansions_},
+    fuzzy_options_{other.fuzzy_options_},
+    fuzzy_index_{&memory_->fuzzy},
+    is_status_partitioning_enabled_{other.is_status_partitioning_enabled_},
+    status_postings_{MakeStatusPostings(&memory_->status_postings)},
+    scoring_mode_{other.scoring_mode_},
+    match_mode_{other.match_mode_},
+    query_syntax_{other.query_syntax_},
+    latency_histograms_{other.latency_histograms_ 
+            ? make_shared<LatencyHistograms>(*other.latency_histograms_) : nullptr}
+{
+    // the indexes are keyed by views of the words of other,
+    // they are rebuilt on top of the own copy of the words
+    const auto own_word = [this](const string_view word) {
+        return unique_words_.Find(word);
+    };
+    const auto copy_postings = [&own_word](const WordPostings& other_postings,
+                                           WordPostings& postings) {
+        for (const auto& [word, document_freqs] : other_postings) {
+            postings.emplace_hint(postings.end(), own_word(word), *document_freqs);
+        }
+    };
+    
+    copy_postings(*other.word_to_document_freqs_, 
+                  word_to_document_freqs_.GetMutable());
+    auto& document_to_word_freqs = document_to_word_freqs_.GetMutable();
+    for (const auto& [document_id, word_freqs] : *other.document_to_word_freqs_) {
+        auto own_word_freqs = allocate_shared<WordFrequencies>(
+                    pmr::polymorphic_allocator<WordFrequencies>(
+                        &memory_->document_to_word));
+        for (const auto& [word, freq] : *word_freqs) {
+            own_word_freqs->emplace_hint(own_word_freqs->end(), 
+                                         own_word(word), freq);
+        }
+        document_to_word_freqs.emplace_hint(document_to_word_freqs.end(), 
+                                            document_id, move(own_word_freqs));
+    }
+    for (size_t i = 0; i < status_count_; ++i) {
+        copy_postings(*other.status_postings_[i], 
+                      status_postings_[i].GetMutable());
+    }
+    positional_index_.GetMutable().CopyFrom(*other.positional_index_, own_word);
+    fuzzy_index_.GetMutable().CopyFrom(*other.fuzzy_index_, own_word);
+}
+
+SearchServer::SearchServer(SearchServer&& other) = default;
+
+SearchServer& SearchServer::operator=(const SearchServer& other)
 {
+    if (this != &other) {
+        SearchServer copy{other};
+        Swap(copy);
+    }
+    return *this;
+}
+
+SearchServer& SearchServer::operator=(SearchServer&& other)
+{
+    if (this != &other) {
+        SearchServer moved{move(other)};
+        Swap(moved);
+    }
+    return *this;
+}
+
+void SearchServer::Swap(SearchServer& other)
+{
+    swap(memory_, other.memory_);
+    swap(stop_words_, other.stop_words_);
+    swap(word_to_document_freqs_, other.word_to_document_freqs_);
+    swap(documents_, other.documents_);
+    swap(document_columns_, other.document_columns_);
+    swap(total_word_count_, other.total_word_count_);
+    swap(document_ids_, other.document_ids_);
+    swap(document_to_word_freqs_, other.document_to_word_freqs_);
+    swap(unique_words_, other.unique_words_);
+    swap(is_duplicate_detection_enabled_, other.is_duplicate_detection_enabled_);
+    swap(fingerprint_to_documents_, other.fingerprint_to_documents_);
+    swap(is_positional_index_enabled_, other.is_positional_index_enabled_);
+    swap(positional_index_, other.positional_index_);
+    swap(max_prefix_expansions_, other.max_prefix_expansions_);
+    swap(fuzzy_options_, other.fuzzy_options_);
+    swap(fuzzy_index_, other.fuzzy_index_);
+    swap(is_status_partitioning_enabled_, other.is_status_partitioning_enabled_);
+    swap(status_postings_, other.status_postings_);
+    swap(scoring_mode_, other.scoring_mode_);
+    swap(match_mode_, other.match_mode_);
+    swap(query_syntax_, other.query_syntax_);
+    swap(latency_histograms_, other.latency_histograms_);
 }
 
 void SearchServer::AddDocument(int document_id, 
                                const string_view document, 
                                DocumentStatus status, 
                                const vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    const auto result = AddDocument(nothrow, document_id, document, 
+                                    status, ratings);
+    if (!result) {
+        if (result.GetError() == SearchError::INVALID_CHARACTERS) {
+            throw invalid_argument{"Contains invalid characters"};
+        }
         throw invalid_argument{"document_id is invalid"};
     }
+}
+
+Expected<void> SearchServer::AddDocument(nothrow_t,
+                                         int document_id, 
+                                         const string_view document, 
+                                         DocumentStatus status, 
+                                         const vector<int>& ratings) {
+    ScopedLatency latency{GetLatencyHistogram(SearchOperation::ADD_DOCUMENT)};
+    if (document_id < 0) {
+        return SearchError::INVALID_DOCUMENT_ID;
+    }
+    if (documents_->count(document_id) > 0) {
+        return SearchError::DUPLICATE_DOCUMENT_ID;
+    }
+    // spaces are valid, so the text is valid when all its words are
+    if (!IsValidWord(document)) {
+        return SearchError::INVALID_CHARACTERS;
+    }
     
     vector<string> words = SplitIntoWordsNoStop(document);   
         
     const double inv_word_count = 1.0 / words.size();
-    map<string_view, double> wordFrequencies;
+    auto wordFrequencies = allocate_shared<WordFrequencies>(
+                pmr::polymorphic_allocator<WordFrequencies>(
+                    &memory_->document_to_word));
     
+    WordPostings& word_to_document_freqs = word_to_document_freqs_.GetMutable();
     for (const string& word : words) {
-        const auto& w = unique_words_.insert(word);
-        word_to_document_freqs_[*w.first][document_id] += inv_word_count;
-        wordFrequencies[*w.first] = word_to_document_freqs_[*w.first][document_id];
+        const auto [own_word, is_new] = unique_words_.Insert(word);
+        if (is_new && fuzzy_index_->GetMaxDistance() > 0) {
+            fuzzy_index_.GetMutable().AddWord(own_word);
+        }
+        ++word_to_document_freqs[own_word].GetMutable()[document_id];
+        (*wordFrequencies)[own_word] += inv_word_count;
     }
     
-    documents_.emplace(document_id, 
-                       DocumentData{ComputeAverageRating(ratings), 
-                                    status});
+    const int rating = ComputeAverageRating(ratings);
+    documents_.GetMutable().emplace(document_id, 
+                                    DocumentData{rating, 
+                                                 status,
+                                                 static_cast<int>(words.size())});
+    document_columns_.GetMutable().Add(document_id, status, rating, 
+                                       static_cast<int>(words.size()));
+    total_word_count_ += words.size();
     
-    document_to_word_freqs_.emplace(document_id, wordFrequencies);
+    document_to_word_freqs_.GetMutable().emplace(document_id, 
+                                                 move(wordFrequencies));
+    
+    document_ids_.GetMutable().insert(document_id);        
+    
+    if (is_status_partitioning_enabled_) {
+        AddStatusPostings(document_id, status);
+    }
     
-    document_ids_.insert(document_id);        
+    if (is_duplicate_detection_enabled_) {
+        AddFingerprint(document_id);
+    }
+    if (is_positional_index_enabled_) {
+        // stop words are not stored, but take their positions
+        vector<pair<string_view, uint32_t>> positions;
+        uint32_t position = 0;
+        ForEachWordView(document, [this, &positions, &position](
+                        const string_view word) {
+            if (word.empty()) {
+                return;
+            }
+            if (!IsStopWord(word)) {
+                positions.emplace_back(unique_words_.Find(word), position);
+            }
+            ++position;
+        });
+        positional_index_.GetMutable().AddDocument(document_id, move(positions));
+    }
+    return {};
 }
 
 vector<Document> SearchServer::FindTopDocuments(
@@ -51,10 +264,39 @@ vector<Document> SearchServer::FindTopDocuments(
         DocumentStatus status) const {    
     return FindTopDocuments(
                 raw_query,
-                [status](int , 
-                DocumentStatus document_status, int ) {
-        return document_status == status;
-    });
+                StatusPredicate{status});
+}
+
+const vector<Document>& SearchServer::FindTopDocuments(
+        QueryContext& context,
+        const string_view raw_query, 
+        DocumentStatus status) const {    
+    return FindTopDocuments(
+                context,
+                raw_query,
+                StatusPredicate{status});
+}
+
+Expected<vector<Document>> SearchServer::FindTopDocuments(
+        nothrow_t,
+        const string_view raw_query, 
+        DocumentStatus status) const {    
+    return FindTopDocuments(
+                nothrow,
+                raw_query,
+                StatusPredicate{status});
+}
+
+Expected<const vector<Document>*> SearchServer::FindTopDocuments(
+        nothrow_t,
+        QueryContext& context,
+        const string_view raw_query, 
+        DocumentStatus status) const {    
+    return FindTopDocuments(
+                nothrow,
+                context,
+                raw_query,
+                StatusPredicate{status});
 }
 
 vector<Document> SearchServer::FindTopDocuments(
@@ -72,10 +314,7 @@ vector<Document> SearchServer::FindTopDocuments(
 {    
     return FindTopDocuments(policy,
                 raw_query,
-                [status](int , 
-                DocumentStatus document_status, int ) {
-        return document_status == status;
-    });
+                StatusPredicate{status});
 }
 
 vector<Document> SearchServer::FindTopDocuments(
@@ -99,43 +338,174 @@ vector<Document> SearchServer::FindTopDocuments(
     return FindTopDocuments(execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+DocumentPage SearchServer::FindDocumentsPage(
+        const string_view raw_query,
+        size_t page, size_t page_size,
+        DocumentStatus status) const
+{
+    return FindDocumentsPage(raw_query, page, page_size, StatusPredicate{status});
+}
+
+DocumentPage SearchServer::FindDocumentsPage(
+        const string_view raw_query,
+        const SearchCursor& after, size_t page_size,
+        DocumentStatus status) const
+{
+    return FindDocumentsPage(raw_query, after, page_size, StatusPredicate{status});
+}
+
+SearchServer::DocumentRange<TfIdfScorer, DocumentFilter> 
+    SearchServer::FindAllDocumentsRange(
+        const string_view raw_query,
+        DocumentStatus status) const
+{
+    // a filter of a single status reads its partition
+    DocumentFilter filter;
+    filter.statuses = StatusMask({status});
+    return FindAllDocumentsRange(raw_query, filter);
+}
+
+bool SearchServer::IsRankedBefore(const Document& lhs, const Document& rhs)
+{
+    // equality within EPSILON is not transitive, the selection and
+    // the cursor need a strict weak order
+    if (lhs.relevance != rhs.relevance) {
+        return lhs.relevance > rhs.relevance;
+    }
+    return lhs.rating > rhs.rating 
+            || (lhs.rating == rhs.rating && lhs.id < rhs.id);
+}
+
+SearchAwaitable<vector<Document>> SearchServer::FindTopDocumentsAsync(
+        const string_view raw_query,
+        DocumentStatus status,
+        stop_token stop_token) const
+{
+    return FindTopDocumentsAsync(
+                raw_query,
+                StatusPredicate{status}, move(stop_token));
+}
+
+SearchAwaitable<tuple<vector<string_view>, DocumentStatus>> 
+    SearchServer::MatchDocumentAsync(
+        const string_view raw_query, 
+        int document_id,
+        stop_token stop_token) const
+{
+    return SearchAwaitable<tuple<vector<string_view>, DocumentStatus>>{
+        SearchExecutor::Default(),
+        [this, query = string{raw_query}, document_id](
+                const std::stop_token&) {
+            return MatchDocument(query, document_id);
+        },
+        move(stop_token)};
+}
+
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return documents_->size();
 }
 
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(
         const string_view raw_query, int document_id) const { 
-    
-    if(0 == document_ids_.count(document_id))
-    {
-        throw out_of_range{"Document id in not exsist: " 
-                                + to_string(document_id)};
+    ThreadQueryContext context;
+    auto result = MatchDocument(nothrow, context.Get(), raw_query, document_id);
+    if (!result) {
+        if (result.GetError() == SearchError::DOCUMENT_NOT_FOUND) {
+            throw out_of_range{"Document id in not exsist: " 
+                                    + to_string(document_id)};
+        }
+        ThrowQueryError(result.GetError(), context.Get().invalid_word_);
     }
+    return move(*result);
+}
+
+Expected<tuple<vector<string_view>, DocumentStatus>> 
+    SearchServer::MatchDocument(
+        nothrow_t,
+        const string_view raw_query, int document_id) const { 
+    ThreadQueryContext context;
+    return MatchDocument(nothrow, context.Get(), raw_query, document_id);
+}
+
+Expected<tuple<vector<string_view>, DocumentStatus>> 
+    SearchServer::MatchDocument(
+        nothrow_t,
+        QueryContext& context,
+        const string_view raw_query, int document_id) const { 
+    ScopedLatency latency{GetLatencyHistogram(SearchOperation::MATCH_DOCUMENT)};
     
-    Query query{ParseQuery(raw_query)};        
+    const auto document = document_to_word_freqs_->find(document_id);
+    if (document == document_to_word_freqs_->end()) {
+        return SearchError::DOCUMENT_NOT_FOUND;
+    }
+    const DocumentStatus status = documents_->at(document_id).status;
+    if (IsBooleanSyntax(raw_query)) {
+        auto matched_words = MatchBooleanDocument(context, raw_query, document_id);
+        if (!matched_words) {
+            return matched_words.GetError();
+        }
+        return tuple{move(*matched_words), status};
+    }
+    if (const auto parsed = ParseQuery(nothrow, raw_query, context); !parsed) {
+        return parsed.GetError();
+    }
     
-    const map<string_view, double>& words_freqs{
-        document_to_word_freqs_.at(document_id)};
+    const WordFrequencies& words_freqs = *document->second;
+    const auto contains = [](const vector<string_view>& words, 
+                             const string_view word) {
+        return binary_search(words.begin(), words.end(), word);
+    };
     
-    for(const auto& [word, freq]: words_freqs)
-    {
-        if (find(query.minus_words.begin(), 
-                 query.minus_words.end(), word) != query.minus_words.end()) {
-            return {vector<string_view>{},
-                documents_.at(document_id).status};  
+    for (const auto& [word, freq] : words_freqs) {
+        if (contains(context.minus_words_, word)) {
+            return tuple{vector<string_view>{}, status};
         }
     }    
     
+    const FuzzyWords& fuzzy_words = context.fuzzy_words_;
+    const auto is_fuzzy_word = [&fuzzy_words](const string_view word) {
+        const auto it = lower_bound(fuzzy_words.begin(), fuzzy_words.end(), 
+                                    pair{word, 0});
+        return it != fuzzy_words.end() && it->first == word;
+    };
+    
+    if (match_mode_ == MatchMode::ALL) {
+        for (const string_view word : context.required_words_) {
+            if (words_freqs.count(word) == 0) {
+                return tuple{vector<string_view>{}, status};
+            }
+        }
+    }
+    
     vector<string_view> matched_words; 
-    for(const auto& [word, freq]: words_freqs)
-    {
-        if (find(query.plus_words.begin(), 
-                 query.plus_words.end(), word) != query.plus_words.end()) {
+    for (const auto& [word, freq] : words_freqs) {
+        if (contains(context.plus_words_, word) || is_fuzzy_word(word)) {
             matched_words.push_back(word);
         }
     }
     
-    return {matched_words, documents_.at(document_id).status};        
+    bool has_phrase = false;
+    for (const QueryPhrase& phrase : context.phrases_) {
+        if (!ContainsPhrase(context, phrase, document_id)) {
+            if (match_mode_ == MatchMode::ALL) {
+                return tuple{vector<string_view>{}, status};
+            }
+            continue;
+        }
+        has_phrase = true;
+        for (size_t i = 0; i < phrase.word_count; ++i) {
+            // the view of the index, not of the query
+            matched_words.push_back(words_freqs.find(
+                        context.phrase_words_[phrase.first_word + i].word)->first);
+        }
+    }
+    if (has_phrase) {
+        sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(unique(matched_words.begin(), matched_words.end()),
+                            matched_words.end());
+    }
+    
+    return tuple{move(matched_words), status};        
 }
 
 tuple<vector<string_view>, DocumentStatus> 
@@ -144,18 +514,25 @@ tuple<vector<string_view>, DocumentStatus>
         const string_view raw_query, 
         int document_id) const
 {    
-    if(0 == document_ids_.count(document_id))
+    // phrases, intersections and boolean queries are matched on 
+    // the sequential path only
+    if (raw_query.find('"') != string_view::npos 
+            || match_mode_ == MatchMode::ALL || IsBooleanSyntax(raw_query)) {
+        return MatchDocument(raw_query, document_id);
+    }
+    ScopedLatency latency{GetLatencyHistogram(SearchOperation::MATCH_DOCUMENT)};
+    if(0 == document_ids_->count(document_id))
     {
         throw out_of_range{"Document id in not exsist: " 
                                 + to_string(document_id)};
     }
     
-    const map<string_view, double>& words_freqs{
-        document_to_word_freqs_.at(document_id)};
+    const WordFrequencies& words_freqs{
+        *document_to_word_freqs_->at(document_id)};
     if(words_freqs.empty())
     {
         return {vector<string_view>{},
-            documents_.at(document_id).status};
+            documents_->at(document_id).status};
     }    
      
     QueryView query; 
@@ -173,7 +550,7 @@ tuple<vector<string_view>, DocumentStatus>
     
     if (is_minus) {
         return {vector<string_view>{}, 
-            documents_.at(document_id).status};
+            documents_->at(document_id).status};
     }   
     
     vector<string_view> matched_words(query.plus_words.size());
@@ -183,13 +560,20 @@ tuple<vector<string_view>, DocumentStatus>
              query.plus_words.begin(), query.plus_words.end(), 
              matched_words.begin(),
              checker);        
+    matched_words.erase(words_end, matched_words.end());
+    for (const auto& [word, distance] : query.fuzzy_words) {
+        if (checker(word)) {
+            matched_words.push_back(word);
+        }
+    }
+    words_end = matched_words.end();
     
     sort(policy, matched_words.begin(), words_end);
     words_end = unique(policy, matched_words.begin(), words_end);
     matched_words.erase(words_end, matched_words.end());
     
     return {matched_words,
-        documents_.at(document_id).status};
+        documents_->at(document_id).status};
 }
 
 tuple<vector<string_view>, DocumentStatus> 
@@ -203,35 +587,49 @@ tuple<vector<string_view>, DocumentStatus>
 
 void SearchServer::RemoveDocument(int document_id)
 {    
-    if(0 == document_ids_.count(document_id))
+    ScopedLatency latency{GetLatencyHistogram(SearchOperation::REMOVE_DOCUMENT)};
+    if(0 == document_ids_->count(document_id))
     {
         return;
     }
     
-    const map<string_view, double>& words_freqs{
-        document_to_word_freqs_.at(document_id)};
+    const WordFrequencies& words_freqs{
+        *document_to_word_freqs_->at(document_id)};
     
+    WordPostings& word_to_document_freqs = word_to_document_freqs_.GetMutable();
     for(auto&[word, freq]: words_freqs)
     {
-        word_to_document_freqs_[word].erase(document_id);  
+        const auto word_postings = word_to_document_freqs.find(word);
+        DocumentFreqs& document_freqs = word_postings->second.GetMutable();
+        document_freqs.erase(document_id);  
         
-        if(word_to_document_freqs_[word].empty())
+        if(document_freqs.empty())
         {
-            word_to_document_freqs_.erase(word);//удаляем, т.к. слово больше не нужно
+            word_to_document_freqs.erase(word_postings);//удаляем, т.к. слово больше не нужно
         }
     }
     
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+    if (is_status_partitioning_enabled_) {
+        RemoveStatusPostings(document_id, documents_->at(document_id).status);
+    }
+    RemoveFingerprint(document_id);
+    if (is_positional_index_enabled_) {
+        positional_index_.GetMutable().RemoveDocument(document_id);
+    }
+    total_word_count_ -= documents_->at(document_id).word_count;
+    document_columns_.GetMutable().Remove(document_id);
+    documents_.GetMutable().erase(document_id);
+    document_ids_.GetMutable().erase(document_id);
+    document_to_word_freqs_.GetMutable().erase(document_id);
 }
 
 void SearchServer::RemoveDocument(
         const execution::parallel_policy& policy, 
         int document_id)
 {
-    const map<string_view, double>& words_freqs{
-        document_to_word_freqs_.at(document_id)};
+    ScopedLatency latency{GetLatencyHistogram(SearchOperation::REMOVE_DOCUMENT)};
+    const WordFrequencies& words_freqs{
+        *document_to_word_freqs_->at(document_id)};
     if(!words_freqs.empty())
     {
         vector<string_view> words{words_freqs.size()};
@@ -244,18 +642,36 @@ void SearchServer::RemoveDocument(
             return wf.first;
         });
         
-        
-        auto trans = [this, document_id](const string_view& item)
+        // the outer maps are made own before the threads change
+        // the lists of the words, every list by one thread
+        WordPostings* word_to_document_freqs = &word_to_document_freqs_.GetMutable();
+        WordPostings* status_postings = is_status_partitioning_enabled_
+                ? &status_postings_[static_cast<size_t>(
+                        documents_->at(document_id).status)].GetMutable()
+                : nullptr;
+        auto trans = [document_id, word_to_document_freqs, status_postings](
+                const string_view& item)
         {
-            word_to_document_freqs_[item].erase(document_id);             
+            word_to_document_freqs->find(item)->second.GetMutable()
+                    .erase(document_id);             
+            // the words stay in the partition, as in the index
+            if (status_postings != nullptr) {
+                status_postings->find(item)->second.GetMutable().erase(document_id);
+            }
         };    
         
         for_each(policy, words.begin(), words.end(), trans);    
     }
     
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    document_to_word_freqs_.erase(document_id);
+    RemoveFingerprint(document_id);
+    if (is_positional_index_enabled_) {
+        positional_index_.GetMutable().RemoveDocument(document_id);
+    }
+    total_word_count_ -= documents_->at(document_id).word_count;
+    document_columns_.GetMutable().Remove(document_id);
+    documents_.GetMutable().erase(document_id);
+    document_ids_.GetMutable().erase(document_id);
+    document_to_word_freqs_.GetMutable().erase(document_id);
 }
 
 void SearchServer::RemoveDocument(
@@ -265,42 +681,337 @@ void SearchServer::RemoveDocument(
     RemoveDocument(document_id);
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(
+const SearchServer::WordFrequencies& SearchServer::GetWordFrequencies(
         int document_id) const
 {    
-    static map<string_view, double> empty_word_frequencies;
+    static const WordFrequencies empty_word_frequencies;
     
-    auto it = documents_.find(document_id);
-    if(it != documents_.end())
+    auto it = documents_->find(document_id);
+    if(it != documents_->end())
     {        
-        return document_to_word_freqs_.at(document_id);
+        return *document_to_word_freqs_->at(document_id);
     }
     
     return empty_word_frequencies;    
 }
 
-set<int>::iterator SearchServer::begin()
+void SearchServer::SetDuplicateDetection(bool enabled)
+{
+    if (enabled == is_duplicate_detection_enabled_) {
+        return;
+    }
+    is_duplicate_detection_enabled_ = enabled;
+    fingerprint_to_documents_ = 
+            CopyOnWrite<DocumentsByFingerprint>{&memory_->fingerprints};
+    if (enabled) {
+        for (const int document_id : *document_ids_) {
+            AddFingerprint(document_id);
+        }
+    }
+}
+
+bool SearchServer::IsDuplicateDetectionEnabled() const
+{
+    return is_duplicate_detection_enabled_;
+}
+
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status)
+{
+    const DocumentStatus old_status = documents_->at(document_id).status;
+    if (old_status == status) {
+        return;
+    }
+    if (is_status_partitioning_enabled_) {
+        WordPostings& from = status_postings_[
+                static_cast<size_t>(old_status)].GetMutable();
+        WordPostings& to = status_postings_[static_cast<size_t>(status)].GetMutable();
+        // the posting nodes are moved, no allocation but for a new word
+        // or a list shared with a copy
+        for (const auto& [word, freq] : *document_to_word_freqs_->at(document_id)) {
+            const auto from_word = from.find(word);
+            DocumentFreqs& from_postings = from_word->second.GetMutable();
+            to[word].GetMutable().insert(from_postings.extract(document_id));
+            if (from_postings.empty()) {
+                from.erase(from_word);
+            }
+        }
+    }
+    documents_.GetMutable().at(document_id).status = status;
+    document_columns_.GetMutable().SetStatus(document_id, status);
+}
+
+void SearchServer::SetStatusPartitioning(bool enabled)
+{
+    if (enabled == is_status_partitioning_enabled_) {
+        return;
+    }
+    is_status_partitioning_enabled_ = enabled;
+    status_postings_ = MakeStatusPostings(&memory_->status_postings);
+    if (enabled) {
+        for (const auto& [document_id, document_data] : *documents_) {
+            AddStatusPostings(document_id, document_data.status);
+        }
+    }
+}
+
+bool SearchServer::IsStatusPartitioningEnabled() const
+{
+    return is_status_partitioning_enabled_;
+}
+
+void SearchServer::SetScoringMode(ScoringMode mode)
+{
+    scoring_mode_ = mode;
+}
+
+ScoringMode SearchServer::GetScoringMode() const
+{
+    return scoring_mode_;
+}
+
+void SearchServer::SetMatchMode(MatchMode mode)
+{
+    match_mode_ = mode;
+}
+
+MatchMode SearchServer::GetMatchMode() const
+{
+    return match_mode_;
+}
+
+void SearchServer::SetQuerySyntax(QuerySyntax syntax)
+{
+    query_syntax_ = syntax;
+}
+
+QuerySyntax SearchServer::GetQuerySyntax() const
+{
+    return query_syntax_;
+}
+
+array<CopyOnWrite<SearchServer::WordPostings>, SearchServer::status_count_> 
+    SearchServer::MakeStatusPostings(pmr::memory_resource* resource)
+{
+    return {CopyOnWrite<WordPostings>{resource}, CopyOnWrite<WordPostings>{resource}, 
+            CopyOnWrite<WordPostings>{resource}, CopyOnWrite<WordPostings>{resource}};
+}
+
+void SearchServer::AddStatusPostings(int document_id, DocumentStatus status)
+{
+    WordPostings& postings = status_postings_[static_cast<size_t>(status)].GetMutable();
+    for (const auto& [word, freq] : *document_to_word_freqs_->at(document_id)) {
+        const uint32_t count = word_to_document_freqs_->at(word)->at(document_id);
+        // ids come in ascending order when the partitions are built
+        DocumentFreqs& document_freqs = postings[word].GetMutable();
+        document_freqs.emplace_hint(document_freqs.end(), document_id, count);
+    }
+}
+
+void SearchServer::RemoveStatusPostings(int document_id, DocumentStatus status)
+{
+    WordPostings& postings = status_postings_[static_cast<size_t>(status)].GetMutable();
+    for (const auto& [word, freq] : *document_to_word_freqs_->at(document_id)) {
+        const auto it = postings.find(word);
+        DocumentFreqs& document_freqs = it->second.GetMutable();
+        document_freqs.erase(document_id);
+        if (document_freqs.empty()) {
+            postings.erase(it);
+        }
+    }
+}
+
+void SearchServer::SetPositionalIndex(bool enabled)
+{
+    if (enabled == is_positional_index_enabled_) {
+        return;
+    }
+    if (enabled && !documents_->empty()) {
+        throw logic_error{"Positional index must be enabled before "
+                          "documents are added"};
+    }
+    is_positional_index_enabled_ = enabled;
+    positional_index_ = CopyOnWrite<PositionalIndex>{&memory_->positions};
+}
+
+bool SearchServer::IsPositionalIndexEnabled() const
 {
-    return document_ids_.begin();
+    return is_positional_index_enabled_;
 }
 
-set<int>::iterator SearchServer::end()
+void SearchServer::SetMaxPrefixExpansions(size_t max_expansions)
 {
-    return document_ids_.end();
+    max_prefix_expansions_ = max_expansions;
 }
 
-set<int>::const_iterator SearchServer::begin() const
+size_t SearchServer::GetMaxPrefixExpansions() const
 {
-    return document_ids_.cbegin();
+    return max_prefix_expansions_;
 }
 
-set<int>::const_iterator SearchServer::end() const
+void SearchServer::SetFuzzyMatching(const FuzzyMatchOptions& options)
 {
-    return document_ids_.cend();
+    if (!(options.penalty > 0.0 && options.penalty <= 1.0)) {
+        throw invalid_argument{"Fuzzy penalty must be in (0, 1]"};
+    }
+    if (options.max_distance != fuzzy_options_.max_distance) {
+        // a new index, rather than a copy of a shared one to clear
+        fuzzy_index_ = CopyOnWrite<FuzzyIndex>{&memory_->fuzzy};
+        FuzzyIndex& fuzzy_index = fuzzy_index_.GetMutable();
+        fuzzy_index.Reset(options.max_distance);
+        unique_words_.ForEach([&fuzzy_index](const string_view word) {
+            fuzzy_index.AddWord(word);
+        });
+    }
+    fuzzy_options_ = options;
+}
+
+const FuzzyMatchOptions& SearchServer::GetFuzzyMatching() const
+{
+    return fuzzy_options_;
+}
+
+optional<int> SearchServer::GetDuplicateOriginal(int document_id) const
+{
+    if (!is_duplicate_detection_enabled_) {
+        throw logic_error{"Duplicate detection is disabled"};
+    }
+    const auto it = documents_->find(document_id);
+    if (it == documents_->end()) {
+        throw out_of_range{"Document id in not exsist: " 
+                                + to_string(document_id)};
+    }
+    
+    const auto& words = *document_to_word_freqs_->at(document_id);
+    for (const int other_id : 
+         fingerprint_to_documents_->at(it->second.fingerprint)) {
+        if (other_id >= document_id) {
+            break;
+        }
+        if (HasSameTermSet(words, *document_to_word_freqs_->at(other_id))) {
+            return other_id;
+        }
+    }
+    return nullopt;
+}
+
+void SearchServer::SetLatencyStats(bool enabled)
+{
+    if (!enabled) {
+        latency_histograms_.reset();
+    } else if (!latency_histograms_) {
+        latency_histograms_ = make_shared<LatencyHistograms>();
+    }
+}
+
+bool SearchServer::IsLatencyStatsEnabled() const
+{
+    return latency_histograms_ != nullptr;
+}
+
+map<SearchOperation, LatencySummary> SearchServer::GetLatencyStats() const
+{
+    map<SearchOperation, LatencySummary> stats;
+    if (latency_histograms_) {
+        for (size_t i = 0; i < operation_count_; ++i) {
+            stats.emplace(static_cast<SearchOperation>(i), 
+                          (*latency_histograms_)[i].GetSummary());
+        }
+    }
+    return stats;
+}
+
+void SearchServer::ResetLatencyStats()
+{
+    if (latency_histograms_) {
+        for (LatencyHistogram& histogram : *latency_histograms_) {
+            histogram.Reset();
+        }
+    }
+}
+
+LatencyHistogram* SearchServer::GetLatencyHistogram(
+        SearchOperation operation) const
+{
+    if (!latency_histograms_) {
+        return nullptr;
+    }
+    return &(*latency_histograms_)[static_cast<size_t>(operation)];
+}
+
+void SearchServer::AddFingerprint(int document_id)
+{
+    DocumentData& document_data = documents_.GetMutable().at(document_id);
+    document_data.fingerprint = ComputeTermSetFingerprint(
+                *document_to_word_freqs_->at(document_id));
+    
+    pmr::vector<int>& same_fingerprint = 
+            fingerprint_to_documents_.GetMutable()[document_data.fingerprint];
+    same_fingerprint.insert(upper_bound(same_fingerprint.begin(), 
+                                        same_fingerprint.end(), 
+                                        document_id), 
+                            document_id);
+}
+
+void SearchServer::RemoveFingerprint(int document_id)
+{
+    if (!is_duplicate_detection_enabled_) {
+        return;
+    }
+    auto& fingerprint_to_documents = fingerprint_to_documents_.GetMutable();
+    const auto group = fingerprint_to_documents.find(
+                documents_->at(document_id).fingerprint);
+    pmr::vector<int>& same_fingerprint = group->second;
+    same_fingerprint.erase(lower_bound(same_fingerprint.begin(), 
+                                       same_fingerprint.end(), 
+                                       document_id));
+    if (same_fingerprint.empty()) {
+        fingerprint_to_documents.erase(group);
+    }
+}
+
+SearchServerMemoryUsage SearchServer::GetMemoryUsage() const
+{
+    SearchServerMemoryUsage usage;
+    usage.stop_words = memory_->stop_words.GetUsage();
+    usage.unique_words = memory_->unique_words.GetUsage();
+    usage.word_to_document_freqs = memory_->word_to_document.GetUsage();
+    usage.document_to_word_freqs = memory_->document_to_word.GetUsage();
+    usage.documents = memory_->documents.GetUsage();
+    usage.fingerprints = memory_->fingerprints.GetUsage();
+    usage.positions = memory_->positions.GetUsage();
+    usage.fuzzy_index = memory_->fuzzy.GetUsage();
+    usage.status_postings = memory_->status_postings.GetUsage();
+    usage.document_count = GetDocumentCount();
+    return usage;
+}
+
+pmr::memory_resource* SearchServer::GetMemoryResource() const
+{
+    return memory_->documents.GetUpstream();
+}
+
+SearchServer::DocumentIds::iterator SearchServer::begin()
+{
+    return document_ids_->begin();
+}
+
+SearchServer::DocumentIds::iterator SearchServer::end()
+{
+    return document_ids_->end();
+}
+
+SearchServer::DocumentIds::const_iterator SearchServer::begin() const
+{
+    return document_ids_->cbegin();
+}
+
+SearchServer::DocumentIds::const_iterator SearchServer::end() const
+{
+    return document_ids_->cend();
 }
 
 bool SearchServer::IsStopWord(const string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_->count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(const string_view word) {
@@ -335,58 +1046,577 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(string text) const {     
+Expected<SearchServer::QueryWordView> SearchServer::ParseQueryWord(
+        nothrow_t, string_view text) const
+{
     if (text.empty()) {
-        throw invalid_argument{text + " is empty"};
+        return SearchError::EMPTY_WORD;
     }
+    string_view word = text;
     bool is_minus = false;
-    if (text[0] == '-') {
+    if (word[0] == '-') {
         is_minus = true;
-        text = text.substr(1);
+        word = word.substr(1);
+    }
+    if (word.empty() || word[0] == '-') {
+        return SearchError::INVALID_MINUS_WORD;
     }
-    if (text.empty() || text[0] == '-' || !IsValidWord(text)) {
-        throw invalid_argument{text + " is invalid"};
+    if (!IsValidWord(word)) {
+        return SearchError::INVALID_CHARACTERS;
+    }
+    if (word.size() > 1 && word.back() == '*') {
+        return QueryWordView{word.substr(0, word.size() - 1), is_minus, false, true};
     }
     
-    return QueryWord{text, is_minus, IsStopWord(text)};
+    return QueryWordView{word, is_minus, IsStopWord(word), false};
 }
 
 SearchServer::QueryWordView SearchServer::ParseQueryWord(
         string_view text) const
 {
-    //LOG_DURATION(string{"ParseQueryWord"});
-    if (text.empty()) {
-        throw invalid_argument{string{text} + " is empty"};
+    const auto query_word = ParseQueryWord(nothrow, text);
+    if (!query_word) {
+        ThrowQueryError(query_word.GetError(), text);
     }
-    string_view word = text;
-    bool is_minus = false;
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
+    return *query_word;
+}
+
+void SearchServer::AddQueryWord(const QueryWordView& query_word, 
+                                vector<string_view>& words) const
+{
+    if (!query_word.is_prefix) {
+        words.push_back(query_word.data);
+        return;
+    }
+    // the indexed words with the prefix form a range of the sorted index,
+    // the expansions come from the index and outlive the query; a minus
+    // prefix excludes all of them
+    const string_view prefix = query_word.data;
+    const size_t max_expansions = query_word.is_minus 
+            ? numeric_limits<size_t>::max() : max_prefix_expansions_;
+    size_t expansion_count = 0;
+    for (auto it = word_to_document_freqs_->lower_bound(prefix);
+         it != word_to_document_freqs_->end() 
+             && expansion_count < max_expansions
+             && it->first.substr(0, prefix.size()) == prefix;
+         ++it) {
+        // the parallel removal leaves empty postings behind
+        if (!it->second->empty()) {
+            words.push_back(it->first);
+            ++expansion_count;
+        }
+    }
+}
+
+void SearchServer::AddFuzzyWords(const QueryWordView& query_word, 
+                                 FuzzyWords& fuzzy_words) const
+{
+    if (query_word.is_minus || query_word.is_prefix) {
+        return;
+    }
+    fuzzy_index_->FindCandidates(query_word.data, fuzzy_words);
+}
+
+void SearchServer::NormalizeFuzzyWords(const vector<string_view>& plus_words,
+                                       FuzzyWords& fuzzy_words)
+{
+    if (fuzzy_words.empty()) {
+        return;
+    }
+    sort(fuzzy_words.begin(), fuzzy_words.end());
+    fuzzy_words.erase(unique(fuzzy_words.begin(), fuzzy_words.end(),
+                             [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    }), fuzzy_words.end());
+    fuzzy_words.erase(remove_if(fuzzy_words.begin(), fuzzy_words.end(),
+                                [&plus_words](const auto& fuzzy_word) {
+        return binary_search(plus_words.begin(), plus_words.end(), 
+                             fuzzy_word.first);
+    }), fuzzy_words.end());
+}
+
+double SearchServer::GetFuzzyWeight(int distance) const
+{
+    return pow(fuzzy_options_.penalty, distance);
+}
+
+void SearchServer::ThrowQueryError(SearchError error, string_view word)
+{
+    if (error == SearchError::EMPTY_WORD) {
+        throw invalid_argument{string{word} + " is empty"};
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw invalid_argument{string{text} + " is invalid"};
+    if (error == SearchError::POSITIONAL_INDEX_DISABLED) {
+        throw invalid_argument{string{word} + " needs the positional index"};
+    }
+    throw invalid_argument{string{word} + " is invalid"};
+}
+
+Expected<void> SearchServer::ParseQuery(nothrow_t, const string_view text, 
+                                        QueryContext& context) const
+{
+    TRACE_SPAN("ParseQuery");
+    context.plus_words_.clear();
+    context.required_words_.clear();
+    context.minus_words_.clear();
+    context.fuzzy_words_.clear();
+    context.phrases_.clear();
+    context.phrase_words_.clear();
+    optional<SearchError> error;
+    // a phrase runs from a word starting with a quote to a word with
+    // the closing quote, which may be followed by ~N
+    const char* phrase_begin = nullptr;
+    uint32_t phrase_length = 0;
+    ForEachWordView(text, [&](const string_view token) {
+        const auto fail = [&](SearchError word_error, const char* begin) {
+            error = word_error;
+            context.invalid_word_ = string_view{
+                    begin, static_cast<size_t>(token.data() + token.size() - begin)};
+            return false;
+        };
+        
+        string_view word = token;
+        if (phrase_begin == nullptr) {
+            if (word.empty() || word[0] != '"') {
+                const auto query_word = ParseQueryWord(nothrow, word);
+                if (!query_word) {
+                    return fail(query_word.GetError(), token.data());
+                }
+                if (!query_word->is_stop) {
+                    AddQueryWord(*query_word, query_word->is_minus 
+                                     ? context.minus_words_ 
+                                     : context.plus_words_);
+                    AddFuzzyWords(*query_word, context.fuzzy_words_);
+                    if (!query_word->is_minus && !query_word->is_prefix) {
+                        context.required_words_.push_back(query_word->data);
+                    }
+                }
+                return true;
+            }
+            if (!is_positional_index_enabled_) {
+                return fail(SearchError::POSITIONAL_INDEX_DISABLED, token.data());
+            }
+            phrase_begin = token.data();
+            phrase_length = 0;
+            context.phrases_.push_back(QueryPhrase{
+                    context.phrase_words_.size(), 0, 0, true});
+            word.remove_prefix(1);
+        }
+        
+        const size_t quote = word.find('"');
+        const string_view suffix = quote == word.npos ? string_view{} 
+                                                      : word.substr(quote + 1);
+        word = word.substr(0, quote);
+        if (!word.empty()) {
+            const auto query_word = ParseQueryWord(nothrow, word);
+            if (!query_word) {
+                return fail(query_word.GetError(), phrase_begin);
+            }
+            if (query_word->is_minus || query_word->is_prefix) {
+                return fail(SearchError::INVALID_PHRASE, phrase_begin);
+            }
+            if (!query_word->is_stop) {
+                context.phrase_words_.push_back({word, phrase_length});
+            }
+            ++phrase_length;
+        } else if (token.empty()) {
+            return fail(SearchError::EMPTY_WORD, phrase_begin);
+        }
+        if (quote == word.npos) {
+            return true;
+        }
+        
+        QueryPhrase& phrase = context.phrases_.back();
+        uint32_t slop = 0;
+        if (!suffix.empty()) {
+            const auto [end, code] = from_chars(suffix.data() + 1, 
+                                                suffix.data() + suffix.size(), 
+                                                slop);
+            if (suffix[0] != '~' || suffix.size() == 1 || code != errc{}
+                    || end != suffix.data() + suffix.size()) {
+                return fail(SearchError::INVALID_PHRASE, phrase_begin);
+            }
+            phrase.is_exact = false;
+        }
+        if (phrase_length == 0) {
+            return fail(SearchError::INVALID_PHRASE, phrase_begin);
+        }
+        phrase.word_count = context.phrase_words_.size() - phrase.first_word;
+        phrase.max_span = phrase_length - 1 + slop;
+        if (phrase.word_count == 0) {
+            // only stop words, ignored as a stop word is
+            context.phrases_.pop_back();
+        }
+        phrase_begin = nullptr;
+        return true;
+    });
+    if (!error && phrase_begin != nullptr) {
+        error = SearchError::INVALID_PHRASE;
+        context.invalid_word_ = string_view{
+                phrase_begin, static_cast<size_t>(text.data() + text.size() 
+                                                  - phrase_begin)};
+    }
+    if (error) {
+        return *error;
     }
     
-    return QueryWordView{word, is_minus, IsStopWord(word)};
+    for (vector<string_view>* words : {&context.plus_words_, 
+                                       &context.required_words_,
+                                       &context.minus_words_}) {
+        sort(words->begin(), words->end());
+        words->erase(unique(words->begin(), words->end()), words->end());
+    }
+    NormalizeFuzzyWords(context.plus_words_, context.fuzzy_words_);
+    return {};
 }
 
-SearchServer::Query SearchServer::ParseQuery(
-        const string_view& text) const {     
-    Query result;
-    auto words{SplitIntoWordsView(text)};
-    for (const string_view& word : words) {
-        QueryWordView query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
-            } else {
-                result.plus_words.insert(query_word.data);
+const SearchServer::DocumentFreqs* SearchServer::FindPostings(
+        const WordPostings& postings, 
+        WordPostings::const_iterator word_postings) const
+{
+    if (&postings == &*word_to_document_freqs_) {
+        return &*word_postings->second;
+    }
+    const auto it = postings.find(word_postings->first);
+    if (it == postings.end() || it->second->empty()) {
+        return nullptr;
+    }
+    return &*it->second;
+}
+
+void SearchServer::LookupPostings(const vector<string_view>& words,
+                                  const WordPostings& postings,
+                                  vector<PostingCursor>& cursors) const
+{
+    TRACE_SPAN("TermLookup");
+    cursors.clear();
+    for (const string_view word : words) {
+        const auto it = word_to_document_freqs_->find(word);
+        if (it == word_to_document_freqs_->end() || it->second->empty()) {
+            continue;
+        }
+        const DocumentFreqs* word_postings = FindPostings(postings, it);
+        if (word_postings != nullptr) {
+            cursors.push_back(PostingCursor{
+                word_postings->begin(), word_postings->end(),
+                it->second->size(), 1.0, cursors.size(), no_phrase_,
+                word_postings});
+        }
+    }
+}
+
+void SearchServer::LookupFuzzyPostings(const FuzzyWords& fuzzy_words,
+                                       const WordPostings& postings,
+                                       vector<PostingCursor>& cursors) const
+{
+    for (const auto& [word, distance] : fuzzy_words) {
+        const auto it = word_to_document_freqs_->find(word);
+        if (it == word_to_document_freqs_->end() || it->second->empty()) {
+            continue;
+        }
+        const DocumentFreqs* word_postings = FindPostings(postings, it);
+        if (word_postings != nullptr) {
+            cursors.push_back(PostingCursor{
+                word_postings->begin(), word_postings->end(),
+                it->second->size(), GetFuzzyWeight(distance), cursors.size(),
+                no_phrase_, word_postings});
+        }
+    }
+}
+
+void SearchServer::LookupPhrasePostings(QueryContext& context, 
+                                        const WordPostings& postings) const
+{
+    vector<PostingCursor>& cursors = context.plus_cursors_;
+    for (size_t phrase_index = 0; phrase_index < context.phrases_.size(); 
+         ++phrase_index) {
+        QueryPhrase& phrase = context.phrases_[phrase_index];
+        const auto words_begin = context.phrase_words_.begin() + phrase.first_word;
+        const auto words_end = words_begin + phrase.word_count;
+        const size_t first_cursor = cursors.size();
+        for (auto it = words_begin; it != words_end; ++it) {
+            const bool is_repeated = any_of(words_begin, it, 
+                                            [it](const PhraseWord& other) {
+                return other.word == it->word;
+            });
+            if (is_repeated) {
+                continue;
+            }
+            const auto word_it = word_to_document_freqs_->find(it->word);
+            const DocumentFreqs* word_postings = 
+                    word_it == word_to_document_freqs_->end() 
+                        || word_it->second->empty()
+                    ? nullptr : FindPostings(postings, word_it);
+            if (word_postings == nullptr) {
+                cursors.resize(first_cursor);
+                break;
             }
+            cursors.push_back(PostingCursor{
+                word_postings->begin(), word_postings->end(),
+                word_it->second->size(), 1.0, cursors.size(), phrase_index,
+                word_postings});
         }
-    }    
+        phrase.cursor_count = cursors.size() - first_cursor;
+        phrase.hit_count = 0;
+        phrase.relevance = 0.0;
+    }
+}
+
+bool SearchServer::ContainsPhrase(QueryContext& context, 
+                                  const QueryPhrase& phrase, 
+                                  int document_id) const
+{
+    context.positions_.clear();
+    context.phrase_positions_.clear();
+    const auto words_begin = context.phrase_words_.begin() + phrase.first_word;
+    const auto words_end = words_begin + phrase.word_count;
+    for (auto it = words_begin; it != words_end; ++it) {
+        const auto is_same_word = [it](const PhraseWord& other) {
+            return other.word == it->word;
+        };
+        // a window needs every distinct word once, at as many positions
+        // as the phrase repeats it
+        uint32_t count = 1;
+        if (!phrase.is_exact) {
+            if (any_of(words_begin, it, is_same_word)) {
+                continue;
+            }
+            count = static_cast<uint32_t>(count_if(it, words_end, is_same_word));
+        }
+        const size_t begin = context.positions_.size();
+        if (positional_index_->DecodePositions(document_id, it->word, 
+                                              context.positions_) == 0) {
+            return false;
+        }
+        context.phrase_positions_.push_back(PhrasePositions{
+                begin, context.positions_.size(), it->offset, count});
+    }
+    return phrase.is_exact 
+            ? HasPhrase(context.positions_, context.phrase_positions_)
+            : HasProximity(context.positions_, context.phrase_positions_, 
+                           phrase.max_span);
+}
+
+bool SearchServer::IsBooleanSyntax(string_view raw_query) const
+{
+    return query_syntax_ == QuerySyntax::BOOLEAN && IsBooleanQuery(raw_query);
+}
+
+Expected<unique_ptr<PostingIterator>> SearchServer::CompileQuery(
+        const BooleanQueryNode& node, const WordPostings& postings,
+        vector<TermIterator*>& terms, string_view& invalid_word, 
+        const bool is_excluded) const
+{
+    if (node.IsWord()) {
+        auto query_word = ParseQueryWord(nothrow, node.word);
+        if (!query_word) {
+            invalid_word = node.word;
+            return query_word.GetError();
+        }
+        if (query_word->is_stop) {
+            return unique_ptr<PostingIterator>{};
+        }
+        // a prefix matches any of its expansions, all of them when excluded
+        query_word->is_minus = is_excluded;
+        vector<string_view> words;
+        AddQueryWord(*query_word, words);
+        vector<unique_ptr<PostingIterator>> iterators;
+        for (const string_view word : words) {
+            const auto it = word_to_document_freqs_->find(word);
+            if (it == word_to_document_freqs_->end() || it->second->empty()) {
+                continue;
+            }
+            const DocumentFreqs* word_postings = FindPostings(postings, it);
+            if (word_postings != nullptr) {
+                auto term = make_unique<TermIterator>(it->first, *word_postings, 
+                                                      it->second->size());
+                terms.push_back(term.get());
+                iterators.push_back(move(term));
+            }
+        }
+        return MakeDisjunction(move(iterators));
+    }
+    
+    const size_t first_term = terms.size();
+    vector<unique_ptr<PostingIterator>> required;
+    vector<unique_ptr<PostingIterator>> optional;
+    vector<unique_ptr<PostingIterator>> excluded;
+    for (const auto& [nodes, iterators] : {pair{&node.required, &required},
+                                           pair{&node.optional, &optional},
+                                           pair{&node.excluded, &excluded}}) {
+        for (const BooleanQueryNode& child : *nodes) {
+            auto iterator = CompileQuery(child, postings, terms, invalid_word,
+                                         is_excluded || nodes == &node.excluded);
+            if (!iterator) {
+                return iterator.GetError();
+            }
+            // a clause of stop words is ignored, as a stop word is
+            if (*iterator != nullptr) {
+                iterators->push_back(move(*iterator));
+            }
+        }
+    }
+    
+    unique_ptr<PostingIterator> documents;
+    if (!required.empty() && !optional.empty()) {
+        documents = make_unique<OptionalIterator>(MakeConjunction(move(required)), 
+                                                  MakeDisjunction(move(optional)));
+    } else if (!required.empty()) {
+        documents = MakeConjunction(move(required));
+    } else if (!optional.empty()) {
+        documents = MakeDisjunction(move(optional));
+    } else if (!excluded.empty()) {
+        // the terms of the excluded clauses go with them
+        terms.resize(first_term);
+        return unique_ptr<PostingIterator>{make_unique<EmptyIterator>()};
+    } else {
+        return unique_ptr<PostingIterator>{};
+    }
+    if (!excluded.empty()) {
+        documents = make_unique<ExclusionIterator>(move(documents), 
+                                                   MakeDisjunction(move(excluded)));
+    }
+    return documents;
+}
+
+Expected<unique_ptr<PostingIterator>> SearchServer::CompileQuery(
+        QueryContext& context, const string_view raw_query,
+        const WordPostings& postings, vector<TermIterator*>& terms) const
+{
+    if (IsBooleanSyntax(raw_query)) {
+        const auto query = ParseBooleanQuery(raw_query, 
+                                             match_mode_ == MatchMode::ALL,
+                                             context.invalid_word_);
+        if (!query) {
+            return query.GetError();
+        }
+        auto documents = CompileQuery(*query, postings, terms, 
+                                      context.invalid_word_);
+        if (documents) {
+            SortTerms(terms);
+        }
+        return documents;
+    }
+    if (const auto parsed = ParseQuery(nothrow, raw_query, context); !parsed) {
+        return parsed.GetError();
+    }
+    if (!context.phrases_.empty()) {
+        const QueryPhrase& phrase = context.phrases_.front();
+        context.invalid_word_ = context.phrase_words_[phrase.first_word].word;
+        return SearchError::INVALID_QUERY;
+    }
+    return CompilePlainQuery(context, postings, terms);
+}
+
+unique_ptr<PostingIterator> SearchServer::CompilePlainQuery(
+        const QueryContext& context, const WordPostings& postings,
+        vector<TermIterator*>& terms) const
+{
+    // the terms are numbered as the cursors of the merge are
+    const auto add_term = [&](string_view word, double word_weight,
+                              vector<unique_ptr<PostingIterator>>& iterators) {
+        const auto it = word_to_document_freqs_->find(word);
+        if (it == word_to_document_freqs_->end() || it->second->empty()) {
+            return false;
+        }
+        const DocumentFreqs* word_postings = FindPostings(postings, it);
+        if (word_postings == nullptr) {
+            return false;
+        }
+        auto term = make_unique<TermIterator>(it->first, *word_postings, 
+                                              it->second->size());
+        term->word_weight = word_weight;
+        term->word_index = terms.size();
+        terms.push_back(term.get());
+        iterators.push_back(move(term));
+        return true;
+    };
     
-    return result;
+    const size_t first_term = terms.size();
+    const bool is_intersection = match_mode_ == MatchMode::ALL 
+            && !context.required_words_.empty();
+    vector<unique_ptr<PostingIterator>> required;
+    vector<unique_ptr<PostingIterator>> optional;
+    vector<unique_ptr<PostingIterator>> excluded;
+    for (const string_view word : context.plus_words_) {
+        const bool is_required = is_intersection 
+                && binary_search(context.required_words_.begin(), 
+                                 context.required_words_.end(), word);
+        if (!add_term(word, 1.0, is_required ? required : optional) 
+                && is_required) {
+            terms.resize(first_term);
+            return make_unique<EmptyIterator>();
+        }
+    }
+    for (const auto& [word, distance] : context.fuzzy_words_) {
+        add_term(word, GetFuzzyWeight(distance), optional);
+    }
+    if (required.empty() && optional.empty()) {
+        return context.plus_words_.empty() && context.fuzzy_words_.empty() 
+                ? nullptr : make_unique<EmptyIterator>();
+    }
+    for (const string_view word : context.minus_words_) {
+        add_term(word, 1.0, excluded);
+    }
+    
+    unique_ptr<PostingIterator> documents;
+    if (required.empty()) {
+        documents = MakeDisjunction(move(optional));
+    } else if (optional.empty()) {
+        documents = MakeConjunction(move(required));
+    } else {
+        documents = make_unique<OptionalIterator>(MakeConjunction(move(required)), 
+                                                  MakeDisjunction(move(optional)));
+    }
+    if (!excluded.empty()) {
+        documents = make_unique<ExclusionIterator>(move(documents), 
+                                                   MakeDisjunction(move(excluded)));
+    }
+    return documents;
+}
+
+void SearchServer::SortTerms(vector<TermIterator*>& terms)
+{
+    sort(terms.begin(), terms.end(), [](const TermIterator* lhs, 
+                                        const TermIterator* rhs) {
+        return lhs->GetWord() < rhs->GetWord();
+    });
+    for (size_t i = 0; i < terms.size(); ++i) {
+        terms[i]->word_index = i == 0 ? 0 : terms[i - 1]->word_index 
+                + (terms[i - 1]->GetWord() != terms[i]->GetWord());
+    }
+}
+
+Expected<vector<string_view>> SearchServer::MatchBooleanDocument(
+        QueryContext& context, const string_view raw_query, int document_id) const
+{
+    const auto query = ParseBooleanQuery(raw_query, match_mode_ == MatchMode::ALL,
+                                         context.invalid_word_);
+    if (!query) {
+        return query.GetError();
+    }
+    vector<TermIterator*> terms;
+    auto root = CompileQuery(*query, *word_to_document_freqs_, terms, 
+                             context.invalid_word_);
+    if (!root) {
+        return root.GetError();
+    }
+    vector<string_view> matched_words;
+    if (*root == nullptr) {
+        return matched_words;
+    }
+    PostingIterator& documents = **root;
+    documents.Advance(document_id);
+    if (documents.GetDocumentId() == document_id) {
+        vector<const TermIterator*> document_terms;
+        documents.CollectTerms(document_terms);
+        for (const TermIterator* term : document_terms) {
+            matched_words.push_back(term->GetWord());
+        }
+        sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(unique(matched_words.begin(), matched_words.end()),
+                            matched_words.end());
+    }
+    return matched_words;
 }
 
 vector<string_view> SortUniq(const execution::parallel_policy& policy,
@@ -403,6 +1633,7 @@ void SearchServer::ParseQuery(
         const execution::parallel_policy& policy,
         const string_view& text, QueryView& out) const
 {
+    TRACE_SPAN("ParseQuery");
     auto words{SplitIntoWordsView(text)};
     
     for (const string_view& word : words) {
@@ -410,14 +1641,16 @@ void SearchServer::ParseQuery(
         
         if (!query_word.is_stop) {
             if (query_word.is_minus) {                
-                out.minus_words.push_back(query_word.data);                         
+                AddQueryWord(query_word, out.minus_words);                         
             } else {                
-                out.plus_words.push_back(query_word.data);                
+                AddQueryWord(query_word, out.plus_words);                
+                AddFuzzyWords(query_word, out.fuzzy_words);
             }
         }
     }    
     out.minus_words = SortUniq(policy, out.minus_words);
     out.plus_words = SortUniq(policy, out.plus_words);
+    NormalizeFuzzyWords(out.plus_words, out.fuzzy_words);
 }
 
 vector<string_view> SortUniq(const execution::sequenced_policy& policy,
@@ -435,6 +1668,7 @@ void SearchServer::ParseQuery(
         const string_view& text, 
         QueryView& out) const
 {
+    TRACE_SPAN("ParseQuery");
     auto words{SplitIntoWordsView(text)};    
     //код для сдачи
     for (const string_view& word : words) {
@@ -442,22 +1676,96 @@ void SearchServer::ParseQuery(
         
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                out.minus_words.push_back(query_word.data);
+                AddQueryWord(query_word, out.minus_words);
             } else {
-                out.plus_words.push_back(query_word.data);
+                AddQueryWord(query_word, out.plus_words);
+                AddFuzzyWords(query_word, out.fuzzy_words);
             }
         }
     } 
     
     out.minus_words = SortUniq(policy, out.minus_words);
     out.plus_words = SortUniq(policy, out.plus_words);
+    NormalizeFuzzyWords(out.plus_words, out.fuzzy_words);
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(
-        const string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::GetAverageWordCount() const {
+    if (documents_->empty()) {
+        return 0.0;
+    }
+    return static_cast<double>(total_word_count_) / documents_->size();
 }
 
 
 
 
+
+namespace {
+
+thread_local bool is_thread_query_context_lent{false};
+
+} // namespace
+
+SearchServer::ThreadQueryContext::ThreadQueryContext()
+{
+    thread_local QueryContext thread_context;
+    if (is_thread_query_context_lent) {
+        own_context_ = make_unique<QueryContext>();
+        context_ = own_context_.get();
+    } else {
+        is_thread_query_context_lent = true;
+        context_ = &thread_context;
+    }
+}
+
+SearchServer::ThreadQueryContext::~ThreadQueryContext()
+{
+    if (!own_context_) {
+        is_thread_query_context_lent = false;
+    }
+}
+
+SearchServer::QueryContext& SearchServer::ThreadQueryContext::Get()
+{
+    return *context_;
+}
+
+MemoryUsage SearchServerMemoryUsage::GetTotal() const
+{
+    MemoryUsage total;
+    total += stop_words;
+    total += unique_words;
+    total += word_to_document_freqs;
+    total += document_to_word_freqs;
+    total += documents;
+    total += fingerprints;
+    total += positions;
+    total += fuzzy_index;
+    total += status_postings;
+    return total;
+}
+
+ostream& operator<<(ostream& os, const SearchServerMemoryUsage& usage)
+{
+    const auto print = [&os](string_view name, const MemoryUsage& item) {
+        os << name << ": "s << item.bytes << " bytes in "s 
+           << item.allocations << " allocations\n"s;
+    };
+    print("stop words"sv, usage.stop_words);
+    print("unique words"sv, usage.unique_words);
+    print("word to document freqs"sv, usage.word_to_document_freqs);
+    print("document to word freqs"sv, usage.document_to_word_freqs);
+    print("documents"sv, usage.documents);
+    print("fingerprints"sv, usage.fingerprints);
+    print("positions"sv, usage.positions);
+    print("fuzzy index"sv, usage.fuzzy_index);
+    print("status postings"sv, usage.status_postings);
+    
+    const MemoryUsage total = usage.GetTotal();
+    print("total"sv, total);
+    if (usage.document_count > 0) {
+        os << "bytes per document: "s 
+           << total.bytes / usage.document_count << "\n"s;
+    }
+    return os;
+}
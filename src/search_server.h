@@ -4,31 +4,177 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <optional>
+#include <memory>
+#include <array>
+#include <unordered_map>
 #include <execution>
 #include <type_traits>
 #include <iterator>
 #include <thread>
 #include <string_view>
+#include <stop_token>
+#include <memory_resource>
+#include <new>
+#include <limits>
+#include <bit>
 
+#include "async_search.h"
+#include "boolean_query.h"
+#include "copy_on_write.h"
 #include "document.h"
+#include "document_filter.h"
+#include "fuzzy_index.h"
+#include "latency_histogram.h"
+#include "memory_accounting.h"
+#include "positional_index.h"
+#include "posting_iterator.h"
+#include "query_trace.h"
+#include "scorer.h"
+#include "scoring_kernel.h"
+#include "search_error.h"
+#include "search_page.h"
 #include "string_processing.h"
+#include "word_store.h"
 #include "concurrent_map.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
+const size_t MAX_PREFIX_EXPANSIONS = 64;
 
+// Operations measured by SearchServer latency statistics
+enum class SearchOperation {
+    ADD_DOCUMENT,
+    FIND_TOP_DOCUMENTS_SEQ,
+    // parallel FindTopDocuments calls; those which fall back to the
+    // sequential path (phrases, MatchMode::ALL, boolean queries) count
+    // as FIND_TOP_DOCUMENTS_SEQ
+    FIND_TOP_DOCUMENTS_PAR,
+    MATCH_DOCUMENT,
+    REMOVE_DOCUMENT,
+};
+
+// Live heap memory of the SearchServer index structures
+struct SearchServerMemoryUsage {
+    MemoryUsage stop_words;
+    MemoryUsage unique_words;
+    MemoryUsage word_to_document_freqs;
+    MemoryUsage document_to_word_freqs;
+    // documents data and ids
+    MemoryUsage documents;
+    MemoryUsage fingerprints;
+    MemoryUsage positions;
+    MemoryUsage fuzzy_index;
+    MemoryUsage status_postings;
+    int document_count{0};
+    
+    MemoryUsage GetTotal() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const SearchServerMemoryUsage& usage);
+
+struct FuzzyMatchOptions {
+    // 0 disables fuzzy matching, at most 2
+    int max_distance{0};
+    // the relevance of a word at the distance d is multiplied by penalty^d
+    double penalty{0.5};
+};
+
+
+// How the sequential FindTopDocuments sums the relevance of the documents
+enum class ScoringMode {
+    // document at a time, merging the postings of the query words
+    MERGE,
+    // word at a time: the postings are decoded in blocks, scored by SIMD
+    // kernels and added to an accumulator per document; the relevance
+    // is the same as with MERGE
+    ACCUMULATE,
+    // ACCUMULATE with term frequencies, scores and the accumulator in
+    // single precision, so the relevance differs in the last digits
+    // and documents closer than that may change places
+    ACCUMULATE_FLOAT,
+};
+
+// Which documents the plus words of a query select
+enum class MatchMode {
+    // the documents with any of the plus words
+    ANY,
+    // the documents with every plain plus word and every phrase; prefix
+    // expansions and fuzzy variants add to the relevance without being
+    // required. A query with neither plain plus words nor phrases
+    // matches as with ANY.
+    ALL,
+};
+
+// How the sequential FindTopDocuments and MatchDocument read a query
+enum class QuerySyntax {
+    // words, -words, prefixes and phrases
+    PLAIN,
+    // a query with parentheses, AND, OR, NOT or +words is parsed by
+    // ParseBooleanQuery and compiled into a tree of PostingIterator;
+    // other queries are read as PLAIN ones
+    BOOLEAN,
+};
 
 class SearchServer {
 public:    
+    using WordFrequencies = std::pmr::map<std::string_view, double>;
+    using DocumentIds = std::pmr::set<int>;
+    
+    // Every index structure is allocated from the resource (through its
+    // own accounting resource), so the index can live in a monotonic,
+    // pool or per-shard arena. The resource must outlive the server and
+    // its copies, and be thread-safe when the parallel RemoveDocument is
+    // used, as it frees postings from several threads at once, or when
+    // copies sharing it change on different threads.
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
-    explicit SearchServer(const std::string_view stop_words_text);
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(const StringContainer& stop_words,
+                          std::pmr::memory_resource* resource 
+                              = std::pmr::get_default_resource());
+    explicit SearchServer(const std::string_view stop_words_text,
+                          std::pmr::memory_resource* resource 
+                              = std::pmr::get_default_resource());
+    explicit SearchServer(const std::string& stop_words_text,
+                          std::pmr::memory_resource* resource 
+                              = std::pmr::get_default_resource());
+    
+    // A copy is a snapshot which shares the index with other in O(1).
+    // When either of them changes, the change copies only the structures
+    // it touches: the outer maps of pointers and the posting lists of
+    // the words of the document. The outer structures are copied in full,
+    // so the first change after a copy is O(N + V) for N documents and
+    // V words: the documents, the columns, the ids, the forward index,
+    // the map of posting lists and, on a new word, the set of the words.
+    // The changes after it are in place until the next copy. The views
+    // of a copy stay valid while it lives, whatever happens to other.
+    // The copies share the memory resources, and GetMemoryUsage counts
+    // the memory of all of them. They share the latency histograms too:
+    // a copy records into those of other, and the stats of either are
+    // those of both until one of them disables them.
+    SearchServer(const SearchServer& other);
+    // A deep copy allocated from the resource, which shares nothing
+    SearchServer(const SearchServer& other, std::pmr::memory_resource* resource);
+    // A moved-from server may only be assigned to or destroyed
+    SearchServer(SearchServer&& other);
+    // The assignments swap with a copy, so the old index is released
+    // after the structures allocated from its resources
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer& operator=(SearchServer&& other);
 
     void AddDocument(int document_id, 
                      const std::string_view document, 
                      DocumentStatus status,
                      const std::vector<int>& ratings);
+    
+    // The std::nothrow overloads report invalid input by the error of the
+    // result instead of throwing std::invalid_argument or std::out_of_range,
+    // and do not allocate on the error path. std::bad_alloc and exceptions
+    // of a predicate still propagate.
+    Expected<void> AddDocument(std::nothrow_t,
+                               int document_id, 
+                               const std::string_view document, 
+                               DocumentStatus status,
+                               const std::vector<int>& ratings);
 
     
     template <typename DocumentPredicate>
@@ -73,7 +219,148 @@ public:
     std::vector<Document> FindTopDocuments(
             const std::string_view raw_query) const;
 
+    // Scratch memory of the sequential query path: parsed words, posting
+    // cursors and results. Once its buffers have grown to the largest
+    // query, a query through the context performs no heap allocation.
+    // A context serves one query at a time, the overloads without one
+    // use a context of the calling thread.
+    class QueryContext;
+    
+    // The results stay in the context until its next query
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(
+            QueryContext& context,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    const std::vector<Document>& FindTopDocuments(
+            QueryContext& context,
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    
+    template <typename DocumentPredicate>
+    Expected<std::vector<Document>> FindTopDocuments(
+            std::nothrow_t,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    Expected<std::vector<Document>> FindTopDocuments(
+            std::nothrow_t,
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    
+    // Points to the results in the context
+    template <typename DocumentPredicate>
+    Expected<const std::vector<Document>*> FindTopDocuments(
+            std::nothrow_t,
+            QueryContext& context,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    Expected<const std::vector<Document>*> FindTopDocuments(
+            std::nothrow_t,
+            QueryContext& context,
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    
+    // Relevance by the scorer (BM25, ...) instead of TF-IDF, which is
+    // what the overloads without one use
+    template <Scorer ScorerType, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    template <Scorer ScorerType>
+    std::vector<Document> FindTopDocuments(
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    template <Scorer ScorerType, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+            const std::execution::parallel_policy& policy,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    template <Scorer ScorerType, typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    template <Scorer ScorerType>
+    const std::vector<Document>& FindTopDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    
+    // Page number page, counted from 0, of the matched documents by
+    // relevance, rating and id. The relevances compare exactly, so
+    // the documents FindTopDocuments takes for ties within EPSILON may come
+    // in another order. Only the documents down to the end of the page are
+    // selected, and only those of the page sorted.
+    // Throws std::invalid_argument for a page_size of 0.
+    template <typename DocumentPredicate>
+    DocumentPage FindDocumentsPage(
+            const std::string_view raw_query,
+            size_t page, size_t page_size,
+            DocumentPredicate document_predicate) const;
+    DocumentPage FindDocumentsPage(
+            const std::string_view raw_query,
+            size_t page, size_t page_size,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    // The page of the documents ranked after the cursor
+    template <typename DocumentPredicate>
+    DocumentPage FindDocumentsPage(
+            const std::string_view raw_query,
+            const SearchCursor& after, size_t page_size,
+            DocumentPredicate document_predicate) const;
+    DocumentPage FindDocumentsPage(
+            const std::string_view raw_query,
+            const SearchCursor& after, size_t page_size,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    
+    // All the matched documents in ascending order of ids, with
+    // the relevance FindTopDocuments gives them. The range finds them one
+    // at a time as it is iterated, walking the postings through a tree
+    // of PostingIterator, so its memory does not grow with the matches
+    // and a break ends the search. The range is single pass, the index
+    // must not change while it is in use. Phrases are not supported:
+    // std::invalid_argument as for an invalid query.
+    template <Scorer ScorerType, typename DocumentPredicate>
+    class DocumentRange;
+    
+    template <typename DocumentPredicate>
+    DocumentRange<TfIdfScorer, DocumentPredicate> FindAllDocumentsRange(
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
+    DocumentRange<TfIdfScorer, DocumentFilter> FindAllDocumentsRange(
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL) const;
+    template <Scorer ScorerType, typename DocumentPredicate>
+    DocumentRange<ScorerType, DocumentPredicate> FindAllDocumentsRange(
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate) const;
     
+    // Awaitable versions of FindTopDocuments and MatchDocument, executed
+    // on SearchExecutor::Default(). The query is copied, the server must
+    // outlive the request. When stop is requested the scoring is abandoned
+    // and OperationCancelled is thrown from co_await.
+    template <typename DocumentPredicate>
+    SearchAwaitable<std::vector<Document>> FindTopDocumentsAsync(
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            std::stop_token stop_token = {}) const;
+
+    SearchAwaitable<std::vector<Document>> FindTopDocumentsAsync(
+            const std::string_view raw_query,
+            DocumentStatus status = DocumentStatus::ACTUAL,
+            std::stop_token stop_token = {}) const;
+
+    SearchAwaitable<std::tuple<std::vector<std::string_view>, DocumentStatus>>
+        MatchDocumentAsync(
+            const std::string_view raw_query, int document_id,
+            std::stop_token stop_token = {}) const;
+
     int GetDocumentCount() const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
@@ -84,6 +371,12 @@ public:
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(
             const std::execution::sequenced_policy& policy,
             const std::string_view raw_query, int document_id) const;
+    Expected<std::tuple<std::vector<std::string_view>, DocumentStatus>> 
+        MatchDocument(std::nothrow_t,
+                      const std::string_view raw_query, int document_id) const;
+    Expected<std::tuple<std::vector<std::string_view>, DocumentStatus>> 
+        MatchDocument(std::nothrow_t, QueryContext& context,
+                      const std::string_view raw_query, int document_id) const;
     
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::parallel_policy& policy, 
@@ -91,28 +384,228 @@ public:
     void RemoveDocument(const std::execution::sequenced_policy& policy, 
                         int document_id); 
     
-    const std::map<std::string_view, double>& GetWordFrequencies(
-            int document_id) const;
+    // Throws std::out_of_range for an unknown document
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+    
+    const WordFrequencies& GetWordFrequencies(int document_id) const;
+    
+    // Bytes and allocations of every index structure, counted by
+    // the memory resources the structures allocate from
+    SearchServerMemoryUsage GetMemoryUsage() const;
+    std::pmr::memory_resource* GetMemoryResource() const;
+    
+    // When enabled, AddDocument fingerprints the set of words of every new
+    // document, so a duplicate is detected at insertion time in O(words)
+    void SetDuplicateDetection(bool enabled);
+    bool IsDuplicateDetectionEnabled() const;
+    
+    // Lowest id of a document with the same set of words if it is lower
+    // than document_id. Requires duplicate detection to be enabled.
+    std::optional<int> GetDuplicateOriginal(int document_id) const;
+    
+    // When enabled, AddDocument stores the token positions of the words,
+    // which quoted phrase ("red cat") and proximity ("red cat"~N, all
+    // the words within N extra tokens in any order) queries require.
+    // Positions are not kept while disabled, so the index must be enabled
+    // before the first document is added; std::logic_error otherwise.
+    void SetPositionalIndex(bool enabled);
+    bool IsPositionalIndexEnabled() const;
+    
+    // A query word ending with '*' (prog*, -prog*) stands for the indexed
+    // words with the prefix, at most max_expansions of them in dictionary
+    // order; each one counts as a query word of its own. A minus prefix
+    // excludes all the words with the prefix.
+    void SetMaxPrefixExpansions(size_t max_expansions);
+    size_t GetMaxPrefixExpansions() const;
+    
+    // With a positive max_distance every plus word of a query also matches
+    // the indexed words within that Levenshtein distance, with a penalty.
+    // Enabling builds a symmetric-delete index of all the words, which
+    // AddDocument keeps up to date; disabling frees it. Throws
+    // std::invalid_argument for a distance out of [0, 2] or a penalty
+    // out of (0, 1].
+    void SetFuzzyMatching(const FuzzyMatchOptions& options);
+    const FuzzyMatchOptions& GetFuzzyMatching() const;
+    
+    // When enabled, the postings are also kept in a partition per document
+    // status, so a query filtered by a status (the ACTUAL default included)
+    // visits the documents with that status only; other predicates still
+    // scan the whole index. SetDocumentStatus moves the postings of the
+    // document between the partitions. Enabling builds the partitions
+    // from the index, disabling frees them.
+    void SetStatusPartitioning(bool enabled);
+    bool IsStatusPartitioningEnabled() const;
+    
+    // Phrase queries are always scored with MERGE
+    void SetScoringMode(ScoringMode mode);
+    ScoringMode GetScoringMode() const;
+    
+    // With ALL the postings of the required words are intersected from
+    // the shortest one and only the documents in all of them are scored,
+    // whatever the scoring mode. The parallel overloads run such queries
+    // on the sequential path.
+    void SetMatchMode(MatchMode mode);
+    MatchMode GetMatchMode() const;
+    
+    // The unmarked words of a boolean query are required with
+    // MatchMode::ALL. Boolean queries match the words and the prefixes,
+    // without fuzzy variants; the parallel overloads run them on
+    // the sequential path.
+    void SetQuerySyntax(QuerySyntax syntax);
+    QuerySyntax GetQuerySyntax() const;
     
-    std::set<int>::iterator begin(); 
-    std::set<int>::iterator end(); 
+    // Latency histograms of the public operations. Disabled by default,
+    // then measuring costs a single branch per call. Enabling, disabling
+    // and resetting must not race with other calls on this server.
+    // The snapshots of a server share its histograms, disabling drops
+    // them from this server only, resetting clears them for all.
+    void SetLatencyStats(bool enabled);
+    bool IsLatencyStatsEnabled() const;
+    std::map<SearchOperation, LatencySummary> GetLatencyStats() const;
+    void ResetLatencyStats();
     
-    std::set<int>::const_iterator begin() const; 
-    std::set<int>::const_iterator end() const; 
+    DocumentIds::iterator begin(); 
+    DocumentIds::iterator end(); 
+    
+    DocumentIds::const_iterator begin() const; 
+    DocumentIds::const_iterator end() const; 
     
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;        
+        // words without stop words, the length for the scorers
+        int word_count{0};
+        uint64_t fingerprint{0};
+    };
+    
+    
+    // occurrences of the word by document; the term frequency is derived
+    // from them and the length of the document by ComputeTermFreq
+    using DocumentFreqs = TermPostings;
+    using WordPostings = 
+            std::pmr::map<std::string_view, CopyOnWriteValue<DocumentFreqs>>;
+    
+    // the predicate of the status overloads, which the partitions serve
+    struct StatusPredicate {
+        DocumentStatus status;
+        
+        bool operator()(int , DocumentStatus document_status, int ) const {
+            return document_status == status;
+        }
+    };
+    static constexpr size_t status_count_ = 4;
+    
+    static constexpr size_t no_phrase_ = std::numeric_limits<size_t>::max();
+    
+    struct PostingCursor {
+        DocumentFreqs::const_iterator current;
+        DocumentFreqs::const_iterator end;
+        size_t document_freq;
+        // the weight of the word for the scorer, preset to the penalty
+        // of a fuzzy match by the lookup
+        double word_weight;
+        size_t word_index;
+        // index of the phrase of the word, no_phrase_ for a plus word
+        size_t phrase_index{no_phrase_};
+        // the list of current and end, for the seeks of MatchMode::ALL
+        const DocumentFreqs* postings{nullptr};
+    };
+    
+    struct PhraseWord {
+        std::string_view word;
+        // tokens after the first word of the phrase, stop words included
+        uint32_t offset;
+    };
+    
+    struct QueryPhrase {
+        // the words are phrase_words_[first_word, first_word + word_count)
+        size_t first_word;
+        size_t word_count;
+        // the largest distance between the positions of the words
+        uint32_t max_span;
+        bool is_exact;
+        // scoring state: cursors of the distinct indexed words, those
+        // at the current document and the sum of their relevance
+        size_t cursor_count{0};
+        size_t hit_count{0};
+        double relevance{0.0};
     };
     
+    class ThreadQueryContext;
+    
+    // every structure allocates from its own resource
+    struct IndexMemory {
+        explicit IndexMemory(std::pmr::memory_resource* upstream);
+        
+        AccountingResource stop_words;
+        AccountingResource unique_words;
+        AccountingResource word_to_document;
+        AccountingResource document_to_word;
+        AccountingResource documents;
+        AccountingResource fingerprints;
+        AccountingResource positions;
+        AccountingResource fuzzy;
+        AccountingResource status_postings;
+    };
+    
+    // shared by the copies along with the structures, declared before
+    // them so that it outlives them
+    std::shared_ptr<IndexMemory> memory_;
+    
+    std::shared_ptr<const std::pmr::set<std::pmr::string, std::less<>>> stop_words_;
+    CopyOnWrite<WordPostings> word_to_document_freqs_;
+    CopyOnWrite<std::pmr::map<int, DocumentData>> documents_;
+    // the attributes of documents_ for DocumentFilter
+    CopyOnWrite<DocumentColumns> document_columns_;
+    int64_t total_word_count_{0};
+    CopyOnWrite<DocumentIds> document_ids_;
+    // the words of a document do not change once added
+    CopyOnWrite<std::pmr::map<int, std::shared_ptr<const WordFrequencies>>> 
+        document_to_word_freqs_;
+    WordStore unique_words_;
+    
+    bool is_duplicate_detection_enabled_{false};
+    // ids of the documents with the given fingerprint in ascending order
+    using DocumentsByFingerprint = 
+            std::pmr::unordered_map<uint64_t, std::pmr::vector<int>>;
+    CopyOnWrite<DocumentsByFingerprint> fingerprint_to_documents_;
+    
+    bool is_positional_index_enabled_{false};
+    CopyOnWrite<PositionalIndex> positional_index_;
+    
+    size_t max_prefix_expansions_{MAX_PREFIX_EXPANSIONS};
+    
+    FuzzyMatchOptions fuzzy_options_;
+    CopyOnWrite<FuzzyIndex> fuzzy_index_;
+    
+    bool is_status_partitioning_enabled_{false};
+    // word_to_document_freqs_ split by the status of the documents
+    std::array<CopyOnWrite<WordPostings>, status_count_> status_postings_;
+    
+    ScoringMode scoring_mode_{ScoringMode::MERGE};
+    MatchMode match_mode_{MatchMode::ANY};
+    QuerySyntax query_syntax_{QuerySyntax::PLAIN};
+    
+    static std::array<CopyOnWrite<WordPostings>, status_count_> MakeStatusPostings(
+            std::pmr::memory_resource* resource);
+    void AddStatusPostings(int document_id, DocumentStatus status);
+    void RemoveStatusPostings(int document_id, DocumentStatus status);
+    
+    SearchServer(std::pmr::memory_resource* upstream,
+                 const std::set<std::string, std::less<>>& stop_words);
     
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::set<std::string, std::less<>> unique_words_;
+    static constexpr size_t operation_count_ = 5;
+    using LatencyHistograms = std::array<LatencyHistogram, operation_count_>;
+    // shared by the snapshots, null when the stats are disabled
+    std::shared_ptr<LatencyHistograms> latency_histograms_;
+    
+    LatencyHistogram* GetLatencyHistogram(SearchOperation operation) const;
+    
+    void Swap(SearchServer& other);
+    
+    void AddFingerprint(int document_id);
+    void RemoveFingerprint(int document_id);
     
     bool IsStopWord(const std::string_view word) const;
 
@@ -123,32 +616,41 @@ private:
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    struct QueryWord {
-        std::string data;
-        bool is_minus;
-        bool is_stop;
-    };
-
-    QueryWord ParseQueryWord(std::string text) const;
-    
     struct QueryWordView {
         std::string_view data;
         bool is_minus;
         bool is_stop;
+        // data is a prefix to expand
+        bool is_prefix;
     };
     
+    Expected<QueryWordView> ParseQueryWord(std::nothrow_t, 
+                                           std::string_view text) const;
     QueryWordView ParseQueryWord(std::string_view text) const;
+    // the word or the expansions of the prefix
+    void AddQueryWord(const QueryWordView& query_word,
+                      std::vector<std::string_view>& words) const;
     
-    struct Query {
-        std::set<std::string_view, std::less<>> plus_words;
-        std::set<std::string_view, std::less<>> minus_words;
-    };
-
-    Query ParseQuery(const std::string_view& text) const;    
+    // indexed words near the plus word with their distances
+    using FuzzyWords = std::vector<std::pair<std::string_view, int>>;
+    void AddFuzzyWords(const QueryWordView& query_word, 
+                       FuzzyWords& fuzzy_words) const;
+    // sorted by word, one per word at the lowest distance, none of plus_words
+    static void NormalizeFuzzyWords(const std::vector<std::string_view>& plus_words,
+                                    FuzzyWords& fuzzy_words);
+    double GetFuzzyWeight(int distance) const;
+    [[noreturn]] static void ThrowQueryError(SearchError error, 
+                                             std::string_view word);
+    
+    // Sorted unique plus and minus words into the context. On error the
+    // invalid word is left in the context.
+    Expected<void> ParseQuery(std::nothrow_t, const std::string_view text, 
+                              QueryContext& context) const;
     
     struct QueryView {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        FuzzyWords fuzzy_words;
     };
     void ParseQuery(
             const std::execution::parallel_policy& policy,
@@ -157,33 +659,323 @@ private:
             const std::execution::sequenced_policy& policy,
             const std::string_view& text, QueryView& out) const;
     
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    double GetAverageWordCount() const;
+    // count / word_count; within an ulp of the frequency of the forward
+    // index, which AddDocument sums share by share
+    static double ComputeTermFreq(uint32_t count, int word_count);
 
+    template <Scorer ScorerType, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    template <Scorer ScorerType, typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    template <Scorer ScorerType, typename DocumentPredicate>
+    Expected<const std::vector<Document>*> FindTopDocuments(
+            std::nothrow_t,
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    // unsorted matched documents of the query into the results of the context
+    template <Scorer ScorerType, typename DocumentPredicate>
+    Expected<void> FindMatchedDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
     
+    // the documents ranked after the cursor when there is one, skipped
+    // of them first
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(
-            const Query& query,
+    DocumentPage FindDocumentsPage(
+            const std::string_view raw_query,
+            const SearchCursor* after, size_t skipped, size_t page_size,
             DocumentPredicate document_predicate) const;
+    // the strict order of the pages
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
     
+    // the status partition when the predicate is a StatusPredicate or
+    // a DocumentFilter of a single status and partitioning is enabled,
+    // the whole index otherwise
     template <typename DocumentPredicate>
+    const WordPostings& SelectPostings(
+            const DocumentPredicate& document_predicate) const;
+    // the postings of the word of word_to_document_freqs_ in postings,
+    // nullptr when there are none
+    const DocumentFreqs* FindPostings(
+            const WordPostings& postings, 
+            WordPostings::const_iterator word_postings) const;
+    
+    // postings and weights of the words which are present in the index,
+    // the weights follow the document frequencies in the whole index
+    template <typename WordContainer, Scorer ScorerType>
+    std::vector<std::pair<const DocumentFreqs*, double>> 
+        LookupPostings(const WordContainer& words, 
+                       const WordPostings& postings,
+                       const ScorerType& scorer) const;
+    
+    void LookupPostings(const std::vector<std::string_view>& words,
+                        const WordPostings& postings,
+                        std::vector<PostingCursor>& cursors) const;
+    // appends the cursors of the fuzzy words, the penalty is applied
+    // to the inverse document frequency
+    void LookupFuzzyPostings(const FuzzyWords& fuzzy_words,
+                             const WordPostings& postings,
+                             std::vector<PostingCursor>& cursors) const;
+    // appends the cursors of the distinct words of every phrase, none
+    // for a phrase with a word missing from the postings
+    void LookupPhrasePostings(QueryContext& context, 
+                              const WordPostings& postings) const;
+    
+    bool ContainsPhrase(QueryContext& context, const QueryPhrase& phrase, 
+                        int document_id) const;
+    
+    // Moves the cursor to the first posting not less than document_id
+    static void SeekPosting(PostingCursor& cursor, int document_id);
+    
+    bool IsBooleanSyntax(std::string_view raw_query) const;
+    // The iterator of the documents of the query in either syntax,
+    // nullptr when it has no words but stop words. The terms of the tree
+    // are appended to terms with the weights of fuzzy matches and
+    // the order the relevance is summed in.
+    Expected<std::unique_ptr<PostingIterator>> CompileQuery(
+            QueryContext& context, const std::string_view raw_query,
+            const WordPostings& postings, 
+            std::vector<TermIterator*>& terms) const;
+    // the merge of FindAllDocuments over the parsed query in the context
+    std::unique_ptr<PostingIterator> CompilePlainQuery(
+            const QueryContext& context, const WordPostings& postings,
+            std::vector<TermIterator*>& terms) const;
+    // The iterator of the node over the postings, nullptr for a node of
+    // stop words only. The terms of the tree are appended to terms.
+    // The prefixes of a node under an excluded clause expand in full.
+    Expected<std::unique_ptr<PostingIterator>> CompileQuery(
+            const BooleanQueryNode& node, const WordPostings& postings,
+            std::vector<TermIterator*>& terms, 
+            std::string_view& invalid_word, bool is_excluded = false) const;
+    // the words of the index by their terms, in the order of the words
+    static void SortTerms(std::vector<TermIterator*>& terms);
+    // The relevance of the document at the iterator summed over the terms
+    // it collects into document_terms. A word repeated in the query counts
+    // once, the words are summed in their order as the merge does.
+    template <Scorer ScorerType>
+    static double ScoreDocument(
+            const ScorerType& scorer, const PostingIterator& documents,
+            const DocumentData& document_data, double average_word_count,
+            std::vector<const TermIterator*>& document_terms);
+    // FindAllDocuments of a boolean query
+    template <Scorer ScorerType, typename DocumentPredicate>
+    Expected<void> FindBooleanDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const std::string_view raw_query,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    Expected<std::vector<std::string_view>> MatchBooleanDocument(
+            QueryContext& context, const std::string_view raw_query, 
+            int document_id) const;
+    
+    // unsorted matched documents of the parsed query into the results
+    // of the context
+    template <Scorer ScorerType, typename DocumentPredicate>
+    void FindAllDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    
+    // FindAllDocuments of a query without phrases, word at a time
+    template <typename Real, Scorer ScorerType, typename DocumentPredicate>
+    void AccumulateDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    // FindAllDocuments with MatchMode::ALL of a query with required words
+    // or phrases, document at a time over the intersection of their lists
+    template <Scorer ScorerType, typename DocumentPredicate>
+    void IntersectDocuments(
+            QueryContext& context,
+            const ScorerType& scorer,
+            const WordPostings& postings,
+            DocumentPredicate document_predicate,
+            const std::stop_token& stop_token) const;
+    
+    template <typename Real, Scorer ScorerType>
+    static void ComputeBlockScores(
+            const ScorerType& scorer, const Real* term_freqs, 
+            const uint32_t* counts, const uint32_t* rows, const int* word_counts, size_t size, 
+            Real word_weight, double average_word_count, Real* scores);
+    
+    template <Scorer ScorerType, typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(
             const std::execution::parallel_policy& policy, 
             const QueryView& query,
+            const ScorerType& scorer,
             DocumentPredicate document_predicate) const;
 };
 
+class SearchServer::QueryContext {
+private:
+    friend class SearchServer;
+    
+    std::vector<std::string_view> plus_words_;
+    // the plus words which are not prefixes, for MatchMode::ALL
+    std::vector<std::string_view> required_words_;
+    std::vector<std::string_view> minus_words_;
+    FuzzyWords fuzzy_words_;
+    std::vector<QueryPhrase> phrases_;
+    std::vector<PhraseWord> phrase_words_;
+    std::vector<PostingCursor> plus_cursors_;
+    std::vector<PostingCursor> minus_cursors_;
+    // cursors of the required words and of the phrase words
+    std::vector<PostingCursor> required_cursors_;
+    std::vector<Document> results_;
+    std::vector<uint32_t> positions_;
+    std::vector<PhrasePositions> phrase_positions_;
+    // a bit per row of the document columns passing the DocumentFilter
+    std::vector<uint64_t> filter_bitmap_;
+    // relevance by the rows of the document columns and a bit per row
+    // with a plus word, for the accumulating scoring modes
+    std::vector<double> accumulator_;
+    std::vector<float> float_accumulator_;
+    std::vector<uint64_t> touched_rows_;
+    std::string_view invalid_word_;
+};
 
+// Lends the context of the calling thread. A query started while it is
+// lent (from a predicate of another query) gets a context of its own.
+class SearchServer::ThreadQueryContext {
+public:
+    ThreadQueryContext();
+    ~ThreadQueryContext();
+    
+    ThreadQueryContext(const ThreadQueryContext&) = delete;
+    ThreadQueryContext& operator=(const ThreadQueryContext&) = delete;
+    
+    QueryContext& Get();
+    
+private:
+    std::unique_ptr<QueryContext> own_context_;
+    QueryContext* context_;
+};
 
-template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
-    if(!all_of(stop_words_.cbegin(), stop_words_.cend(),
-              [](const std::string& word){
-                    return IsValidWord(word);
-                }))
+template <Scorer ScorerType, typename DocumentPredicate>
+class SearchServer::DocumentRange {
+public:
+    class Iterator {
+    public:
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        
+        Iterator() = default;
+        
+        const Document& operator*() const {
+            return range_->document_;
+        }
+        const Document* operator->() const {
+            return &range_->document_;
+        }
+        Iterator& operator++() {
+            range_->documents_->Next();
+            range_->FindDocument();
+            return *this;
+        }
+        void operator++(int) {
+            ++*this;
+        }
+        bool operator==(std::default_sentinel_t) const {
+            return range_->IsAtEnd();
+        }
+        
+    private:
+        friend DocumentRange;
+        
+        explicit Iterator(DocumentRange* range):
+            range_{range}
+        {
+        }
+        
+        DocumentRange* range_{nullptr};
+    };
+    
+    // Goes on from the document the previous iteration stopped at
+    Iterator begin() {
+        if (!is_started_) {
+            is_started_ = true;
+            FindDocument();
+        }
+        return Iterator{this};
+    }
+    std::default_sentinel_t end() const {
+        return std::default_sentinel;
+    }
+    
+private:
+    friend SearchServer;
+    
+    const SearchServer* server_;
+    ScorerType scorer_;
+    DocumentPredicate document_predicate_;
+    // nullptr when nothing can match
+    std::unique_ptr<PostingIterator> documents_;
+    double average_word_count_;
+    std::vector<const TermIterator*> document_terms_;
+    Document document_;
+    bool is_started_{false};
+    
+    DocumentRange(const SearchServer& server, const ScorerType& scorer,
+                  DocumentPredicate document_predicate, 
+                  std::unique_ptr<PostingIterator> documents):
+        server_{&server},
+        scorer_{scorer},
+        document_predicate_{std::move(document_predicate)},
+        documents_{std::move(documents)},
+        average_word_count_{server.GetAverageWordCount()}
     {
-        throw std::invalid_argument{"Contains invalid characters in stop words"};
     }
+    
+    bool IsAtEnd() const {
+        return documents_ == nullptr 
+                || documents_->GetDocumentId() == PostingIterator::END;
+    }
+    
+    // the document at the iterator or the first one after it which
+    // passes the predicate
+    void FindDocument() {
+        for (; !IsAtEnd(); documents_->Next()) {
+            const int document_id = documents_->GetDocumentId();
+            const DocumentData& document_data = server_->documents_->at(document_id);
+            if (document_predicate_(document_id, document_data.status, 
+                                    document_data.rating)) {
+                document_ = Document{document_id, 
+                                     ScoreDocument(scorer_, *documents_, 
+                                                   document_data, 
+                                                   average_word_count_,
+                                                   document_terms_),
+                                     document_data.rating};
+                return;
+            }
+        }
+    }
+};
+
+
+
+template <typename StringContainer>
+SearchServer::SearchServer(const StringContainer& stop_words,
+                           std::pmr::memory_resource* resource)
+    : SearchServer(resource, MakeUniqueNonEmptyStrings(stop_words)) {
 }
 
 template<typename DocumentPredicate>
@@ -191,10 +983,135 @@ std::vector<Document> SearchServer::FindTopDocuments(
         const std::string_view raw_query, 
         DocumentPredicate document_predicate) const
 {
-    Query query = ParseQuery(raw_query);        
-    
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+    return FindTopDocuments(TfIdfScorer{}, raw_query, document_predicate, 
+                            std::stop_token{});
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(scorer, raw_query, document_predicate, 
+                            std::stop_token{});
+}
+
+template <Scorer ScorerType>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentStatus status) const
+{
+    return FindTopDocuments(scorer, raw_query, StatusPredicate{status});
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const
+{
+    ThreadQueryContext context;
+    return FindTopDocuments(context.Get(), scorer, raw_query, document_predicate,
+                            stop_token);
+}
+
+template<typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(
+        QueryContext& context,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(context, TfIdfScorer{}, raw_query, document_predicate,
+                            std::stop_token{});
+}
 
+template <Scorer ScorerType, typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(context, scorer, raw_query, document_predicate,
+                            std::stop_token{});
+}
+
+template <Scorer ScorerType>
+const std::vector<Document>& SearchServer::FindTopDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentStatus status) const
+{
+    return FindTopDocuments(context, scorer, raw_query, StatusPredicate{status});
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const
+{
+    const auto result = FindTopDocuments(std::nothrow, context, scorer, raw_query,
+                                         document_predicate, stop_token);
+    if (!result) {
+        ThrowQueryError(result.GetError(), context.invalid_word_);
+    }
+    return **result;
+}
+
+template<typename DocumentPredicate>
+Expected<std::vector<Document>> SearchServer::FindTopDocuments(
+        std::nothrow_t,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const
+{
+    ThreadQueryContext context;
+    const auto result = FindTopDocuments(std::nothrow, context.Get(), TfIdfScorer{},
+                                         raw_query, document_predicate, 
+                                         std::stop_token{});
+    if (!result) {
+        return result.GetError();
+    }
+    return **result;
+}
+
+template<typename DocumentPredicate>
+Expected<const std::vector<Document>*> SearchServer::FindTopDocuments(
+        std::nothrow_t,
+        QueryContext& context,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const
+{
+    return FindTopDocuments(std::nothrow, context, TfIdfScorer{}, raw_query, 
+                            document_predicate, std::stop_token{});
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+Expected<const std::vector<Document>*> SearchServer::FindTopDocuments(
+        std::nothrow_t,
+        QueryContext& context,
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const
+{
+    ScopedLatency latency{GetLatencyHistogram(
+                    SearchOperation::FIND_TOP_DOCUMENTS_SEQ)};
+    TRACE_QUERY("FindTopDocuments");
+    if (const auto found = FindMatchedDocuments(context, scorer, raw_query, 
+                                                document_predicate, stop_token);
+            !found) {
+        return found.GetError();
+    }
+
+    TRACE_SPAN("Sort");
+    std::vector<Document>& matched_documents = context.results_;
     sort(matched_documents.begin(), matched_documents.end(),
          [](const Document& lhs, const Document& rhs) {
         if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
@@ -208,31 +1125,140 @@ std::vector<Document> SearchServer::FindTopDocuments(
         matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
     
-    return matched_documents;
+    return &matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const __pstl::execution::sequenced_policy& policy,
+template <Scorer ScorerType, typename DocumentPredicate>
+Expected<void> SearchServer::FindMatchedDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
         const std::string_view raw_query, 
-        DocumentPredicate document_predicate) const { 
-    Query query = ParseQuery(raw_query);        
-    
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const
+{
+    if (IsBooleanSyntax(raw_query)) {
+        return FindBooleanDocuments(context, scorer, raw_query, 
+                                    document_predicate, stop_token);
+    }
+    if (const auto parsed = ParseQuery(std::nothrow, raw_query, context); !parsed) {
+        return parsed.GetError();
+    }
+    FindAllDocuments(context, scorer, document_predicate, stop_token);
+    return {};
+}
 
-    sort(matched_documents.begin(), matched_documents.end(),
-         [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindDocumentsPage(
+        const std::string_view raw_query,
+        size_t page, size_t page_size,
+        DocumentPredicate document_predicate) const
+{
+    // a page past any number of documents is empty
+    const size_t skipped = page_size != 0 
+                && page > std::numeric_limits<size_t>::max() / page_size 
+            ? std::numeric_limits<size_t>::max() : page * page_size;
+    return FindDocumentsPage(raw_query, nullptr, skipped, page_size, 
+                             document_predicate);
+}
+
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindDocumentsPage(
+        const std::string_view raw_query,
+        const SearchCursor& after, size_t page_size,
+        DocumentPredicate document_predicate) const
+{
+    return FindDocumentsPage(raw_query, &after, 0, page_size, document_predicate);
+}
+
+template <typename DocumentPredicate>
+DocumentPage SearchServer::FindDocumentsPage(
+        const std::string_view raw_query,
+        const SearchCursor* after, size_t skipped, size_t page_size,
+        DocumentPredicate document_predicate) const
+{
+    if (page_size == 0) {
+        throw std::invalid_argument{"page_size is 0"};
+    }
+    TRACE_QUERY("FindDocumentsPage");
+    ThreadQueryContext thread_context;
+    QueryContext& context = thread_context.Get();
+    if (const auto found = FindMatchedDocuments(context, TfIdfScorer{}, raw_query,
+                                                document_predicate, 
+                                                std::stop_token{}); 
+            !found) {
+        ThrowQueryError(found.GetError(), context.invalid_word_);
+    }
     
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    TRACE_SPAN("Select");
+    std::vector<Document>& documents = context.results_;
+    auto end = documents.end();
+    if (after != nullptr) {
+        end = std::partition(documents.begin(), end, 
+                             [after](const Document& document) {
+            return IsRankedBefore(after->document_, document);
+        });
+    }
+    // the documents before the end of the page in front, then those
+    // of the page after the skipped ones
+    const size_t count = end - documents.begin();
+    const auto first = documents.begin() + std::min(skipped, count);
+    const auto last = first + std::min(page_size, 
+                                       static_cast<size_t>(end - first));
+    if (last != end) {
+        std::nth_element(documents.begin(), last, end, IsRankedBefore);
+    }
+    if (first != documents.begin()) {
+        std::nth_element(documents.begin(), first, last, IsRankedBefore);
     }
+    std::sort(first, last, IsRankedBefore);
     
-    return matched_documents;
+    DocumentPage result{std::vector<Document>(first, last), std::nullopt};
+    if (last != end) {
+        result.next = SearchCursor{*std::prev(last)};
+    }
+    return result;
+}
+
+template <typename DocumentPredicate>
+SearchServer::DocumentRange<TfIdfScorer, DocumentPredicate> 
+    SearchServer::FindAllDocumentsRange(
+        const std::string_view raw_query,
+        DocumentPredicate document_predicate) const
+{
+    return FindAllDocumentsRange(TfIdfScorer{}, raw_query, document_predicate);
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+SearchServer::DocumentRange<ScorerType, DocumentPredicate> 
+    SearchServer::FindAllDocumentsRange(
+        const ScorerType& scorer,
+        const std::string_view raw_query,
+        DocumentPredicate document_predicate) const
+{
+    ThreadQueryContext thread_context;
+    QueryContext& context = thread_context.Get();
+    std::vector<TermIterator*> terms;
+    auto documents = CompileQuery(context, raw_query, 
+                                  SelectPostings(document_predicate), terms);
+    if (!documents) {
+        ThrowQueryError(documents.GetError(), context.invalid_word_);
+    }
+    const int document_count = GetDocumentCount();
+    for (TermIterator* term : terms) {
+        term->word_weight *= scorer.ComputeWordWeight(document_count, 
+                                                      term->GetDocumentFreq());
+    }
+    return DocumentRange<ScorerType, DocumentPredicate>{
+        *this, scorer, std::move(document_predicate), std::move(*documents)};
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::execution::sequenced_policy& policy,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const { 
+    return FindTopDocuments(TfIdfScorer{}, raw_query, document_predicate, 
+                            std::stop_token{});
 }
 
 template <typename DocumentPredicate>
@@ -240,12 +1266,33 @@ std::vector<Document> SearchServer::FindTopDocuments(
         const std::execution::parallel_policy& policy,
         const std::string_view raw_query, 
         DocumentPredicate document_predicate) const {  
+    return FindTopDocuments(policy, TfIdfScorer{}, raw_query, document_predicate);
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+        const std::execution::parallel_policy& policy,
+        const ScorerType& scorer,
+        const std::string_view raw_query, 
+        DocumentPredicate document_predicate) const {  
+    // phrases, intersections and boolean queries are matched on 
+    // the sequential path only, which records the latency
+    if (raw_query.find('"') != std::string_view::npos 
+            || match_mode_ == MatchMode::ALL || IsBooleanSyntax(raw_query)) {
+        return FindTopDocuments(scorer, raw_query, document_predicate, 
+                                std::stop_token{});
+    }
+    ScopedLatency latency{GetLatencyHistogram(
+                    SearchOperation::FIND_TOP_DOCUMENTS_PAR)};
+    TRACE_QUERY("FindTopDocuments(par)");
     QueryView query;
     ParseQuery(policy, raw_query, query);
     auto matched_documents = FindAllDocuments(policy, 
                                               query, 
+                                              scorer,
                                               document_predicate);
 
+    TRACE_SPAN("Sort");
     sort(policy, matched_documents.begin(), matched_documents.end(),
          [](const Document& lhs, const Document& rhs) {
         if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
@@ -263,95 +1310,611 @@ std::vector<Document> SearchServer::FindTopDocuments(
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(
-        const Query& query,
-        DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+SearchAwaitable<std::vector<Document>> SearchServer::FindTopDocumentsAsync(
+        const std::string_view raw_query,
+        DocumentPredicate document_predicate,
+        std::stop_token stop_token) const
+{
+    return SearchAwaitable<std::vector<Document>>{
+        SearchExecutor::Default(),
+        [this, query = std::string{raw_query}, document_predicate](
+                const std::stop_token& token) {
+            return FindTopDocuments(TfIdfScorer{}, query, document_predicate, 
+                                    token);
+        },
+        std::move(stop_token)};
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
+void SearchServer::FindAllDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const {
+    const WordPostings& postings = SelectPostings(document_predicate);
+    LookupPostings(context.plus_words_, postings, context.plus_cursors_);
+    LookupFuzzyPostings(context.fuzzy_words_, postings, context.plus_cursors_);
+    LookupPhrasePostings(context, postings);
+    LookupPostings(context.minus_words_, postings, context.minus_cursors_);
+    context.results_.clear();
+    ThrowIfStopRequested(stop_token);
+    
+    const int document_count = GetDocumentCount();
+    for (PostingCursor& cursor : context.plus_cursors_) {
+        cursor.word_weight *= scorer.ComputeWordWeight(document_count, 
+                                                       cursor.document_freq);
+    }
+    if (match_mode_ == MatchMode::ALL 
+            && (!context.required_words_.empty() || !context.phrases_.empty())) {
+        IntersectDocuments(context, scorer, postings, document_predicate, 
+                           stop_token);
+        return;
+    }
+    if (scoring_mode_ != ScoringMode::MERGE && context.phrases_.empty()) {
+        if (scoring_mode_ == ScoringMode::ACCUMULATE_FLOAT) {
+            AccumulateDocuments<float>(context, scorer, document_predicate, 
+                                       stop_token);
+        } else {
+            AccumulateDocuments<double>(context, scorer, document_predicate, 
+                                        stop_token);
+        }
+        return;
+    }
+    const double average_word_count = GetAverageWordCount();
+    
+    constexpr bool is_filter = std::is_same_v<DocumentPredicate, DocumentFilter>;
+    size_t row = 0;
+    if constexpr (is_filter) {
+        TRACE_SPAN("Filter");
+        document_columns_->Evaluate(document_predicate, context.filter_bitmap_);
+    }
+    
+    TRACE_SPAN("Scoring");
+    // The postings are merged by document id through a heap of cursors.
+    // Ties go in the order of the words, so the relevance of a document
+    // is summed in the same order as word by word scoring would do it.
+    std::vector<PostingCursor>& heap = context.plus_cursors_;
+    const auto is_later = [](const PostingCursor& lhs, const PostingCursor& rhs) {
+        return std::pair{lhs.current->first, lhs.word_index} 
+                > std::pair{rhs.current->first, rhs.word_index};
+    };
+    std::make_heap(heap.begin(), heap.end(), is_later);
+    const auto advance_back = [&heap, &is_later]() {
+        PostingCursor& cursor = heap.back();
+        if (++cursor.current == cursor.end) {
+            heap.pop_back();
+        } else {
+            std::push_heap(heap.begin(), heap.end(), is_later);
+        }
+    };
+    
+    while (!heap.empty()) {
+        // a single atomic load, or nothing for a token without a source
+        ThrowIfStopRequested(stop_token);
+        const int document_id = heap.front().current->first;
+        if constexpr (is_filter) {
+            // documents come in ascending order, so do their rows
+            row = document_columns_->FindRow(document_id, row);
+            if (!IsRowSelected(context.filter_bitmap_, row)) {
+                while (!heap.empty() && heap.front().current->first == document_id) {
+                    std::pop_heap(heap.begin(), heap.end(), is_later);
+                    advance_back();
+                }
+                continue;
+            }
+        }
+        const DocumentData& document_data = documents_->at(document_id);
+        const double document_norm = scorer.ComputeDocumentNorm(
+                    document_data.word_count, average_word_count);
+        double relevance = 0.0;
+        bool has_plus_word = false;
+        while (!heap.empty() && heap.front().current->first == document_id) {
+            std::pop_heap(heap.begin(), heap.end(), is_later);
+            PostingCursor& cursor = heap.back();
+            const double word_relevance = scorer.ComputeTermScore(
+                        ComputeTermFreq(cursor.current->second,
+                                        document_data.word_count),
+                        cursor.current->second, document_data.word_count,
+                        cursor.word_weight, document_norm);
+            if (cursor.phrase_index == no_phrase_) {
+                relevance += word_relevance;
+                has_plus_word = true;
+            } else {
+                QueryPhrase& phrase = context.phrases_[cursor.phrase_index];
+                phrase.relevance += word_relevance;
+                ++phrase.hit_count;
+            }
+            advance_back();
+        }
+        
+        // documents come in ascending order, so do the minus postings
+        bool has_minus_word = false;
+        for (PostingCursor& cursor : context.minus_cursors_) {
+            while (cursor.current != cursor.end 
+                   && cursor.current->first < document_id) {
+                ++cursor.current;
+            }
+            if (cursor.current != cursor.end 
+                    && cursor.current->first == document_id) {
+                has_minus_word = true;
+                break;
+            }
+        }
+        
+        // a phrase counts when all its words are at the document
+        // and their positions line up
+        bool is_matched = has_plus_word;
+        for (QueryPhrase& phrase : context.phrases_) {
+            if (!has_minus_word && phrase.cursor_count > 0
+                    && phrase.hit_count == phrase.cursor_count
+                    && ContainsPhrase(context, phrase, document_id)) {
+                relevance += phrase.relevance;
+                is_matched = true;
+            }
+            phrase.hit_count = 0;
+            phrase.relevance = 0.0;
+        }
+        if (has_minus_word || !is_matched) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, 
-                                   document_data.status, 
-                                   document_data.rating)) {
-                document_to_relevance[document_id] += 
-                        term_freq * inverse_document_freq;
+        
+        if (is_filter || document_predicate(document_id, 
+                                            document_data.status, 
+                                            document_data.rating)) {
+            context.results_.emplace_back(document_id, relevance, 
+                                          document_data.rating);
+        }
+    }
+}  
+
+template <Scorer ScorerType, typename DocumentPredicate>
+void SearchServer::IntersectDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        const WordPostings& postings,
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const {
+    std::vector<PostingCursor>& required = context.required_cursors_;
+    LookupPostings(context.required_words_, postings, required);
+    if (required.size() < context.required_words_.size()) {
+        return;
+    }
+    for (const QueryPhrase& phrase : context.phrases_) {
+        if (phrase.cursor_count == 0) {
+            return;
+        }
+    }
+    for (const PostingCursor& cursor : context.plus_cursors_) {
+        if (cursor.phrase_index != no_phrase_) {
+            required.push_back(cursor);
+        }
+    }
+    std::sort(required.begin(), required.end(), 
+              [](const PostingCursor& lhs, const PostingCursor& rhs) {
+        return lhs.postings->size() < rhs.postings->size();
+    });
+    const double average_word_count = GetAverageWordCount();
+    
+    constexpr bool is_filter = std::is_same_v<DocumentPredicate, DocumentFilter>;
+    size_t row = 0;
+    if constexpr (is_filter) {
+        TRACE_SPAN("Filter");
+        document_columns_->Evaluate(document_predicate, context.filter_bitmap_);
+    }
+    
+    TRACE_SPAN("Intersect");
+    PostingCursor& shortest = required.front();
+    while (shortest.current != shortest.end) {
+        ThrowIfStopRequested(stop_token);
+        // every list seeks the candidate of the shortest one, a list
+        // without it makes its next document the candidate
+        const int document_id = shortest.current->first;
+        int next_id = document_id;
+        for (auto it = required.begin() + 1; it != required.end(); ++it) {
+            SeekPosting(*it, document_id);
+            if (it->current == it->end) {
+                return;
+            }
+            if (it->current->first != document_id) {
+                next_id = it->current->first;
+                break;
+            }
+        }
+        if (next_id != document_id) {
+            SeekPosting(shortest, next_id);
+            continue;
+        }
+        ++shortest.current;
+        
+        if constexpr (is_filter) {
+            row = document_columns_->FindRow(document_id, row);
+            if (!IsRowSelected(context.filter_bitmap_, row)) {
+                continue;
+            }
+        }
+        bool has_minus_word = false;
+        for (PostingCursor& cursor : context.minus_cursors_) {
+            SeekPosting(cursor, document_id);
+            if (cursor.current != cursor.end 
+                    && cursor.current->first == document_id) {
+                has_minus_word = true;
+                break;
+            }
+        }
+        if (has_minus_word) {
+            continue;
+        }
+        
+        // summed in the order of the words, as the merge does
+        const DocumentData& document_data = documents_->at(document_id);
+        const double document_norm = scorer.ComputeDocumentNorm(
+                    document_data.word_count, average_word_count);
+        double relevance = 0.0;
+        for (PostingCursor& cursor : context.plus_cursors_) {
+            SeekPosting(cursor, document_id);
+            if (cursor.current == cursor.end 
+                    || cursor.current->first != document_id) {
+                continue;
             }
+            const double word_relevance = scorer.ComputeTermScore(
+                        ComputeTermFreq(cursor.current->second,
+                                        document_data.word_count),
+                        cursor.current->second, document_data.word_count,
+                        cursor.word_weight, document_norm);
+            if (cursor.phrase_index == no_phrase_) {
+                relevance += word_relevance;
+            } else {
+                context.phrases_[cursor.phrase_index].relevance += word_relevance;
+            }
+        }
+        bool has_phrases = true;
+        for (QueryPhrase& phrase : context.phrases_) {
+            if (has_phrases && ContainsPhrase(context, phrase, document_id)) {
+                relevance += phrase.relevance;
+            } else {
+                has_phrases = false;
+            }
+            phrase.relevance = 0.0;
+        }
+        if (!has_phrases) {
+            continue;
+        }
+        
+        if (is_filter || document_predicate(document_id, 
+                                            document_data.status, 
+                                            document_data.rating)) {
+            context.results_.emplace_back(document_id, relevance, 
+                                          document_data.rating);
         }
     }
+}
 
-    for (const std::string_view& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+template <Scorer ScorerType, typename DocumentPredicate>
+Expected<void> SearchServer::FindBooleanDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        const std::string_view raw_query,
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const {
+    context.results_.clear();
+    std::vector<TermIterator*> terms;
+    auto root = CompileQuery(context, raw_query, SelectPostings(document_predicate),
+                             terms);
+    if (!root) {
+        return root.GetError();
+    }
+    if (*root == nullptr) {
+        return {};
+    }
+    const int document_count = GetDocumentCount();
+    for (TermIterator* term : terms) {
+        term->word_weight *= scorer.ComputeWordWeight(document_count, 
+                                                      term->GetDocumentFreq());
+    }
+    const double average_word_count = GetAverageWordCount();
+    
+    constexpr bool is_filter = std::is_same_v<DocumentPredicate, DocumentFilter>;
+    size_t row = 0;
+    if constexpr (is_filter) {
+        TRACE_SPAN("Filter");
+        document_columns_->Evaluate(document_predicate, context.filter_bitmap_);
+    }
+    
+    TRACE_SPAN("Scoring");
+    std::vector<const TermIterator*> document_terms;
+    for (PostingIterator& documents = **root; 
+         documents.GetDocumentId() != PostingIterator::END; documents.Next()) {
+        ThrowIfStopRequested(stop_token);
+        const int document_id = documents.GetDocumentId();
+        if constexpr (is_filter) {
+            row = document_columns_->FindRow(document_id, row);
+            if (!IsRowSelected(context.filter_bitmap_, row)) {
+                continue;
+            }
+        }
+        const DocumentData& document_data = documents_->at(document_id);
+        if (!is_filter && !document_predicate(document_id, 
+                                              document_data.status, 
+                                              document_data.rating)) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        context.results_.emplace_back(document_id, 
+                                      ScoreDocument(scorer, documents, 
+                                                    document_data, 
+                                                    average_word_count,
+                                                    document_terms),
+                                      document_data.rating);
+    }
+    return {};
+}
+
+template <Scorer ScorerType>
+double SearchServer::ScoreDocument(
+        const ScorerType& scorer, const PostingIterator& documents,
+        const DocumentData& document_data, double average_word_count,
+        std::vector<const TermIterator*>& document_terms) {
+    document_terms.clear();
+    documents.CollectTerms(document_terms);
+    std::sort(document_terms.begin(), document_terms.end(),
+              [](const TermIterator* lhs, const TermIterator* rhs) {
+        return lhs->word_index < rhs->word_index;
+    });
+    const double document_norm = scorer.ComputeDocumentNorm(
+                document_data.word_count, average_word_count);
+    double relevance = 0.0;
+    for (size_t i = 0; i < document_terms.size(); ++i) {
+        const TermIterator& term = *document_terms[i];
+        if (i > 0 && document_terms[i - 1]->word_index == term.word_index) {
+            continue;
         }
+        relevance += scorer.ComputeTermScore(
+                    ComputeTermFreq(term.GetCount(), document_data.word_count),
+                    term.GetCount(), document_data.word_count, term.word_weight, 
+                    document_norm);
     }
+    return relevance;
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, 
-                                     documents_.at(document_id).rating});
+template <typename Real, Scorer ScorerType, typename DocumentPredicate>
+void SearchServer::AccumulateDocuments(
+        QueryContext& context,
+        const ScorerType& scorer,
+        DocumentPredicate document_predicate,
+        const std::stop_token& stop_token) const {
+    std::vector<Real>& accumulator = [&context]() -> std::vector<Real>& {
+        if constexpr (std::is_same_v<Real, float>) {
+            return context.float_accumulator_;
+        } else {
+            return context.accumulator_;
+        }
+    }();
+    std::vector<uint64_t>& touched_rows = context.touched_rows_;
+    const size_t row_count = document_columns_->GetRowCount();
+    accumulator.assign(row_count, Real{0});
+    touched_rows.assign((row_count + 63) / 64, 0);
+    const int* word_counts = document_columns_->GetWordCounts().data();
+    const double average_word_count = GetAverageWordCount();
+    
+    std::array<uint32_t, SCORING_BLOCK_SIZE> rows;
+    std::array<uint32_t, SCORING_BLOCK_SIZE> counts;
+    std::array<Real, SCORING_BLOCK_SIZE> term_freqs;
+    std::array<Real, SCORING_BLOCK_SIZE> scores;
+    {
+        TRACE_SPAN("Scoring");
+        // in the order of the words, so every document sums its words
+        // in the order of the merge
+        for (PostingCursor& cursor : context.plus_cursors_) {
+            size_t row = 0;
+            while (cursor.current != cursor.end) {
+                ThrowIfStopRequested(stop_token);
+                size_t size = 0;
+                for (; size < SCORING_BLOCK_SIZE && cursor.current != cursor.end;
+                     ++size, ++cursor.current) {
+                    row = document_columns_->FindRow(cursor.current->first, row);
+                    rows[size] = static_cast<uint32_t>(row);
+                    counts[size] = cursor.current->second;
+                    if constexpr (!std::is_same_v<ScorerType, Bm25Scorer>) {
+                        term_freqs[size] = static_cast<Real>(ComputeTermFreq(
+                                    counts[size], word_counts[row]));
+                    }
+                }
+                ComputeBlockScores(scorer, term_freqs.data(), counts.data(),
+                                   rows.data(), word_counts, size, 
+                                   static_cast<Real>(cursor.word_weight),
+                                   average_word_count, scores.data());
+                AccumulateScores(rows.data(), scores.data(), size, 
+                                 accumulator.data(), touched_rows.data());
+            }
+        }
     }
-    return matched_documents;
-}  
+    for (PostingCursor& cursor : context.minus_cursors_) {
+        size_t row = 0;
+        for (; cursor.current != cursor.end; ++cursor.current) {
+            row = document_columns_->FindRow(cursor.current->first, row);
+            touched_rows[row / 64] &= ~(uint64_t{1} << (row % 64));
+        }
+    }
+    constexpr bool is_filter = std::is_same_v<DocumentPredicate, DocumentFilter>;
+    if constexpr (is_filter) {
+        TRACE_SPAN("Filter");
+        document_columns_->Evaluate(document_predicate, context.filter_bitmap_);
+        for (size_t i = 0; i < touched_rows.size(); ++i) {
+            touched_rows[i] &= context.filter_bitmap_[i];
+        }
+    }
+    
+    const auto& ids = document_columns_->GetIds();
+    const auto& statuses = document_columns_->GetStatuses();
+    const auto& ratings = document_columns_->GetRatings();
+    for (size_t i = 0; i < touched_rows.size(); ++i) {
+        for (uint64_t bits = touched_rows[i]; bits != 0; bits &= bits - 1) {
+            const size_t row = i * 64 + std::countr_zero(bits);
+            if (is_filter || document_predicate(
+                        ids[row], static_cast<DocumentStatus>(statuses[row]), 
+                        ratings[row])) {
+                context.results_.emplace_back(
+                            ids[row], static_cast<double>(accumulator[row]), 
+                            ratings[row]);
+            }
+        }
+    }
+}
 
-template<typename DocumentPredicate>
+template <typename Real, Scorer ScorerType>
+void SearchServer::ComputeBlockScores(
+        const ScorerType& scorer, const Real* term_freqs, 
+        const uint32_t* counts, const uint32_t* rows, const int* word_counts, size_t size, 
+        Real word_weight, double average_word_count, Real* scores) {
+    if constexpr (std::is_same_v<ScorerType, TfIdfScorer>) {
+        ComputeTfIdfScores(term_freqs, size, word_weight, scores);
+    } else if constexpr (std::is_same_v<ScorerType, Bm25Scorer>) {
+        ComputeBm25Scores(scorer, counts, rows, word_counts, size,
+                          word_weight, average_word_count, scores);
+    } else {
+        for (size_t i = 0; i < size; ++i) {
+            const int word_count = word_counts[rows[i]];
+            scores[i] = static_cast<Real>(scorer.ComputeTermScore(
+                        term_freqs[i], counts[i], word_count, word_weight, 
+                        scorer.ComputeDocumentNorm(word_count, 
+                                                   average_word_count)));
+        }
+    }
+}
+
+template <Scorer ScorerType, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(
         const std::execution::parallel_policy& policy, 
         const QueryView& query, 
+        const ScorerType& scorer,
         DocumentPredicate document_predicate) const
 {
+    const WordPostings& postings = SelectPostings(document_predicate);
+    auto plus_postings = LookupPostings(query.plus_words, postings, scorer);
+    for (const auto& [word, distance] : query.fuzzy_words) {
+        const auto it = word_to_document_freqs_->find(word);
+        if (it == word_to_document_freqs_->end() || it->second->empty()) {
+            continue;
+        }
+        const DocumentFreqs* word_postings = FindPostings(postings, it);
+        if (word_postings != nullptr) {
+            plus_postings.emplace_back(word_postings, 
+                                       GetFuzzyWeight(distance) 
+                                       * scorer.ComputeWordWeight(
+                                             GetDocumentCount(), 
+                                             it->second->size()));
+        }
+    }
+    const double average_word_count = GetAverageWordCount();
+    
     ConcurrentMap<int, double> document_to_relevance{128*
             std::thread::hardware_concurrency()};
     auto findWords = [this, 
                      &document_to_relevance, 
-                     &document_predicate](const std::string_view word){
-        if (word_to_document_freqs_.find(word) == word_to_document_freqs_.end()) {
-            return;
-        }  
-        
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto&[document_id, term_freq]: word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
+                     &document_predicate,
+                     &scorer,
+                     average_word_count](const auto& word_postings){
+        const auto& [postings, word_weight] = word_postings;
+        for (const auto&[document_id, count]: *postings) {
+            const auto& document_data = documents_->at(document_id);
             if (document_predicate(document_id, 
                                    document_data.status, 
                                    document_data.rating)) {
                 document_to_relevance[document_id].ref_to_value += 
-                        term_freq * inverse_document_freq;
+                        scorer.ComputeTermScore(
+                            ComputeTermFreq(count, document_data.word_count),
+                            count, document_data.word_count, word_weight,
+                            scorer.ComputeDocumentNorm(document_data.word_count,
+                                                       average_word_count));
             }
         }
     };
     
-    std::for_each(policy, 
-                  query.plus_words.begin(), query.plus_words.end(),
-                  findWords);
+    {
+        TRACE_SPAN("Scoring");
+        std::for_each(policy, 
+                      plus_postings.begin(), plus_postings.end(),
+                      findWords);
+    }
     
     auto removeWords = [this, 
                        &document_to_relevance](const std::string_view word)
     {
-        if (word_to_document_freqs_.count(word) == 0) {
+        if (word_to_document_freqs_->count(word) == 0) {
             return;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
+        for (const auto& [document_id, _] : *word_to_document_freqs_->at(word)) {
             document_to_relevance.erase(document_id);
         }
     };
     
-    std::for_each(policy, 
-                  query.minus_words.begin(), query.minus_words.end(),
-                  removeWords);
+    {
+        TRACE_SPAN("MinusWords");
+        std::for_each(policy, 
+                      query.minus_words.begin(), query.minus_words.end(),
+                      removeWords);
+    }
     
+    TRACE_SPAN("BuildOrdinaryMap");
     auto ForOut{document_to_relevance.BuildOrdinaryMap()};
     std::vector<Document> matched_documents;
     matched_documents.reserve(ForOut.size());
-    for (const auto [document_id, relevance] :  ForOut) {
+    for (const auto& [document_id, relevance] :  ForOut) {
         matched_documents.push_back({document_id, relevance, 
-                                     documents_.at(document_id).rating});
+                                     documents_->at(document_id).rating});
     }
     return matched_documents;
 }
+
+template <typename WordContainer, Scorer ScorerType>
+std::vector<std::pair<const SearchServer::DocumentFreqs*, double>> 
+    SearchServer::LookupPostings(const WordContainer& words,
+                                 const WordPostings& postings,
+                                 const ScorerType& scorer) const
+{
+    TRACE_SPAN("TermLookup");
+    std::vector<std::pair<const DocumentFreqs*, double>> word_postings;
+    word_postings.reserve(words.size());
+    for (const std::string_view word : words) {
+        const auto it = word_to_document_freqs_->find(word);
+        if (it == word_to_document_freqs_->end() || it->second->empty()) {
+            continue;
+        }
+        const DocumentFreqs* found = FindPostings(postings, it);
+        if (found != nullptr) {
+            word_postings.emplace_back(found, 
+                                       scorer.ComputeWordWeight(
+                                           GetDocumentCount(), 
+                                           it->second->size()));
+        }
+    }
+    return word_postings;
+}
+
+inline void SearchServer::SeekPosting(PostingCursor& cursor, int document_id)
+{
+    cursor.current = ::SeekPosting(*cursor.postings, cursor.current, document_id);
+}
+
+inline double SearchServer::ComputeTermFreq(uint32_t count, int word_count)
+{
+    return count * (1.0 / word_count);
+}
+
+template <typename DocumentPredicate>
+const SearchServer::WordPostings& SearchServer::SelectPostings(
+        const DocumentPredicate& document_predicate) const
+{
+    if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+        if (is_status_partitioning_enabled_) {
+            return *status_postings_[
+                    static_cast<size_t>(document_predicate.status)];
+        }
+    } else if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        const uint32_t statuses = document_predicate.statuses 
+                & ((1u << status_count_) - 1);
+        if (is_status_partitioning_enabled_ && std::has_single_bit(statuses)) {
+            return *status_postings_[std::countr_zero(statuses)];
+        }
+    }
+    return *word_to_document_freqs_;
+}
@@ -0,0 +1,11 @@
+#include "simd.h"
+
+bool HasAvx2()
+{
+#ifdef SEARCH_SERVER_AVX2
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// SIMD kernels are compiled for AVX2 with the target attribute and chosen
+// at run time, so the binary still runs on CPUs without it
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SEARCH_SERVER_AVX2
+#include <immintrin.h>
+#endif
+
+// Whether the AVX2 kernels can run, checked once
+bool HasAvx2();
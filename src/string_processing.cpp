@@ -25,28 +25,8 @@ vector<string> SplitIntoWords(const string_view text) {
 vector<string_view> SplitIntoWordsView(const string_view str)
 {
     vector<string_view> result;
-   
-    int64_t pos{0};
-    
-    const int64_t pos_end{static_cast<int64_t>(str.npos)};
-    
-    while (true) {
-        
-        int64_t space{static_cast<int64_t>(str.find(' ', pos))};
-        
-        result.emplace_back((space == pos_end) ? 
-                             str.substr(pos) : 
-                             str.substr(pos, space - pos));
-        
-        if (space == pos_end) 
-        {
-            break;
-        } 
-        else 
-        {
-            pos = space + 1;
-        }
-    }
-
+    ForEachWordView(str, [&result](const string_view word) {
+        result.push_back(word);
+    });
     return result;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <set>
 
@@ -21,3 +23,24 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(
 
 std::vector<std::string_view> SplitIntoWordsView(
         const std::string_view str);
+
+// Calls action for every word SplitIntoWordsView would return,
+// including the empty ones between adjacent spaces, without allocating.
+// An action returning bool stops the iteration by returning false.
+template <typename Action>
+void ForEachWordView(std::string_view str, Action action) {
+    while (true) {
+        const size_t space = str.find(' ');
+        if constexpr (std::is_same_v<decltype(action(str)), bool>) {
+            if (!action(str.substr(0, space))) {
+                return;
+            }
+        } else {
+            action(str.substr(0, space));
+        }
+        if (space == str.npos) {
+            break;
+        }
+        str.remove_prefix(space + 1);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// splitmix64 finalizer
+inline uint64_t MixHash(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// 64-bit fingerprint of a set of terms which does not depend on the order
+// of the terms. Every term is hashed and mixed, the hashes are summed and
+// the sum is finalized together with the number of terms.
+class TermSetFingerprint {
+public:
+    void Add(const std::string_view term)
+    {
+        sum_ += MixHash(std::hash<std::string_view>{}(term));
+        ++count_;
+    }
+
+    uint64_t Get() const
+    {
+        return MixHash(sum_ ^ MixHash(count_));
+    }
+
+private:
+    uint64_t sum_{0};
+    uint64_t count_{0};
+};
+
+// Fingerprint of the keys of a word -> frequency map
+template <typename WordMap>
+uint64_t ComputeTermSetFingerprint(const WordMap& word_freqs)
+{
+    TermSetFingerprint fingerprint;
+    for (const auto& [word, _] : word_freqs) {
+        fingerprint.Add(word);
+    }
+    return fingerprint.Get();
+}
+
+// Collision check for two documents with equal fingerprints
+template <typename WordMap>
+bool HasSameTermSet(const WordMap& lhs, const WordMap& rhs)
+{
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin();
+         lhs_it != lhs.end(); ++lhs_it, ++rhs_it) {
+        if (lhs_it->first != rhs_it->first) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <atomic>
+
+#include "word_store.h"
+
+using namespace std;
+
+WordStore::WordStore(pmr::memory_resource* resource):
+    resource_{resource},
+    words_{resource}
+{
+}
+
+WordStore::WordStore(const WordStore& other, pmr::memory_resource* resource):
+    resource_{resource},
+    words_{resource}
+{
+    other.ForEach([this](const string_view word) {
+        Insert(word);
+    });
+}
+
+string_view WordStore::Find(const string_view word) const
+{
+    const auto it = words_->find(word);
+    return it != words_->end() ? *it : string_view{};
+}
+
+pair<string_view, bool> WordStore::Insert(const string_view word)
+{
+    if (const string_view stored = Find(word); !stored.empty()) {
+        return {stored, false};
+    }
+    // a block held by a copy is read by it
+    if (blocks_.empty() || blocks_.back().use_count() > 1) {
+        shared_ptr<Block> block = allocate_shared<Block>(
+                    pmr::polymorphic_allocator<Block>(resource_));
+        erase_if(blocks_, [&block](const shared_ptr<Block>& old) {
+            if (old.use_count() > 1
+                    || old->get_allocator() != block->get_allocator()) {
+                return false;
+            }
+            atomic_thread_fence(memory_order_acquire);
+            block->splice_after(block->before_begin(), *old);
+            return true;
+        });
+        blocks_.push_back(move(block));
+    } else {
+        atomic_thread_fence(memory_order_acquire);
+    }
+    const string_view stored = blocks_.back()->emplace_front(word);
+    words_.GetMutable().insert(stored);
+    return {stored, true};
+}
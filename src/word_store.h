@@ -0,0 +1,57 @@
+#pragma once
+
+#include <forward_list>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "copy_on_write.h"
+
+// Append-only set of the words of an index, which the index keys its
+// structures by views of. Copies of a store share its words: the texts
+// stay in blocks shared by the copies, a store adds new words to a block
+// of its own while another copy holds its last one. A view of a word is
+// valid as long as a store holding the word lives. The lookup set is
+// a single one, copied on the first new word after a copy.
+class WordStore {
+public:
+    explicit WordStore(std::pmr::memory_resource* resource);
+    // The words of other in a single block allocated from the resource
+    WordStore(const WordStore& other, std::pmr::memory_resource* resource);
+    WordStore(const WordStore& other) = default;
+    WordStore(WordStore&& other) = default;
+    WordStore& operator=(const WordStore& other) = default;
+    WordStore& operator=(WordStore&& other) = default;
+
+    // The stored word, an empty view when there is none
+    std::string_view Find(std::string_view word) const;
+    // The stored word and whether it is new
+    std::pair<std::string_view, bool> Insert(std::string_view word);
+
+    template <typename Action>
+    void ForEach(Action action) const;
+
+private:
+    // a node list, so blocks merge without moving the texts
+    using Block = std::pmr::forward_list<std::pmr::string>;
+
+    std::pmr::memory_resource* resource_;
+    // the blocks no copy holds any more merge into the next new one
+    std::vector<std::shared_ptr<Block>> blocks_;
+    CopyOnWrite<std::pmr::set<std::string_view, std::less<>>> words_;
+};
+
+
+
+template <typename Action>
+void WordStore::ForEach(Action action) const
+{
+    for (const std::string_view word : *words_) {
+        action(word);
+    }
+}
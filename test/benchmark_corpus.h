@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+
+// Synthetic corpus shared by the benchmark and the load tester
+struct CorpusOptions {
+    int documents = 10'000;
+    int vocabulary = 10'000;
+    int document_words = 70;
+    int query_words = 7;
+    int queries = 500;
+    double zipf = 1.0;
+    double duplicate_rate = 0.05;
+    double minus_rate = 0.1;
+    unsigned seed = 42;
+};
+
+inline void PrintCorpusUsage(std::ostream& out) {
+    out << "  --documents=N        corpus size (10000)\n"
+           "  --vocabulary=N       distinct words (10000)\n"
+           "  --document-words=N   words per document (70)\n"
+           "  --query-words=N      words per query (7)\n"
+           "  --queries=N          generated queries (500)\n"
+           "  --zipf=S             Zipf skew of word frequencies, 0 is uniform (1.0)\n"
+           "  --duplicate-rate=P   share of documents repeating an earlier one (0.05)\n"
+           "  --minus-rate=P       share of minus words in queries (0.1)\n"
+           "  --seed=N             corpus and query seed (42)\n";
+}
+
+// Returns false when the key is not a corpus option
+inline bool ParseCorpusOption(const std::string& key, const std::string& value,
+                              CorpusOptions& options) {
+    if (key == "documents") {
+        options.documents = std::stoi(value);
+    } else if (key == "vocabulary") {
+        options.vocabulary = std::stoi(value);
+    } else if (key == "document-words") {
+        options.document_words = std::stoi(value);
+    } else if (key == "query-words") {
+        options.query_words = std::stoi(value);
+    } else if (key == "queries") {
+        options.queries = std::stoi(value);
+    } else if (key == "zipf") {
+        options.zipf = std::stod(value);
+    } else if (key == "duplicate-rate") {
+        options.duplicate_rate = std::stod(value);
+    } else if (key == "minus-rate") {
+        options.minus_rate = std::stod(value);
+    } else if (key == "seed") {
+        options.seed = static_cast<unsigned>(std::stoul(value));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline std::vector<std::pair<std::string, std::string>> DescribeCorpusOptions(
+        const CorpusOptions& options) {
+    return {
+        {"documents", std::to_string(options.documents)},
+        {"vocabulary", std::to_string(options.vocabulary)},
+        {"document_words", std::to_string(options.document_words)},
+        {"query_words", std::to_string(options.query_words)},
+        {"queries", std::to_string(options.queries)},
+        {"zipf", std::to_string(options.zipf)},
+        {"duplicate_rate", std::to_string(options.duplicate_rate)},
+        {"minus_rate", std::to_string(options.minus_rate)},
+        {"seed", std::to_string(options.seed)},
+    };
+}
+
+inline std::string GenerateWord(std::mt19937& generator, int max_length) {
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(std::uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+
+// Distinct words in random order, the position is the frequency rank
+inline std::vector<std::string> GenerateDictionary(std::mt19937& generator,
+                                                   int word_count, int max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    std::shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+// Picks the word of rank r with probability proportional to 1 / (r + 1)^skew
+class ZipfWordPicker {
+public:
+    ZipfWordPicker(const std::vector<std::string>& dictionary, double skew):
+        dictionary_{dictionary},
+        distribution_{MakeDistribution(dictionary.size(), skew)}
+    {
+    }
+
+    const std::string& operator()(std::mt19937& generator) {
+        return dictionary_[distribution_(generator)];
+    }
+
+private:
+    const std::vector<std::string>& dictionary_;
+    std::discrete_distribution<size_t> distribution_;
+
+    static std::discrete_distribution<size_t> MakeDistribution(size_t count, double skew) {
+        std::vector<double> weights(count);
+        for (size_t rank = 0; rank < count; ++rank) {
+            weights[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), skew);
+        }
+        return {weights.begin(), weights.end()};
+    }
+};
+
+inline std::string GenerateText(std::mt19937& generator, ZipfWordPicker& picker,
+                                int word_count, double minus_rate = 0) {
+    std::string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        if (minus_rate > 0
+                && std::uniform_real_distribution<>(0, 1)(generator) < minus_rate) {
+            text.push_back('-');
+        }
+        text += picker(generator);
+    }
+    return text;
+}
+
+struct Corpus {
+    std::vector<std::string> dictionary;
+    std::vector<std::string> documents;
+    std::vector<std::string> queries;
+};
+
+inline Corpus GenerateCorpus(const CorpusOptions& options) {
+    std::mt19937 generator{options.seed};
+    Corpus corpus;
+    corpus.dictionary = GenerateDictionary(generator, options.vocabulary, 12);
+    ZipfWordPicker picker{corpus.dictionary, options.zipf};
+
+    corpus.documents.reserve(options.documents);
+    for (int i = 0; i < options.documents; ++i) {
+        if (i > 0 && std::uniform_real_distribution<>(0, 1)(generator)
+                < options.duplicate_rate) {
+            const int original = std::uniform_int_distribution(0, i - 1)(generator);
+            corpus.documents.push_back(corpus.documents[original]);
+        } else {
+            corpus.documents.push_back(GenerateText(generator, picker,
+                                                    options.document_words));
+        }
+    }
+    corpus.queries.reserve(options.queries);
+    for (int i = 0; i < options.queries; ++i) {
+        corpus.queries.push_back(GenerateText(generator, picker, options.query_words,
+                                              options.minus_rate));
+    }
+    return corpus;
+}
+
+inline SearchServer BuildSearchServer(
+        const Corpus& corpus,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+    // the most frequent word plays the role of a stop word
+    SearchServer search_server(corpus.dictionary[0], resource);
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server.AddDocument(i, corpus.documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    return search_server;
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+inline std::vector<std::string> SplitByComma(std::string_view text) {
+    std::vector<std::string> result;
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        result.emplace_back(text.substr(0, comma));
+        text.remove_prefix(comma == text.npos ? text.size() : comma + 1);
+    }
+    return result;
+}
+
+// Summary of the repetitions of a benchmark case, times in microseconds
+struct BenchmarkStats {
+    std::string name;
+    size_t operations{0};
+    size_t repetitions{0};
+    double min_us{0.0};
+    double median_us{0.0};
+    double mean_us{0.0};
+    double stddev_us{0.0};
+    double max_us{0.0};
+};
+
+inline BenchmarkStats ComputeBenchmarkStats(const std::string& name,
+                                            size_t operations,
+                                            std::vector<double> samples_us) {
+    BenchmarkStats stats;
+    stats.name = name;
+    stats.operations = operations;
+    stats.repetitions = samples_us.size();
+    if (samples_us.empty()) {
+        return stats;
+    }
+    std::sort(samples_us.begin(), samples_us.end());
+    const size_t n = samples_us.size();
+    stats.min_us = samples_us.front();
+    stats.max_us = samples_us.back();
+    stats.median_us = n % 2 == 1
+            ? samples_us[n / 2]
+            : (samples_us[n / 2 - 1] + samples_us[n / 2]) / 2;
+    stats.mean_us = std::accumulate(samples_us.begin(), samples_us.end(), 0.0) / n;
+    double squares = 0.0;
+    for (const double sample : samples_us) {
+        squares += (sample - stats.mean_us) * (sample - stats.mean_us);
+    }
+    stats.stddev_us = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    return stats;
+}
+
+// Runs every case warmup + repetitions times. The setup is not timed,
+// its result is passed to the timed body, so destructive cases
+// (removal) start from the same state on every repetition.
+class BenchmarkRunner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BenchmarkRunner(int warmup, int repetitions):
+        warmup_{warmup},
+        repetitions_{std::max(repetitions, 1)}
+    {
+    }
+
+    template <typename Setup, typename Body>
+    void Run(const std::string& name, size_t operations, Setup setup, Body body) {
+        std::vector<double> samples_us;
+        for (int i = 0; i < warmup_ + repetitions_; ++i) {
+            auto state = setup();
+            const auto start = Clock::now();
+            body(state);
+            const auto finish = Clock::now();
+            if (i >= warmup_) {
+                samples_us.push_back(std::chrono::duration<double, std::micro>(
+                                         finish - start).count());
+            }
+        }
+        results_.push_back(ComputeBenchmarkStats(name, operations,
+                                                 std::move(samples_us)));
+    }
+
+    const std::vector<BenchmarkStats>& GetResults() const {
+        return results_;
+    }
+
+private:
+    int warmup_;
+    int repetitions_;
+    std::vector<BenchmarkStats> results_;
+};
+
+inline void PrintBenchmarkTable(std::ostream& out,
+                                const std::vector<BenchmarkStats>& results) {
+    out << std::left << std::setw(22) << "case" << std::right
+        << std::setw(8) << "ops"
+        << std::setw(14) << "median us"
+        << std::setw(14) << "mean us"
+        << std::setw(12) << "stddev"
+        << std::setw(14) << "min us"
+        << std::setw(14) << "ns/op" << '\n';
+    out << std::fixed << std::setprecision(1);
+    for (const BenchmarkStats& stats : results) {
+        out << std::left << std::setw(22) << stats.name << std::right
+            << std::setw(8) << stats.operations
+            << std::setw(14) << stats.median_us
+            << std::setw(14) << stats.mean_us
+            << std::setw(12) << stats.stddev_us
+            << std::setw(14) << stats.min_us
+            << std::setw(14) << stats.median_us * 1000.0
+                                / std::max<size_t>(stats.operations, 1)
+            << '\n';
+    }
+    out << std::defaultfloat;
+}
+
+// Writes {"config": {...}, "extra": {...}, "results": [...]}
+inline void WriteBenchmarkJson(
+        std::ostream& out,
+        const std::vector<std::pair<std::string, std::string>>& config,
+        const std::vector<std::pair<std::string, double>>& extra,
+        const std::vector<BenchmarkStats>& results) {
+    out << "{\n  \"config\": {";
+    for (size_t i = 0; i < config.size(); ++i) {
+        out << (i == 0 ? "" : ",") << "\n    \"" << config[i].first
+            << "\": \"" << config[i].second << '"';
+    }
+    out << "\n  },\n  \"extra\": {";
+    for (size_t i = 0; i < extra.size(); ++i) {
+        out << (i == 0 ? "" : ",") << "\n    \"" << extra[i].first
+            << "\": " << std::setprecision(10) << extra[i].second;
+    }
+    out << "\n  },\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkStats& stats = results[i];
+        out << (i == 0 ? "" : ",") << "\n    {\"name\": \"" << stats.name
+            << "\", \"operations\": " << stats.operations
+            << ", \"repetitions\": " << stats.repetitions
+            << ", \"min_us\": " << stats.min_us
+            << ", \"median_us\": " << stats.median_us
+            << ", \"mean_us\": " << stats.mean_us
+            << ", \"stddev_us\": " << stats.stddev_us
+            << ", \"max_us\": " << stats.max_us << '}';
+    }
+    out << "\n  ]\n}\n" << std::defaultfloat << std::setprecision(6);
+}
+
+// Reads name -> median_us of the results written by WriteBenchmarkJson
+inline std::map<std::string, double> ReadBaselineMedians(std::istream& in) {
+    const std::string text{std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>()};
+    std::map<std::string, double> medians;
+    const std::string name_key = "\"name\": \"";
+    const std::string median_key = "\"median_us\": ";
+    for (size_t pos = text.find(name_key); pos != std::string::npos;
+         pos = text.find(name_key, pos)) {
+        pos += name_key.size();
+        const size_t name_end = text.find('"', pos);
+        const size_t median_pos = text.find(median_key, name_end);
+        if (name_end == std::string::npos || median_pos == std::string::npos) {
+            break;
+        }
+        medians[text.substr(pos, name_end - pos)] =
+                std::stod(text.substr(median_pos + median_key.size()));
+        pos = median_pos;
+    }
+    return medians;
+}
+
+// Prints the change of every median against the baseline and returns
+// the number of cases slower than baseline * (1 + threshold)
+inline int CompareWithBaseline(std::ostream& out,
+                               const std::vector<BenchmarkStats>& results,
+                               const std::map<std::string, double>& baseline,
+                               double threshold) {
+    int regressions = 0;
+    out << std::fixed << std::setprecision(1);
+    for (const BenchmarkStats& stats : results) {
+        const auto it = baseline.find(stats.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            out << std::left << std::setw(22) << stats.name
+                << " no baseline\n";
+            continue;
+        }
+        const double change = (stats.median_us / it->second - 1.0) * 100.0;
+        const bool is_regression = stats.median_us > it->second * (1.0 + threshold);
+        regressions += is_regression;
+        out << std::left << std::setw(22) << stats.name << std::right
+            << std::setw(14) << it->second << " -> "
+            << std::setw(14) << stats.median_us
+            << std::setw(9) << std::showpos << change << std::noshowpos << '%'
+            << (is_regression ? "  REGRESSION" : "") << '\n';
+    }
+    out << std::defaultfloat;
+    return regressions;
+}
@@ -1,203 +1,529 @@
+#include <algorithm>
+#include <execution>
+#include <fstream>
 #include <iostream>
-#include <random>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
-
-#include "logduration.h"
-#include "search_server.h"
+#include "benchmark_corpus.h"
+#include "benchmark_runner.h"
+#include "near_duplicates.h"
 #include "processqueries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
 
 using namespace std;
 
-
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
+struct BenchmarkOptions {
+    CorpusOptions corpus;
+    int warmup = 1;
+    int repetitions = 5;
+    vector<string> cases;
+    string json_path;
+    string baseline_path;
+    double threshold = 0.1;
+};
+
+const vector<string> ALL_CASES = {
+    "index"s, "index_monotonic"s, "index_pool"s,
+    "find_seq"s, "find_par"s, "find_prefix"s, "find_fuzzy"s, "find_bm25"s, "find_mixed"s, "find_partitioned"s, "find_filter"s, "find_accumulate"s, "find_float"s, "find_all"s, "find_boolean"s, "find_page"s, "find_page_after"s, "find_range"s, "find_range_head"s, "match_seq"s, "match_par"s,
+    "remove_seq"s, "remove_par"s, "remove_seq_pool"s, "remove_par_sync_pool"s,
+    "snapshot_remove"s, "copy_remove"s,
+    "dedup"s, "near_dedup"s, "batch"s,
+};
+
+void PrintUsage(ostream& out) {
+    out << "Usage: SearchServer_Benchmark [--option=value ...]\n";
+    PrintCorpusUsage(out);
+    out << "  --warmup=N           untimed runs per case (1)\n"
+           "  --repetitions=N      timed runs per case (5)\n"
+           "  --cases=a,b,...      subset of:";
+    for (const string& name : ALL_CASES) {
+        out << ' ' << name;
     }
-    return word;
+    out << "\n"
+           "  --json=PATH          write results as JSON, - for stdout\n"
+           "  --baseline=PATH      compare medians with a JSON written by --json\n"
+           "  --threshold=F        slowdown counted as regression (0.1)\n";
 }
 
-vector<string> GenerateDictionary(mt19937& generator, 
-                                  int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    sort(words.begin(), words.end());
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator,
-                     const vector<string>& dictionary,
-                     int word_count,
-                     double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
+BenchmarkOptions ParseOptions(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos) {
+            throw invalid_argument("unexpected argument "s + string(arg));
+        }
+        const string key{arg.substr(2, eq - 2)};
+        const string value{arg.substr(eq + 1)};
+        if (ParseCorpusOption(key, value, options.corpus)) {
+            continue;
         }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
+        if (key == "warmup"s) {
+            options.warmup = stoi(value);
+        } else if (key == "repetitions"s) {
+            options.repetitions = stoi(value);
+        } else if (key == "cases"s) {
+            options.cases = SplitByComma(value);
+        } else if (key == "json"s) {
+            options.json_path = value;
+        } else if (key == "baseline"s) {
+            options.baseline_path = value;
+        } else if (key == "threshold"s) {
+            options.threshold = stod(value);
+        } else {
+            throw invalid_argument("unknown option --"s + key);
         }
-        query +=
-            dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
     }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator,
-                               const vector<string>& dictionary,
-                               int query_count,
-                               int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    if (options.corpus.documents <= 0 || options.corpus.vocabulary <= 1
+            || options.corpus.queries <= 0) {
+        throw invalid_argument("documents, vocabulary and queries must be positive"s);
+    }
+    for (const string& name : options.cases) {
+        if (find(ALL_CASES.begin(), ALL_CASES.end(), name) == ALL_CASES.end()) {
+            throw invalid_argument("unknown case "s + name);
+        }
     }
-    return queries;
+    if (options.cases.empty()) {
+        options.cases = ALL_CASES;
+    }
+    return options;
 }
 
+// Keeps the optimizer from dropping the measured calls
+volatile double benchmark_sink = 0;
 
-template <typename QueriesProcessor>
-void Test(string_view mark,
-          QueriesProcessor processor,
-          const SearchServer& search_server,
-          const vector<string>& queries) {
-    LOG_DURATION_STREAM(mark, cout);
-    const auto documents = processor(search_server, queries);
-    cout << "documents size: "s << documents.size() << endl;
-}
+struct NoState {};
 
-#define TEST(processor) Test(#processor, processor, search_server, queries)
+// page 20 of the results, as a result page of a site shows it
+const size_t BENCHMARK_PAGE = 19;
+const size_t BENCHMARK_PAGE_SIZE = 10;
+// what-if removals per run of snapshot_remove and copy_remove
+const int BENCHMARK_WHAT_IF_COUNT = 10;
 
 template <typename ExecutionPolicy>
-void TestRemoveDocument(string_view mark,
-                        SearchServer search_server,
-                        ExecutionPolicy&& policy) {
-    LOG_DURATION_STREAM(mark, cout);
-    const int document_count = search_server.GetDocumentCount();
-    for (int id = 0; id < document_count; ++id) {
-        search_server.RemoveDocument(policy, id);
-    }
-    cout << "SearchServer DocumentCount: "s << search_server.GetDocumentCount() << endl;
+void RunFind(BenchmarkRunner& runner, const string& name, const SearchServer& search_server,
+             const Corpus& corpus, ExecutionPolicy&& policy) {
+    runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+               [&](NoState&) {
+        double total_relevance = 0;
+        for (const string& query : corpus.queries) {
+            for (const Document& document : search_server.FindTopDocuments(policy, query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        benchmark_sink = total_relevance;
+    });
 }
 
-#define TEST_REMOVE_DOCUMENT(policy)                                                          \
-    TestRemoveDocument(#policy, search_server, execution::policy)
+// Three of every four documents banned, so that the default ACTUAL
+// filter keeps a quarter of the postings
+SearchServer MakeMixedStatusServer(const SearchServer& search_server,
+                                   bool is_partitioned) {
+    SearchServer mixed_server{search_server};
+    mixed_server.SetStatusPartitioning(is_partitioned);
+    for (const int document_id : search_server) {
+        if (document_id % 4 != 0) {
+            mixed_server.SetDocumentStatus(document_id, DocumentStatus::BANNED);
+        }
+    }
+    return mixed_server;
+}
 
-template <typename ExecutionPolicy>
-void TestMatchDocument(string_view mark,
-                       SearchServer search_server,
-                       const string& query,
-                       ExecutionPolicy&& policy) {
-    LOG_DURATION_STREAM(mark, cout);
-    const int document_count = search_server.GetDocumentCount();
-    int word_count = 0;
-    for (int id = 0; id < document_count; ++id) {
-        const auto [words, status] = search_server.MatchDocument(policy, query, id);
-        word_count += words.size();
+// Every query word cut to a prefix of at most three letters
+vector<string> MakePrefixQueries(const vector<string>& queries) {
+    vector<string> prefix_queries;
+    prefix_queries.reserve(queries.size());
+    for (const string& query : queries) {
+        string prefix_query;
+        for (const string& word : SplitIntoWords(query)) {
+            if (!prefix_query.empty()) {
+                prefix_query.push_back(' ');
+            }
+            const size_t prefix_size = word[0] == '-' ? 4 : 3;
+            prefix_query += word.substr(0, prefix_size) + '*';
+        }
+        prefix_queries.push_back(move(prefix_query));
     }
-    cout << "word count: "s << word_count << endl;
+    return prefix_queries;
 }
 
-#define TEST_MATCH_DOCUMENT(policy)                                                           \
-    TestMatchDocument(#policy, search_server, query, execution::policy)
+// The same queries in the boolean syntax: the words in parentheses
+vector<string> MakeBooleanQueries(const vector<string>& queries) {
+    vector<string> boolean_queries;
+    boolean_queries.reserve(queries.size());
+    for (const string& query : queries) {
+        boolean_queries.push_back('(' + query + ')');
+    }
+    return boolean_queries;
+}
 
 template <typename ExecutionPolicy>
-void TestFindTopDocuments(string_view mark,
-                          const SearchServer& search_server,
-                          const vector<string>& queries,
-                          ExecutionPolicy&& policy) {
-    LOG_DURATION_STREAM(mark, cout);
-    double total_relevance = 0;
-    for (const string_view query : queries) {
-        for (const auto &document : search_server.FindTopDocuments(policy, query)) {
-            total_relevance += document.relevance;
+void RunMatch(BenchmarkRunner& runner, const string& name, const SearchServer& search_server,
+              const Corpus& corpus, ExecutionPolicy&& policy) {
+    runner.Run(name, corpus.documents.size(), [] { return NoState{}; },
+               [&](NoState&) {
+        size_t word_count = 0;
+        for (size_t id = 0; id < corpus.documents.size(); ++id) {
+            const auto [words, status] = search_server.MatchDocument(
+                        policy, corpus.queries[id % corpus.queries.size()], id);
+            word_count += words.size();
         }
-    }
-    cout << "total relevance: "s << total_relevance << endl;
+        benchmark_sink = word_count;
+    });
 }
 
-#define TEST_FIND_DOC(policy)                                                                 \
-    TestFindTopDocuments(#policy, search_server, queries, execution::policy)
+// Makes the resource the index of a case allocates from,
+// nullptr stands for the default resource
+using ResourceFactory = unique_ptr<pmr::memory_resource> (*)();
 
+unique_ptr<pmr::memory_resource> MakeDefaultResource() {
+    return nullptr;
+}
 
+unique_ptr<pmr::memory_resource> MakeMonotonicResource() {
+    return make_unique<pmr::monotonic_buffer_resource>();
+}
 
-int main() {
-            
-    mt19937 generator;
-    {
-        cout << "\tTESTING PROCESS QUERIES"s << endl;
-        const auto dictionary = GenerateDictionary(generator, 10000, 25);
-        const auto documents = GenerateQueries(generator, dictionary, 100'000, 10);
+unique_ptr<pmr::memory_resource> MakePoolResource() {
+    return make_unique<pmr::unsynchronized_pool_resource>();
+}
 
-        SearchServer search_server(dictionary[0]);
-        for (size_t i = 0; i < documents.size(); ++i) {
-            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
-        }
+unique_ptr<pmr::memory_resource> MakeSynchronizedPoolResource() {
+    return make_unique<pmr::synchronized_pool_resource>();
+}
 
-        const auto queries = GenerateQueries(generator, dictionary, 10'000, 7);
-        TEST(ProcessQueries);
-    }
+pmr::memory_resource* GetResource(const unique_ptr<pmr::memory_resource>& resource) {
+    return resource ? resource.get() : pmr::get_default_resource();
+}
 
-    cout << endl;
+// Building and destroying the index, including the release of the resource
+void RunIndex(BenchmarkRunner& runner, const string& name, const Corpus& corpus,
+              ResourceFactory make_resource) {
+    runner.Run(name, corpus.documents.size(), make_resource,
+               [&](unique_ptr<pmr::memory_resource>& resource) {
+        benchmark_sink = BuildSearchServer(corpus, GetResource(resource))
+                .GetDocumentCount();
+        resource.reset();
+    });
+}
 
-    {
-        cout << "\tTESTING REMOVE DOCUMENT"s << endl;
-        const auto dictionary = GenerateDictionary(generator, 10000, 25);
-        const auto documents = GenerateQueries(generator, dictionary, 10'000, 100);
+struct RemoveState {
+    unique_ptr<pmr::memory_resource> resource;
+    unique_ptr<SearchServer> search_server;
+};
 
-        SearchServer search_server(dictionary[0]);
-        for (size_t i = 0; i < documents.size(); ++i) {
-            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+template <typename ExecutionPolicy>
+void RunRemove(BenchmarkRunner& runner, const string& name, const SearchServer& search_server,
+               ExecutionPolicy&& policy, ResourceFactory make_resource = MakeDefaultResource) {
+    const int document_count = search_server.GetDocumentCount();
+    runner.Run(name, document_count, [&] {
+                   RemoveState state{make_resource(), nullptr};
+                   state.search_server = make_unique<SearchServer>(
+                           search_server, GetResource(state.resource));
+                   return state;
+               },
+               [&](RemoveState& state) {
+        for (int id = 0; id < document_count; ++id) {
+            state.search_server->RemoveDocument(policy, id);
         }
+        benchmark_sink = state.search_server->GetDocumentCount();
+    });
+}
 
-        TEST_REMOVE_DOCUMENT(seq);
-        TEST_REMOVE_DOCUMENT(par);
-    }
-
-    cout << endl;
-
-    {
-        cout << "\tTESTING MATCH DOCUMENT"s << endl;
-        const auto dictionary = GenerateDictionary(generator, 1000, 10);
-        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
-
-        const string query = GenerateQuery(generator, dictionary, 500, 0.1);
+// A document removed from a copy of the index, the index itself is left
+// as it is; the copy is made and destroyed in the timed body
+template <typename CopyFactory>
+void RunWhatIfRemove(BenchmarkRunner& runner, const string& name,
+                     const SearchServer& search_server, CopyFactory make_copy) {
+    const int document_count = search_server.GetDocumentCount();
+    runner.Run(name, BENCHMARK_WHAT_IF_COUNT, [] { return NoState{}; },
+               [&](NoState&) {
+        int total_count = 0;
+        for (int i = 0; i < BENCHMARK_WHAT_IF_COUNT; ++i) {
+            unique_ptr<SearchServer> copy = make_copy();
+            copy->RemoveDocument(i * document_count / BENCHMARK_WHAT_IF_COUNT);
+            total_count += copy->GetDocumentCount();
+        }
+        benchmark_sink = total_count;
+    });
+}
 
-        SearchServer search_server(dictionary[0]);
-        for (size_t i = 0; i < documents.size(); ++i) {
-            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+struct RankingDifferences {
+    int reordered_queries{0};
+    double max_relevance_error{0.0};
+};
+
+// Top documents of the float mode against the double one
+RankingDifferences CompareFloatRanking(const SearchServer& search_server,
+                                       const Corpus& corpus) {
+    SearchServer double_server{search_server};
+    double_server.SetScoringMode(ScoringMode::ACCUMULATE);
+    SearchServer float_server{search_server};
+    float_server.SetScoringMode(ScoringMode::ACCUMULATE_FLOAT);
+    RankingDifferences differences;
+    for (const string& query : corpus.queries) {
+        const vector<Document> expected = double_server.FindTopDocuments(query);
+        const vector<Document> found = float_server.FindTopDocuments(query);
+        bool is_reordered = expected.size() != found.size();
+        for (size_t i = 0; i < min(expected.size(), found.size()); ++i) {
+            is_reordered = is_reordered || expected[i].id != found[i].id;
+            differences.max_relevance_error = max(
+                        differences.max_relevance_error,
+                        abs(expected[i].relevance - found[i].relevance));
         }
-        TEST_MATCH_DOCUMENT(seq);
-        TEST_MATCH_DOCUMENT(par);
+        differences.reordered_queries += is_reordered;
     }
+    return differences;
+}
 
-    cout << endl;
-
-    {
-        cout << "\tTESTING FIND TOP DOCUMENTS"s << endl;
-        const auto dictionary = GenerateDictionary(generator, 1000, 10);
-        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+void RunCase(BenchmarkRunner& runner, const string& name,
+             const SearchServer& search_server, const Corpus& corpus) {
+    if (name == "index"s) {
+        RunIndex(runner, name, corpus, MakeDefaultResource);
+    } else if (name == "index_monotonic"s) {
+        RunIndex(runner, name, corpus, MakeMonotonicResource);
+    } else if (name == "index_pool"s) {
+        RunIndex(runner, name, corpus, MakePoolResource);
+    } else if (name == "find_seq"s) {
+        RunFind(runner, name, search_server, corpus, execution::seq);
+    } else if (name == "find_par"s) {
+        RunFind(runner, name, search_server, corpus, execution::par);
+    } else if (name == "find_prefix"s) {
+        Corpus prefix_corpus;
+        prefix_corpus.queries = MakePrefixQueries(corpus.queries);
+        RunFind(runner, name, search_server, prefix_corpus, execution::seq);
+    } else if (name == "find_fuzzy"s) {
+        SearchServer fuzzy_server{search_server};
+        fuzzy_server.SetFuzzyMatching({2, 0.5});
+        RunFind(runner, name, fuzzy_server, corpus, execution::seq);
+    } else if (name == "find_mixed"s || name == "find_partitioned"s) {
+        const SearchServer mixed_server = MakeMixedStatusServer(
+                    search_server, name == "find_partitioned"s);
+        RunFind(runner, name, mixed_server, corpus, execution::seq);
+    } else if (name == "find_filter"s) {
+        // the query of find_mixed through the columns
+        const SearchServer mixed_server = MakeMixedStatusServer(search_server, false);
+        const DocumentFilter filter{.statuses = StatusMask({DocumentStatus::ACTUAL})};
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            double total_relevance = 0;
+            for (const string& query : corpus.queries) {
+                for (const Document& document : 
+                     mixed_server.FindTopDocuments(query, filter)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            benchmark_sink = total_relevance;
+        });
+    } else if (name == "find_accumulate"s || name == "find_float"s) {
+        SearchServer accumulating_server{search_server};
+        accumulating_server.SetScoringMode(name == "find_float"s 
+                                           ? ScoringMode::ACCUMULATE_FLOAT 
+                                           : ScoringMode::ACCUMULATE);
+        RunFind(runner, name, accumulating_server, corpus, execution::seq);
+    } else if (name == "find_all"s) {
+        SearchServer conjunctive_server{search_server};
+        conjunctive_server.SetMatchMode(MatchMode::ALL);
+        RunFind(runner, name, conjunctive_server, corpus, execution::seq);
+    } else if (name == "find_boolean"s) {
+        SearchServer boolean_server{search_server};
+        boolean_server.SetQuerySyntax(QuerySyntax::BOOLEAN);
+        Corpus boolean_corpus;
+        boolean_corpus.queries = MakeBooleanQueries(corpus.queries);
+        RunFind(runner, name, boolean_server, boolean_corpus, execution::seq);
+    } else if (name == "find_range"s || name == "find_range_head"s) {
+        // every match, or the first ones in the order of ids
+        const size_t limit = name == "find_range"s 
+                ? numeric_limits<size_t>::max() : BENCHMARK_PAGE_SIZE;
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            double total_relevance = 0;
+            for (const string& query : corpus.queries) {
+                size_t count = 0;
+                for (const Document& document : 
+                         search_server.FindAllDocumentsRange(query)) {
+                    total_relevance += document.relevance;
+                    if (++count == limit) {
+                        break;
+                    }
+                }
+            }
+            benchmark_sink = total_relevance;
+        });
+    } else if (name == "find_page"s) {
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            double total_relevance = 0;
+            for (const string& query : corpus.queries) {
+                for (const Document& document : search_server.FindDocumentsPage(
+                         query, BENCHMARK_PAGE, BENCHMARK_PAGE_SIZE).documents) {
+                    total_relevance += document.relevance;
+                }
+            }
+            benchmark_sink = total_relevance;
+        });
+    } else if (name == "find_page_after"s) {
+        // the same pages, continued from the cursors of the pages before
+        vector<optional<SearchCursor>> cursors;
+        for (const string& query : corpus.queries) {
+            cursors.push_back(search_server.FindDocumentsPage(
+                                  query, BENCHMARK_PAGE - 1, 
+                                  BENCHMARK_PAGE_SIZE).next);
+        }
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            double total_relevance = 0;
+            for (size_t i = 0; i < corpus.queries.size(); ++i) {
+                if (!cursors[i]) {
+                    continue;
+                }
+                for (const Document& document : search_server.FindDocumentsPage(
+                         corpus.queries[i], *cursors[i], 
+                         BENCHMARK_PAGE_SIZE).documents) {
+                    total_relevance += document.relevance;
+                }
+            }
+            benchmark_sink = total_relevance;
+        });
+    } else if (name == "find_bm25"s) {
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            double total_relevance = 0;
+            for (const string& query : corpus.queries) {
+                for (const Document& document : 
+                     search_server.FindTopDocuments(Bm25Scorer{}, query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            benchmark_sink = total_relevance;
+        });
+    } else if (name == "match_seq"s) {
+        RunMatch(runner, name, search_server, corpus, execution::seq);
+    } else if (name == "match_par"s) {
+        RunMatch(runner, name, search_server, corpus, execution::par);
+    } else if (name == "remove_seq"s) {
+        RunRemove(runner, name, search_server, execution::seq);
+    } else if (name == "remove_par"s) {
+        RunRemove(runner, name, search_server, execution::par);
+    } else if (name == "remove_seq_pool"s) {
+        RunRemove(runner, name, search_server, execution::seq, MakePoolResource);
+    } else if (name == "remove_par_sync_pool"s) {
+        // the parallel removal frees memory from several threads
+        RunRemove(runner, name, search_server, execution::par,
+                  MakeSynchronizedPoolResource);
+    } else if (name == "snapshot_remove"s) {
+        RunWhatIfRemove(runner, name, search_server, [&search_server] {
+            return make_unique<SearchServer>(search_server);
+        });
+    } else if (name == "copy_remove"s) {
+        RunWhatIfRemove(runner, name, search_server, [&search_server] {
+            return make_unique<SearchServer>(search_server, 
+                                             search_server.GetMemoryResource());
+        });
+    } else if (name == "dedup"s) {
+        runner.Run(name, corpus.documents.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            benchmark_sink = FindDuplicates(search_server).size();
+        });
+    } else if (name == "near_dedup"s) {
+        runner.Run(name, corpus.documents.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            benchmark_sink = FindNearDuplicates(search_server).size();
+        });
+    } else if (name == "batch"s) {
+        runner.Run(name, corpus.queries.size(), [] { return NoState{}; },
+                   [&](NoState&) {
+            benchmark_sink = ProcessQueries(search_server, corpus.queries).size();
+        });
+    }
+}
 
-        SearchServer search_server(dictionary[0]);
-        for (size_t i = 0; i < documents.size(); ++i) {
-            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (argv[i] == "--help"sv) {
+                PrintUsage(cout);
+                return 0;
+            }
         }
+        options = ParseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage(cerr);
+        return 2;
+    }
 
-        const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+    // with JSON on stdout the human-readable report goes to stderr
+    ostream& report = options.json_path == "-"s ? cerr : cout;
 
-        TEST_FIND_DOC(seq);
-        TEST_FIND_DOC(par);
+    const Corpus corpus = GenerateCorpus(options.corpus);
+    const SearchServer search_server = BuildSearchServer(corpus);
+    const SearchServerMemoryUsage memory = search_server.GetMemoryUsage();
+    report << memory << endl;
+
+    BenchmarkRunner runner{options.warmup, options.repetitions};
+    for (const string& name : options.cases) {
+        RunCase(runner, name, search_server, corpus);
+    }
+    PrintBenchmarkTable(report, runner.GetResults());
+    
+    vector<pair<string, double>> extra = {
+        {"index_bytes"s, static_cast<double>(memory.GetTotal().bytes)},
+        {"index_allocations"s, static_cast<double>(memory.GetTotal().allocations)},
+    };
+    if (find(options.cases.begin(), options.cases.end(), "find_float"s) 
+            != options.cases.end()) {
+        const RankingDifferences differences = CompareFloatRanking(search_server, 
+                                                                   corpus);
+        report << "\nfind_float: top documents differ from double for "s
+               << differences.reordered_queries << " of "s 
+               << corpus.queries.size() << " queries, max relevance error "s
+               << differences.max_relevance_error 
+               << (differences.max_relevance_error < EPSILON 
+                   ? " (within EPSILON)"s : " (above EPSILON)"s) << endl;
+        extra.emplace_back("float_reordered_queries"s, 
+                           differences.reordered_queries);
+        extra.emplace_back("float_max_relevance_error"s, 
+                           differences.max_relevance_error);
     }
 
-    cout << endl;
+    if (!options.json_path.empty()) {
+        vector<pair<string, string>> config = DescribeCorpusOptions(options.corpus);
+        config.emplace_back("warmup"s, to_string(options.warmup));
+        config.emplace_back("repetitions"s, to_string(options.repetitions));
+        if (options.json_path == "-"s) {
+            WriteBenchmarkJson(cout, config, extra, runner.GetResults());
+        } else {
+            ofstream out{options.json_path};
+            WriteBenchmarkJson(out, config, extra, runner.GetResults());
+            if (!out) {
+                cerr << "cannot write "s << options.json_path << endl;
+                return 2;
+            }
+        }
+    }
 
+    if (!options.baseline_path.empty()) {
+        ifstream in{options.baseline_path};
+        if (!in) {
+            cerr << "cannot read "s << options.baseline_path << endl;
+            return 2;
+        }
+        report << "\nCompared with "s << options.baseline_path << ":\n"s;
+        const int regressions = CompareWithBaseline(report, runner.GetResults(),
+                                                    ReadBaselineMedians(in),
+                                                    options.threshold);
+        if (regressions > 0) {
+            report << regressions << " regression(s)"s << endl;
+            return 1;
+        }
+    }
     return 0;
 }
@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "benchmark_corpus.h"
+#include "benchmark_runner.h"
+#include "latency_histogram.h"
+#include "search_server.h"
+
+using namespace std;
+using namespace chrono;
+
+enum class Operation {
+    FIND,
+    ADD,
+    REMOVE,
+};
+
+constexpr size_t OPERATION_COUNT = 3;
+const array<string, OPERATION_COUNT> OPERATION_NAMES = {"find"s, "add"s, "remove"s};
+
+struct LoadOptions {
+    CorpusOptions corpus;
+    int threads = static_cast<int>(max(4u, thread::hardware_concurrency()));
+    double qps = 0;
+    double duration = 10;
+    array<double, OPERATION_COUNT> mix = {90, 8, 2};
+    string query_log;
+    double slo_p99_ms = 0;
+    int search_steps = 4;
+};
+
+void PrintUsage(ostream& out) {
+    out << "Usage: SearchServer_Load [--option=value ...]\n";
+    PrintCorpusUsage(out);
+    out << "  --threads=N          concurrent clients (max(4, cores))\n"
+           "  --qps=R              open loop at R requests per second,\n"
+           "                       0 is closed loop: every client sends the next\n"
+           "                       request when the previous one is done (0)\n"
+           "  --duration=S         seconds per run (10)\n"
+           "  --mix=find:P,add:P,remove:P  operation weights (find:90,add:8,remove:2)\n"
+           "  --query-log=PATH     replay the queries of the file, one per line,\n"
+           "                       instead of the generated ones\n"
+           "  --slo-p99-ms=T       search the highest rate with p99 latency <= T ms,\n"
+           "                       starting from --qps (100 when not set)\n"
+           "  --search-steps=N     bisection steps of the search (4)\n";
+}
+
+LoadOptions ParseOptions(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (arg.substr(0, 2) != "--"sv || eq == arg.npos) {
+            throw invalid_argument("unexpected argument "s + string(arg));
+        }
+        const string key{arg.substr(2, eq - 2)};
+        const string value{arg.substr(eq + 1)};
+        if (ParseCorpusOption(key, value, options.corpus)) {
+            continue;
+        }
+        if (key == "threads"s) {
+            options.threads = stoi(value);
+        } else if (key == "qps"s) {
+            options.qps = stod(value);
+        } else if (key == "duration"s) {
+            options.duration = stod(value);
+        } else if (key == "mix"s) {
+            options.mix = {0, 0, 0};
+            for (const string& item : SplitByComma(value)) {
+                const size_t colon = item.find(':');
+                const auto name = find(OPERATION_NAMES.begin(), OPERATION_NAMES.end(),
+                                       item.substr(0, colon));
+                if (colon == item.npos || name == OPERATION_NAMES.end()) {
+                    throw invalid_argument("bad mix item "s + item);
+                }
+                options.mix[name - OPERATION_NAMES.begin()] = stod(item.substr(colon + 1));
+            }
+        } else if (key == "query-log"s) {
+            options.query_log = value;
+        } else if (key == "slo-p99-ms"s) {
+            options.slo_p99_ms = stod(value);
+        } else if (key == "search-steps"s) {
+            options.search_steps = stoi(value);
+        } else {
+            throw invalid_argument("unknown option --"s + key);
+        }
+    }
+    if (options.threads <= 0 || options.duration <= 0 || options.qps < 0) {
+        throw invalid_argument("threads and duration must be positive"s);
+    }
+    if (options.mix[0] + options.mix[1] + options.mix[2] <= 0) {
+        throw invalid_argument("empty operation mix"s);
+    }
+    return options;
+}
+
+// SearchServer is not synchronized, so the tester serializes writers
+// with a shared mutex the way a service embedding it would
+class LoadTarget {
+public:
+    LoadTarget(const Corpus& corpus, vector<string> queries):
+        corpus_{corpus},
+        queries_{move(queries)},
+        search_server_{BuildSearchServer(corpus)},
+        next_document_id_{static_cast<int>(corpus.documents.size())}
+    {
+        live_ids_.reserve(corpus.documents.size());
+        for (const int id : search_server_) {
+            live_ids_.push_back(id);
+        }
+    }
+
+    void Execute(Operation operation, uint64_t sequence, mt19937& generator) {
+        switch (operation) {
+        case Operation::FIND: {
+            shared_lock guard{mutex_};
+            const string& query = queries_[sequence % queries_.size()];
+            benchmark_sink_ = search_server_.FindTopDocuments(query).size();
+            break;
+        }
+        case Operation::ADD: {
+            const string& text = corpus_.documents[sequence % corpus_.documents.size()];
+            unique_lock guard{mutex_};
+            search_server_.AddDocument(next_document_id_, text,
+                                       DocumentStatus::ACTUAL, {1, 2, 3});
+            live_ids_.push_back(next_document_id_++);
+            break;
+        }
+        case Operation::REMOVE: {
+            unique_lock guard{mutex_};
+            if (live_ids_.empty()) {
+                break;
+            }
+            const size_t index = uniform_int_distribution<size_t>(
+                        0, live_ids_.size() - 1)(generator);
+            swap(live_ids_[index], live_ids_.back());
+            search_server_.RemoveDocument(live_ids_.back());
+            live_ids_.pop_back();
+            break;
+        }
+        }
+    }
+
+    size_t GetDocumentCount() {
+        shared_lock guard{mutex_};
+        return live_ids_.size();
+    }
+
+private:
+    const Corpus& corpus_;
+    const vector<string> queries_;
+    shared_mutex mutex_;
+    SearchServer search_server_;
+    vector<int> live_ids_;
+    int next_document_id_;
+    atomic<size_t> benchmark_sink_{0};
+};
+
+struct Sample {
+    Operation operation;
+    // from the moment the request was due to be sent
+    nanoseconds latency;
+    // from the moment the request was actually sent
+    nanoseconds service_time;
+};
+
+struct RunResult {
+    double target_qps{0};
+    double achieved_qps{0};
+    size_t completed{0};
+    array<LatencySummary, OPERATION_COUNT> operations;
+    LatencySummary latency;
+    LatencySummary service_time;
+};
+
+// Adds the requests a stalled closed-loop client would have sent: a sample
+// longer than the expected interval stands for the whole queue of requests
+// that waited behind it (HdrHistogram's recordValueWithExpectedInterval)
+void RecordCorrected(LatencyHistogram& histogram, nanoseconds value,
+                     nanoseconds expected_interval) {
+    histogram.Record(value);
+    if (expected_interval <= nanoseconds::zero()) {
+        return;
+    }
+    constexpr int max_backfill = 1 << 16;
+    nanoseconds missing = value - expected_interval;
+    for (int i = 0; i < max_backfill && missing >= expected_interval; ++i) {
+        histogram.Record(missing);
+        missing -= expected_interval;
+    }
+}
+
+// Open loop (qps > 0): request k is due at start + k / qps whether or not
+// the previous ones are done, and its latency counts from that moment, so
+// a stall shows up in the latency of every request it delayed.
+// Closed loop (qps == 0): every client sends back to back, the latency
+// is corrected with RecordCorrected over the median service time.
+RunResult RunLoad(LoadTarget& target, const LoadOptions& options, double qps) {
+    using Clock = steady_clock;
+    const bool is_open_loop = qps > 0;
+    const auto period = is_open_loop
+            ? duration_cast<Clock::duration>(duration<double>(1.0 / qps))
+            : Clock::duration::zero();
+    const auto start = Clock::now() + milliseconds(10);
+    const auto finish = start + duration_cast<Clock::duration>(
+                duration<double>(options.duration));
+
+    atomic<uint64_t> next_ticket{0};
+    vector<vector<Sample>> samples(options.threads);
+    vector<Clock::time_point> last_finish(options.threads, start);
+
+    auto worker = [&](int thread_index) {
+        mt19937 generator{static_cast<unsigned>(options.corpus.seed + thread_index)};
+        discrete_distribution<size_t> pick_operation{options.mix.begin(), options.mix.end()};
+        this_thread::sleep_until(start);
+        while (true) {
+            const uint64_t ticket = next_ticket.fetch_add(1, memory_order_relaxed);
+            Clock::time_point due = Clock::now();
+            if (is_open_loop) {
+                due = start + period * ticket;
+                if (due >= finish) {
+                    break;
+                }
+                this_thread::sleep_until(due);
+            } else if (due >= finish) {
+                break;
+            }
+            const auto operation = static_cast<Operation>(pick_operation(generator));
+            const auto sent = Clock::now();
+            target.Execute(operation, ticket, generator);
+            const auto done = Clock::now();
+            samples[thread_index].push_back(Sample{operation, done - due, done - sent});
+            last_finish[thread_index] = done;
+        }
+    };
+
+    vector<thread> threads;
+    threads.reserve(options.threads);
+    for (int i = 0; i < options.threads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    LatencyHistogram service_time;
+    for (const auto& thread_samples : samples) {
+        for (const Sample& sample : thread_samples) {
+            service_time.Record(sample.service_time);
+        }
+    }
+    const nanoseconds expected_interval = is_open_loop
+            ? nanoseconds::zero()
+            : service_time.GetSummary().p50;
+
+    RunResult result;
+    result.target_qps = qps;
+    array<LatencyHistogram, OPERATION_COUNT> operations;
+    LatencyHistogram latency;
+    for (const auto& thread_samples : samples) {
+        for (const Sample& sample : thread_samples) {
+            RecordCorrected(operations[static_cast<size_t>(sample.operation)],
+                            sample.latency, expected_interval);
+            RecordCorrected(latency, sample.latency, expected_interval);
+        }
+        result.completed += thread_samples.size();
+    }
+    const auto elapsed = *max_element(last_finish.begin(), last_finish.end()) - start;
+    result.achieved_qps = result.completed / max(duration<double>(elapsed).count(), 1e-9);
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) {
+        result.operations[i] = operations[i].GetSummary();
+    }
+    result.latency = latency.GetSummary();
+    result.service_time = service_time.GetSummary();
+    return result;
+}
+
+double ToMilliseconds(nanoseconds value) {
+    return duration<double, milli>(value).count();
+}
+
+void PrintSummaryRow(ostream& out, const string& name, const LatencySummary& summary) {
+    out << left << setw(10) << name << right
+        << setw(10) << summary.count
+        << setw(10) << ToMilliseconds(summary.p50)
+        << setw(10) << ToMilliseconds(summary.p90)
+        << setw(10) << ToMilliseconds(summary.p99)
+        << setw(10) << ToMilliseconds(summary.p999)
+        << setw(10) << ToMilliseconds(summary.max) << '\n';
+}
+
+void PrintRunResult(ostream& out, const RunResult& result) {
+    out << fixed << setprecision(2);
+    if (result.target_qps > 0) {
+        out << "target "s << result.target_qps << " qps, "s;
+    } else {
+        out << "closed loop, "s;
+    }
+    out << "achieved "s << result.achieved_qps << " qps\n"s;
+    out << left << setw(10) << "ms" << right << setw(10) << "count"
+        << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99"
+        << setw(10) << "p99.9" << setw(10) << "max" << '\n';
+    for (size_t i = 0; i < OPERATION_COUNT; ++i) {
+        if (result.operations[i].count > 0) {
+            PrintSummaryRow(out, OPERATION_NAMES[i], result.operations[i]);
+        }
+    }
+    PrintSummaryRow(out, "all"s, result.latency);
+    PrintSummaryRow(out, "service"s, result.service_time);
+    out << defaultfloat;
+}
+
+bool IsSustainable(const RunResult& result, double slo_p99_ms) {
+    return ToMilliseconds(result.latency.p99) <= slo_p99_ms
+            && result.achieved_qps >= result.target_qps * 0.95;
+}
+
+// Doubles the rate until the SLO breaks, then bisects between the last
+// sustainable and the first failing rate
+double FindMaxThroughput(LoadTarget& target, const LoadOptions& options) {
+    auto run = [&](double qps) {
+        const RunResult result = RunLoad(target, options, qps);
+        const bool is_sustainable = IsSustainable(result, options.slo_p99_ms);
+        cout << fixed << setprecision(2) << "target "s << setw(10) << qps
+             << " qps: achieved "s << setw(10) << result.achieved_qps
+             << ", p99 "s << setw(9) << ToMilliseconds(result.latency.p99) << " ms"s
+             << (is_sustainable ? "  ok"s : "  FAIL"s) << defaultfloat << endl;
+        return is_sustainable;
+    };
+
+    double good = 0;
+    double bad = options.qps > 0 ? options.qps : 100;
+    for (int step = 0; step < 30 && run(bad); ++step) {
+        good = bad;
+        bad *= 2;
+    }
+    for (int step = 0; step < options.search_steps; ++step) {
+        const double middle = (good + bad) / 2;
+        if (run(middle)) {
+            good = middle;
+        } else {
+            bad = middle;
+        }
+    }
+    return good;
+}
+
+vector<string> ReadQueryLog(const string& path) {
+    ifstream in{path};
+    if (!in) {
+        throw invalid_argument("cannot read "s + path);
+    }
+    vector<string> queries;
+    for (string line; getline(in, line);) {
+        if (!line.empty()) {
+            queries.push_back(move(line));
+        }
+    }
+    if (queries.empty()) {
+        throw invalid_argument("no queries in "s + path);
+    }
+    return queries;
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    vector<string> queries;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (argv[i] == "--help"sv) {
+                PrintUsage(cout);
+                return 0;
+            }
+        }
+        options = ParseOptions(argc, argv);
+        if (!options.query_log.empty()) {
+            queries = ReadQueryLog(options.query_log);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage(cerr);
+        return 2;
+    }
+
+    const Corpus corpus = GenerateCorpus(options.corpus);
+    if (queries.empty()) {
+        queries = corpus.queries;
+    }
+    LoadTarget target{corpus, move(queries)};
+    cout << "documents: "s << target.GetDocumentCount()
+         << ", clients: "s << options.threads << endl;
+
+    if (options.slo_p99_ms > 0) {
+        const double max_qps = FindMaxThroughput(target, options);
+        cout << "max sustainable throughput at p99 <= "s << options.slo_p99_ms
+             << " ms: "s << fixed << setprecision(1) << max_qps << " qps"s << endl;
+        return 0;
+    }
+    PrintRunResult(cout, RunLoad(target, options, options.qps));
+    return 0;
+}
@@ -1,7 +1,11 @@
 
 
 #include <cmath>
+#include <cstdlib>
+#include <new>
+#include <sstream>
 
+#include "near_duplicates.h"
 #include "paginator.h"
 #include "remove_duplicates.h"
 #include "processqueries.h"
@@ -12,6 +16,109 @@
 
 using namespace std;
 
+// Heap allocations made by the calling thread. Every form of the global
+// operator new is replaced, so that every operator delete matches it.
+thread_local size_t allocation_count = 0;
+
+void* Allocate(size_t size, size_t alignment) noexcept {
+    ++allocation_count;
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= alignof(max_align_t)) {
+        return malloc(size);
+    }
+    // aligned_alloc needs a size which is a multiple of the alignment
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* AllocateOrThrow(size_t size, size_t alignment) {
+    if (void* p = Allocate(size, alignment)) {
+        return p;
+    }
+    throw bad_alloc{};
+}
+
+void* operator new(size_t size) {
+    return AllocateOrThrow(size, alignof(max_align_t));
+}
+
+void* operator new[](size_t size) {
+    return AllocateOrThrow(size, alignof(max_align_t));
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return Allocate(size, alignof(max_align_t));
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return Allocate(size, alignof(max_align_t));
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept {
+    free(p);
+}
+
 SearchServer GetSearchServer() {
     SearchServer server(""s);
     server.AddDocument(0, "dog in the cat cat happy"s, DocumentStatus::ACTUAL, {1});
@@ -33,8 +140,8 @@ SearchServer GetSearchServerDifferentDocsStatus() {
 }
 
 #define FIND_DOC_WITH_STATUS(server, doc_status)                                              \
-    server.FindTopDocuments("cat dog"s, [](int document_id, DocumentStatus status,            \
-                                           int rating) { return status == doc_status; })
+    server.FindTopDocuments("cat dog"s, [](int, DocumentStatus status,                        \
+                                           int) { return status == doc_status; })
 
 void TestStopWordStringConstructor() {
     const int doc_id = 42;
@@ -355,7 +462,7 @@ void TestFoundDocumentsMinusRating() {
 void TestUserFilterFoundDocuments() {
     SearchServer server = GetSearchServer();
 
-    auto IsEvenDocId = [](int document_id, DocumentStatus status, int rating) {
+    auto IsEvenDocId = [](int document_id, DocumentStatus, int) {
         return document_id % 2 == 0;
     };
 
@@ -478,6 +585,59 @@ void TestRequestQueue() {
     ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1437);
 }
 
+void TestRequestStatisticsWindow() {
+    using Clock = RequestStatistics::Clock;
+    RequestStatistics statistics(chrono::seconds{10});
+
+    const Clock::time_point start = Clock::now();
+    for (int i = 1; i <= 100; ++i) {
+        statistics.Record(start + chrono::milliseconds{i}, chrono::microseconds{i},
+                          i % 4 == 0 ? 0 : 3);
+    }
+
+    const auto report = statistics.GetReport(start + chrono::seconds{1});
+    ASSERT_EQUAL(report.requests, 100u);
+    ASSERT_EQUAL(report.no_result_requests, 25u);
+    ASSERT(std::abs(report.no_result_rate - 0.25) < EPSILON);
+    ASSERT(report.queries_per_second > 0.0);
+    ASSERT_EQUAL(report.latency_p50.count(), 51'000);
+    ASSERT_EQUAL(report.latency_p90.count(), 91'000);
+    ASSERT_EQUAL(report.latency_p99.count(), 100'000);
+
+    // the first half of the requests has left the window
+    const auto later = statistics.GetReport(start + chrono::seconds{10}
+                                            + chrono::milliseconds{50});
+    ASSERT_EQUAL(later.requests, 50u);
+    ASSERT_EQUAL(later.no_result_requests, 13u);
+
+    ASSERT_EQUAL(statistics.GetReport(start + chrono::minutes{1}).requests, 0u);
+}
+
+void TestConcurrentRequestQueue() {
+    SearchServer server("and on at"s);
+    server.AddDocument(1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "fluffy dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+
+    ConcurrentRequestQueue request_queue(server);
+
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&request_queue] {
+            for (int i = 0; i < 250; ++i) {
+                request_queue.AddFindRequest(i % 5 == 0 ? "empty request"s : "fluffy"s);
+            }
+        });
+    }
+    for (thread &worker : threads) {
+        worker.join();
+    }
+
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 200);
+    const auto report = request_queue.GetStatistics();
+    ASSERT_EQUAL(report.requests, 1000u);
+    ASSERT(report.latency_p50 <= report.latency_p99);
+}
+
 void TestRemoveDuplicates() {
     SearchServer server("and with"s);
 
@@ -519,6 +679,81 @@ void TestRemoveDuplicates() {
     ASSERT_EQUAL(server.GetDocumentCount(), 5);
 }
 
+void TestFindDuplicates() {
+    SearchServer server("and with"s);
+
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL,
+                       {1, 2});
+    server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL,
+                       {1, 2});
+    server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+
+    ASSERT_EQUAL(FindDuplicates(server), (vector<int>{3, 4, 5, 7}));
+    ASSERT_EQUAL(server.GetDocumentCount(), 9);
+}
+
+void TestDuplicateDetectionOnAdd() {
+    SearchServer server("and with"s);
+    server.AddDocument(5, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+
+    server.SetDuplicateDetection(true);
+    ASSERT(!server.GetDuplicateOriginal(5).has_value());
+
+    // duplicate with a lower id is added later, it becomes the original
+    server.AddDocument(2, "rat nasty pet funny"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(8, "nasty rat with funny pet"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "funny pet"s, DocumentStatus::ACTUAL, {1});
+
+    ASSERT(!server.GetDuplicateOriginal(2).has_value());
+    ASSERT_EQUAL(server.GetDuplicateOriginal(5).value(), 2);
+    ASSERT_EQUAL(server.GetDuplicateOriginal(8).value(), 2);
+    ASSERT(!server.GetDuplicateOriginal(3).has_value());
+
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(server.GetDuplicateOriginal(8).value(), 5);
+
+    server.RemoveDocument(execution::par, 5);
+    ASSERT(!server.GetDuplicateOriginal(8).has_value());
+}
+
+void TestFindNearDuplicates() {
+    SearchServer server("and with"s);
+
+    const string boilerplate = "terms of use privacy policy contact us about company "
+                               "careers press blog help center status jobs team news"s;
+    server.AddDocument(1, "first offer "s + boilerplate, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "curly hair and funny pet"s, DocumentStatus::ACTUAL, {1});
+    // one changed word
+    server.AddDocument(3, "second offer "s + boilerplate, DocumentStatus::ACTUAL, {1});
+    // exact copy
+    server.AddDocument(4, "first offer "s + boilerplate, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(6, "nasty rat"s, DocumentStatus::ACTUAL, {1});
+
+    const auto clusters = FindNearDuplicates(server);
+    ASSERT_EQUAL(clusters.size(), 2u);
+    ASSERT_EQUAL(clusters[0], (vector<int>{1, 3, 4}));
+    ASSERT_EQUAL(clusters[1], (vector<int>{2, 5}));
+
+    // Jaccard similarity of documents 1 and 3 is 19/21
+    NearDuplicateOptions strict;
+    strict.jaccard_threshold = 0.95;
+    const auto strict_clusters = FindNearDuplicates(server, strict);
+    ASSERT_EQUAL(strict_clusters.size(), 2u);
+    ASSERT_EQUAL(strict_clusters[0], (vector<int>{1, 4}));
+
+    // a single band per pass still gives the same result
+    NearDuplicateOptions small_budget;
+    small_budget.memory_budget_bytes = 6 * (sizeof(int) + sizeof(void*) + 4 + 8 + 1 + 16);
+    ASSERT_EQUAL(FindNearDuplicates(server, small_budget), clusters);
+}
+
 void TestProcessQueries() {
     SearchServer search_server("and with"s);
 
@@ -581,6 +816,1675 @@ void TestProcessQueriesJoined() {
     result.pop_front();
 }
 
+void TestLatencyHistogram() {
+    LatencyHistogram histogram;
+    ASSERT_EQUAL(histogram.GetSummary().count, 0u);
+
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.Record(chrono::microseconds{i});
+    }
+
+    const LatencySummary summary = histogram.GetSummary();
+    ASSERT_EQUAL(summary.count, 1000u);
+    const auto is_close = [](chrono::nanoseconds value, chrono::microseconds expected) {
+        return std::abs(value.count() - chrono::nanoseconds{expected}.count())
+               <= chrono::nanoseconds{expected}.count() / 16;
+    };
+    ASSERT(is_close(summary.p50, chrono::microseconds{500}));
+    ASSERT(is_close(summary.p90, chrono::microseconds{900}));
+    ASSERT(is_close(summary.p99, chrono::microseconds{990}));
+    ASSERT(is_close(summary.p999, chrono::microseconds{999}));
+    ASSERT(is_close(summary.max, chrono::microseconds{1000}));
+
+    histogram.Reset();
+    ASSERT_EQUAL(histogram.GetSummary().count, 0u);
+}
+
+void TestSearchServerLatencyStats() {
+    SearchServer server = GetSearchServer();
+    ASSERT(server.GetLatencyStats().empty());
+
+    server.SetLatencyStats(true);
+    server.AddDocument(50, "fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    server.FindTopDocuments("cat"s);
+    server.FindTopDocuments("cat"s, DocumentStatus::BANNED);
+    server.FindTopDocuments(execution::par, "cat"s);
+    server.MatchDocument("cat"s, 50);
+    server.MatchDocument(execution::par, "cat"s, 50);
+    server.MatchDocument(execution::seq, "cat"s, 50);
+    server.RemoveDocument(50);
+
+    auto stats = server.GetLatencyStats();
+    ASSERT_EQUAL(stats.at(SearchOperation::ADD_DOCUMENT).count, 1u);
+    ASSERT_EQUAL(stats.at(SearchOperation::FIND_TOP_DOCUMENTS_SEQ).count, 2u);
+    ASSERT_EQUAL(stats.at(SearchOperation::FIND_TOP_DOCUMENTS_PAR).count, 1u);
+    ASSERT_EQUAL(stats.at(SearchOperation::MATCH_DOCUMENT).count, 3u);
+    ASSERT_EQUAL(stats.at(SearchOperation::REMOVE_DOCUMENT).count, 1u);
+    ASSERT(stats.at(SearchOperation::ADD_DOCUMENT).p50.count() > 0);
+
+    server.ResetLatencyStats();
+    stats = server.GetLatencyStats();
+    ASSERT_EQUAL(stats.at(SearchOperation::FIND_TOP_DOCUMENTS_SEQ).count, 0u);
+
+    // a parallel call on the sequential path counts once, as sequential
+    server.AddDocument(50, "fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    server.SetMatchMode(MatchMode::ALL);
+    server.FindTopDocuments(execution::par, "fluffy cat"s);
+    server.MatchDocument(execution::par, "fluffy cat"s, 50);
+    server.SetMatchMode(MatchMode::ANY);
+    stats = server.GetLatencyStats();
+    ASSERT_EQUAL(stats.at(SearchOperation::FIND_TOP_DOCUMENTS_SEQ).count, 1u);
+    ASSERT_EQUAL(stats.at(SearchOperation::FIND_TOP_DOCUMENTS_PAR).count, 0u);
+    ASSERT_EQUAL(stats.at(SearchOperation::MATCH_DOCUMENT).count, 1u);
+
+    server.SetLatencyStats(false);
+    server.FindTopDocuments("cat"s);
+    ASSERT(server.GetLatencyStats().empty());
+}
+
+void TestQueryTracerChromeExport() {
+    QueryTracer &tracer = QueryTracer::Instance();
+    const double sample_rate = tracer.GetSampleRate();
+    tracer.Clear();
+
+    tracer.SetSampleRate(0.0);
+    {
+        TraceQueryScope query("Query");
+        TraceSpan span("Phase");
+    }
+    ASSERT(tracer.GetEvents().empty());
+
+    tracer.SetSampleRate(1.0);
+    {
+        TraceQueryScope query("Query");
+        {
+            TraceQueryScope nested("NestedQuery");
+            TraceSpan span("Phase \"quoted\"");
+        }
+    }
+    const auto events = tracer.GetEvents();
+    ASSERT_EQUAL(events.size(), 2u);
+    ASSERT_EQUAL(string(events[0].name), "Phase \"quoted\""s);
+    ASSERT_EQUAL(string(events[1].name), "Query"s);
+    ASSERT_EQUAL(events[0].query_id, events[1].query_id);
+    ASSERT(events[0].duration <= events[1].duration);
+
+    ostringstream out;
+    tracer.WriteChromeTrace(out);
+    const string json = out.str();
+    ASSERT(json.find("{\"traceEvents\":["s) == 0);
+    ASSERT(json.find("\"name\":\"Phase \\\"quoted\\\"\""s) != string::npos);
+    ASSERT(json.find("\"ph\":\"X\""s) != string::npos);
+
+#ifdef SEARCH_SERVER_TRACING
+    tracer.Clear();
+    GetSearchServer().FindTopDocuments("cat -dog"s);
+    const auto query_events = tracer.GetEvents();
+    ASSERT_EQUAL(string(query_events.back().name), "FindTopDocuments"s);
+    ASSERT(query_events.size() > 4u);
+#endif
+
+    tracer.SetSampleRate(sample_rate);
+    tracer.Clear();
+}
+
+void TestMemoryUsage() {
+    SearchServer server("and in"s);
+    const SearchServerMemoryUsage empty = server.GetMemoryUsage();
+    ASSERT(empty.stop_words.allocations > 0u);
+    ASSERT_EQUAL(empty.word_to_document_freqs.bytes, 0u);
+    ASSERT_EQUAL(empty.document_count, 0);
+
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "a very long word: supercalifragilisticexpialidocious"s,
+                       DocumentStatus::ACTUAL, {1});
+    const SearchServerMemoryUsage filled = server.GetMemoryUsage();
+    ASSERT(filled.unique_words.allocations > 0u);
+    ASSERT(filled.word_to_document_freqs.bytes > 0u);
+    ASSERT(filled.document_to_word_freqs.bytes > 0u);
+    ASSERT(filled.documents.bytes > 0u);
+    ASSERT_EQUAL(filled.document_count, 2);
+    ASSERT(filled.GetTotal().bytes > empty.GetTotal().bytes);
+
+    server.RemoveDocument(1);
+    server.RemoveDocument(2);
+    const SearchServerMemoryUsage removed = server.GetMemoryUsage();
+    ASSERT_EQUAL(removed.word_to_document_freqs.bytes, 0u);
+    ASSERT_EQUAL(removed.document_to_word_freqs.bytes, 0u);
+    ASSERT_EQUAL(removed.documents.allocations, 0u);
+
+    ostringstream out;
+    out << filled;
+    ASSERT(out.str().find("bytes per document"s) != string::npos);
+}
+
+void TestCopyOwnsWords() {
+    auto original = make_unique<SearchServer>("in the"s);
+    original->AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    original->AddDocument(2, "dog in the city"s, DocumentStatus::ACTUAL, {2});
+
+    const SearchServer copy = *original;
+    ASSERT_EQUAL(copy.GetMemoryUsage().GetTotal().bytes,
+                 original->GetMemoryUsage().GetTotal().bytes);
+    original.reset();
+
+    const auto found_docs = copy.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(found_docs[0].id, 1);
+
+    const auto [matched_words, _] = copy.MatchDocument("dog city"s, 2);
+    ASSERT_EQUAL(matched_words, (vector<string_view>{"city"sv, "dog"sv}));
+    ASSERT(copy.FindTopDocuments("in"s).empty());
+}
+
+void TestCustomMemoryResource() {
+    pmr::monotonic_buffer_resource arena;
+    AccountingResource counted_arena{&arena};
+    {
+        SearchServer server("in the"s, &counted_arena);
+        ASSERT_EQUAL(server.GetMemoryResource(), &counted_arena);
+        server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+        server.AddDocument(2, "dog in the city"s, DocumentStatus::ACTUAL, {2});
+        ASSERT_EQUAL(counted_arena.GetUsage().bytes,
+                     server.GetMemoryUsage().GetTotal().bytes);
+
+        AccountingResource copy_resource;
+        const SearchServer copy{server, &copy_resource};
+        ASSERT_EQUAL(copy.GetMemoryResource(), &copy_resource);
+        ASSERT_EQUAL(copy_resource.GetUsage().bytes,
+                     copy.GetMemoryUsage().GetTotal().bytes);
+        const SearchServer same_resource_copy = copy;
+        ASSERT_EQUAL(same_resource_copy.GetMemoryResource(), &copy_resource);
+
+        server.RemoveDocument(1);
+        const auto found_docs = copy.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("city"s).size(), 1u);
+    }
+    ASSERT_EQUAL(counted_arena.GetUsage().bytes, 0u);
+}
+
+void TestQueryContextDoesNotAllocate() {
+    const SearchServer server = GetSearchServer();
+    const vector<string> queries = {
+        "cat dog happy city -full -in"s, "cat"s, "dog -city"s, "happy cat -in"s,
+    };
+    vector<vector<Document>> expected;
+    for (const string& query : queries) {
+        expected.push_back(server.FindTopDocuments(query));
+    }
+    const auto is_even = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    const auto expected_even = server.FindTopDocuments("cat"s, is_even);
+
+#ifdef SEARCH_SERVER_TRACING
+    QueryTracer::Instance().SetSampleRate(0.0);
+#endif
+    SearchServer::QueryContext context;
+    for (const string& query : queries) {
+        server.FindTopDocuments(context, query);
+    }
+    const size_t warm_allocation_count = allocation_count;
+    size_t found_count = 0;
+    for (const string& query : queries) {
+        found_count += server.FindTopDocuments(context, query).size();
+    }
+    const auto& found_even = server.FindTopDocuments(context, queries[1], is_even);
+    // read before the assertion macros, which build strings themselves
+    const size_t query_allocation_count = allocation_count - warm_allocation_count;
+    ASSERT_EQUAL(query_allocation_count, 0u);
+    ASSERT(found_count > 0u);
+
+    ASSERT_EQUAL(found_even.size(), expected_even.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto& documents = server.FindTopDocuments(context, queries[i]);
+        ASSERT_EQUAL(documents.size(), expected[i].size());
+        for (size_t j = 0; j < documents.size(); ++j) {
+            ASSERT_EQUAL(documents[j].id, expected[i][j].id);
+            ASSERT(abs(documents[j].relevance - expected[i][j].relevance) < EPSILON);
+        }
+    }
+
+    // a query from the predicate of a query gets a context of its own
+    const auto nested = server.FindTopDocuments("cat"s, [&server](int document_id, 
+                                                                 DocumentStatus, int) {
+        return server.FindTopDocuments("dog"s).size() == 2u && document_id != 10;
+    });
+    ASSERT_EQUAL(nested.size(), 3u);
+}
+
+void TestNothrowApi() {
+    SearchServer server = GetSearchServer();
+
+    const auto found = server.FindTopDocuments(nothrow, "cat -in"s);
+    ASSERT(found.HasValue());
+    const auto expected = server.FindTopDocuments("cat -in"s);
+    ASSERT_EQUAL(found->size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL((*found)[i].id, expected[i].id);
+    }
+    const auto matched = server.MatchDocument(nothrow, "cat happy"s, 0);
+    ASSERT(matched.HasValue());
+    ASSERT(get<0>(*matched) == get<0>(server.MatchDocument("cat happy"s, 0)));
+
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "cat --dog"s).GetError(), 
+                 SearchError::INVALID_MINUS_WORD);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "cat -"s).GetError(), 
+                 SearchError::INVALID_MINUS_WORD);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "ca\x10t"s).GetError(), 
+                 SearchError::INVALID_CHARACTERS);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "cat  dog"s).GetError(), 
+                 SearchError::EMPTY_WORD);
+    ASSERT_EQUAL(server.MatchDocument(nothrow, "cat"s, 100).GetError(), 
+                 SearchError::DOCUMENT_NOT_FOUND);
+    ASSERT_EQUAL(server.MatchDocument(nothrow, "-"s, 0).GetError(), 
+                 SearchError::INVALID_MINUS_WORD);
+
+    ASSERT_EQUAL(server.AddDocument(nothrow, -1, "cat"s, DocumentStatus::ACTUAL, 
+                                    {1}).GetError(), 
+                 SearchError::INVALID_DOCUMENT_ID);
+    ASSERT_EQUAL(server.AddDocument(nothrow, 0, "cat"s, DocumentStatus::ACTUAL, 
+                                    {1}).GetError(), 
+                 SearchError::DUPLICATE_DOCUMENT_ID);
+    ASSERT_EQUAL(server.AddDocument(nothrow, 20, "ca\x12t"s, DocumentStatus::ACTUAL, 
+                                    {1}).GetError(), 
+                 SearchError::INVALID_CHARACTERS);
+    const int document_count = server.GetDocumentCount();
+    ASSERT(server.AddDocument(nothrow, 20, "cat"s, DocumentStatus::ACTUAL, {1}).HasValue());
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count + 1);
+
+    // the throwing overloads keep their messages
+    string exString{};
+    try {
+        server.FindTopDocuments("cat --dog"s);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT_EQUAL(exString, "--dog is invalid"s);
+
+#ifdef SEARCH_SERVER_TRACING
+    QueryTracer::Instance().SetSampleRate(0.0);
+#endif
+    SearchServer::QueryContext context;
+    server.FindTopDocuments(nothrow, context, "cat dog -in"s);
+    const string invalid_query = "cat dog -in ca\x10t"s;
+    const size_t warm_allocation_count = allocation_count;
+    const auto error = server.FindTopDocuments(nothrow, context, invalid_query);
+    const auto match_error = server.MatchDocument(nothrow, context, invalid_query, 0);
+    const size_t error_allocation_count = allocation_count - warm_allocation_count;
+    ASSERT_EQUAL(error_allocation_count, 0u);
+    ASSERT_EQUAL(error.GetError(), SearchError::INVALID_CHARACTERS);
+    ASSERT_EQUAL(match_error.GetError(), SearchError::INVALID_CHARACTERS);
+}
+
+void TestPhraseQuery() {
+    SearchServer server("the"s);
+    server.SetPositionalIndex(true);
+    server.AddDocument(0, "red cat sits on the mat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "cat red big"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "red big cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "red the cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, {1});
+    
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"red cat\""s)), vector<int>{0});
+    // a stop word keeps its position, any word may stand there
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"red the cat\""s)), 
+                 (vector<int>{2, 3}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"red cat\"~0"s)), 
+                 (vector<int>{0, 1}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"red cat\"~1"s)), 
+                 (vector<int>{0, 1, 2, 3}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("dog \"red cat\""s)), 
+                 (vector<int>{0, 4}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("\"red cat\" -mat"s)), vector<int>{});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments(execution::par, "\"red cat\""s)), 
+                 vector<int>{0});
+    
+    // a phrase scores as its words do
+    const auto phrase_documents = server.FindTopDocuments("\"red cat\""s);
+    const auto word_documents = server.FindTopDocuments("red cat"s, 
+            [](int document_id, DocumentStatus, int) {
+        return document_id == 0;
+    });
+    ASSERT(abs(phrase_documents[0].relevance - word_documents[0].relevance) < EPSILON);
+    
+    // a repeated word needs a position of its own for every occurrence
+    SearchServer repeated("the"s);
+    repeated.SetPositionalIndex(true);
+    repeated.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {1});
+    repeated.AddDocument(1, "cat cat"s, DocumentStatus::ACTUAL, {1});
+    repeated.AddDocument(2, "cat big cat"s, DocumentStatus::ACTUAL, {1});
+    repeated.AddDocument(3, "cat dog big cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(get_ids(repeated.FindTopDocuments("\"cat cat\""s)), vector<int>{1});
+    ASSERT_EQUAL(get_ids(repeated.FindTopDocuments("\"cat cat\"~0"s)), vector<int>{1});
+    ASSERT_EQUAL(get_ids(repeated.FindTopDocuments("\"cat cat\"~1"s)), 
+                 (vector<int>{1, 2}));
+    ASSERT_EQUAL(get_ids(repeated.FindTopDocuments("\"cat big cat\"~0"s)), 
+                 vector<int>{2});
+    ASSERT_EQUAL(get_ids(repeated.FindTopDocuments("\"cat cat big\"~1"s)), 
+                 (vector<int>{2, 3}));
+    
+    const auto [words, status] = server.MatchDocument("\"red cat\""s, 0);
+    ASSERT_EQUAL(words, (vector<string_view>{"cat"sv, "red"sv}));
+    ASSERT(get<0>(server.MatchDocument("\"red cat\""s, 2)).empty());
+    
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "\"red cat"s).GetError(), 
+                 SearchError::INVALID_PHRASE);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "\"red cat\"~x"s).GetError(), 
+                 SearchError::INVALID_PHRASE);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "\"red -cat\""s).GetError(), 
+                 SearchError::INVALID_PHRASE);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "\"\""s).GetError(), 
+                 SearchError::INVALID_PHRASE);
+    
+    {
+        const SearchServer copy{server};
+        ASSERT_EQUAL(get_ids(copy.FindTopDocuments("\"red cat\""s)), vector<int>{0});
+    }
+    ASSERT(server.GetMemoryUsage().positions.bytes > 0u);
+    for (int id = 0; id < 5; ++id) {
+        server.RemoveDocument(id);
+    }
+    ASSERT_EQUAL(server.GetMemoryUsage().positions.bytes, 0u);
+    
+    SearchServer plain_server("the"s);
+    plain_server.AddDocument(0, "red cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(plain_server.GetMemoryUsage().positions.allocations, 0u);
+    ASSERT_EQUAL(plain_server.FindTopDocuments(nothrow, "\"red cat\""s).GetError(), 
+                 SearchError::POSITIONAL_INDEX_DISABLED);
+    string exString{};
+    try {
+        plain_server.SetPositionalIndex(true);
+    } catch (const logic_error& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+}
+
+void TestPrefixQuery() {
+    SearchServer server("the"s);
+    server.AddDocument(0, "program"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "programming cat"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "progress cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "proof"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "pro"s, DocumentStatus::ACTUAL, {5});
+    
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("prog*"s)), (vector<int>{0, 1, 2}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("pro*"s)), 
+                 (vector<int>{0, 1, 2, 3, 4}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("cat -prog*"s)), vector<int>{});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("proof -progr*"s)), vector<int>{3});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments(execution::par, "prog*"s)), 
+                 (vector<int>{0, 1, 2}));
+    ASSERT(server.FindTopDocuments("x*"s).empty());
+    
+    const auto [words, status] = server.MatchDocument("prog* cat"s, 1);
+    ASSERT_EQUAL(words, (vector<string_view>{"cat"sv, "programming"sv}));
+    ASSERT_EQUAL(get<0>(server.MatchDocument(execution::par, "prog*"s, 2)), 
+                 vector<string_view>{"progress"sv});
+    
+    // the expansions are taken in dictionary order
+    server.SetMaxPrefixExpansions(2);
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("prog*"s)), (vector<int>{0, 1}));
+    // a minus prefix excludes every expansion
+    ASSERT(server.FindTopDocuments("cat -prog*"s).empty());
+    ASSERT(server.FindTopDocuments(execution::par, "cat -prog*"s).empty());
+    server.SetQuerySyntax(QuerySyntax::BOOLEAN);
+    ASSERT(server.FindTopDocuments("cat AND NOT prog*"s).empty());
+    ASSERT(server.FindTopDocuments("cat -(prog* OR dog)"s).empty());
+    server.SetQuerySyntax(QuerySyntax::PLAIN);
+    
+    // a parallel removal leaves an empty posting list behind
+    server.RemoveDocument(execution::par, 0);
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("prog*"s)), (vector<int>{1, 2}));
+    ASSERT(server.FindTopDocuments("program"s).empty());
+}
+
+void TestScorer() {
+    SearchServer server("with a"s);
+    server.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "black cat with a long tail"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "black cat"s, DocumentStatus::BANNED, {4});
+    
+    const auto default_documents = server.FindTopDocuments("black cat"s);
+    const auto tf_idf_documents = server.FindTopDocuments(TfIdfScorer{}, "black cat"s);
+    ASSERT_EQUAL(tf_idf_documents.size(), default_documents.size());
+    for (size_t i = 0; i < default_documents.size(); ++i) {
+        ASSERT_EQUAL(tf_idf_documents[i].id, default_documents[i].id);
+        ASSERT(abs(tf_idf_documents[i].relevance - default_documents[i].relevance) 
+               < EPSILON);
+    }
+    
+    // N = 4, df = 3, the lengths are 2, 4, 2, 2 and 2.5 on average
+    const Bm25Scorer bm25;
+    const double weight = log(1.0 + (4 - 3 + 0.5) / (3 + 0.5));
+    const auto score = [&bm25, weight](double word_count) {
+        const double norm = bm25.k1 * (1.0 - bm25.b + bm25.b * word_count / 2.5);
+        return weight * (bm25.k1 + 1.0) / (1.0 + norm);
+    };
+    const auto documents = server.FindTopDocuments(bm25, "cat"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    // the shorter document ranks higher for the same count
+    ASSERT_EQUAL(documents[0].id, 0);
+    ASSERT_EQUAL(documents[1].id, 1);
+    ASSERT(abs(documents[0].relevance - score(2)) < EPSILON);
+    ASSERT(abs(documents[1].relevance - score(4)) < EPSILON);
+    
+    const auto banned = server.FindTopDocuments(bm25, "cat"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(banned.size(), 1u);
+    ASSERT_EQUAL(banned[0].id, 3);
+    
+    const auto predicate = [](int , DocumentStatus , int ) { return true; };
+    const auto seq_documents = server.FindTopDocuments(bm25, "black cat -dog"s, 
+                                                       predicate);
+    const auto par_documents = server.FindTopDocuments(execution::par, bm25, 
+                                                       "black cat -dog"s, predicate);
+    SearchServer::QueryContext context;
+    const auto& context_documents = server.FindTopDocuments(context, bm25, 
+                                                            "black cat -dog"s, 
+                                                            predicate);
+    ASSERT_EQUAL(seq_documents.size(), 3u);
+    ASSERT_EQUAL(par_documents.size(), seq_documents.size());
+    ASSERT_EQUAL(context_documents.size(), seq_documents.size());
+    for (size_t i = 0; i < seq_documents.size(); ++i) {
+        ASSERT_EQUAL(par_documents[i].id, seq_documents[i].id);
+        ASSERT(abs(par_documents[i].relevance - seq_documents[i].relevance) < EPSILON);
+        ASSERT_EQUAL(context_documents[i].id, seq_documents[i].id);
+        ASSERT(abs(context_documents[i].relevance - seq_documents[i].relevance) 
+               < EPSILON);
+    }
+    
+    // a scorer gets the number of occurrences as it is
+    struct CountScorer {
+        double ComputeWordWeight(int, size_t) const { return 1.0; }
+        double ComputeDocumentNorm(int, double) const { return 0.0; }
+        double ComputeTermScore(double, uint32_t count, int, double, double) const {
+            return count;
+        }
+    };
+    server.AddDocument(4, "cat white cat cat"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(server.FindTopDocuments(CountScorer{}, "white cat"s)[0].relevance, 4.0);
+    server.RemoveDocument(4);
+    
+    // the lengths follow removals
+    server.RemoveDocument(1);
+    server.RemoveDocument(3);
+    ASSERT(abs(server.FindTopDocuments(bm25, "white"s)[0].relevance 
+               - log(1.0 + 1.5 / 1.5) * (bm25.k1 + 1.0) / (1.0 + bm25.k1)) < EPSILON);
+}
+
+void TestStatusPartitions() {
+    SearchServer plain("the"s);
+    plain.SetPositionalIndex(true);
+    plain.AddDocument(0, "white cat"s, DocumentStatus::ACTUAL, {1});
+    plain.AddDocument(1, "black cat"s, DocumentStatus::BANNED, {2});
+    plain.AddDocument(2, "white dog"s, DocumentStatus::ACTUAL, {3});
+    plain.AddDocument(3, "the black cat and the white dog"s, 
+                      DocumentStatus::IRRELEVANT, {4});
+    plain.AddDocument(4, "black dog"s, DocumentStatus::BANNED, {5});
+    SearchServer server{plain};
+    ASSERT_EQUAL(server.GetMemoryUsage().status_postings.bytes, 0u);
+    server.SetStatusPartitioning(true);
+    ASSERT(server.IsStatusPartitioningEnabled());
+    ASSERT(server.GetMemoryUsage().status_postings.bytes > 0u);
+    
+    const auto check_same = [&plain, &server](const string& query) {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, 
+                                            DocumentStatus::IRRELEVANT,
+                                            DocumentStatus::BANNED, 
+                                            DocumentStatus::REMOVED}) {
+            const auto expected = plain.FindTopDocuments(query, status);
+            const auto found = server.FindTopDocuments(query, status);
+            const auto found_par = server.FindTopDocuments(execution::par, 
+                                                           query, status);
+            ASSERT_EQUAL(found.size(), expected.size());
+            ASSERT_EQUAL(found_par.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT(abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                ASSERT_EQUAL(found_par[i].id, expected[i].id);
+                ASSERT(abs(found_par[i].relevance - expected[i].relevance) 
+                       < EPSILON);
+            }
+        }
+    };
+    check_same("white cat"s);
+    check_same("black -dog"s);
+    check_same("\"black cat\" wh*"s);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s, [](int , DocumentStatus , int ) {
+        return true;
+    }).size(), 3u);
+    
+    // the postings follow the status
+    server.SetDocumentStatus(1, DocumentStatus::ACTUAL);
+    plain.SetDocumentStatus(1, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(server.FindTopDocuments("black cat"s).size(), 2u);
+    check_same("black cat"s);
+    server.SetDocumentStatus(0, DocumentStatus::REMOVED);
+    plain.SetDocumentStatus(0, DocumentStatus::REMOVED);
+    check_same("white cat"s);
+    ASSERT(get<1>(server.MatchDocument("cat"s, 0)) == DocumentStatus::REMOVED);
+    
+    {
+        // a copy shares the memory of the partitions while it lives
+        const SearchServer copy{server};
+        ASSERT(copy.IsStatusPartitioningEnabled());
+        ASSERT_EQUAL(copy.FindTopDocuments("white"s, DocumentStatus::REMOVED)[0].id, 0);
+    }
+    
+    server.RemoveDocument(1);
+    plain.RemoveDocument(1);
+    server.RemoveDocument(execution::par, 4);
+    plain.RemoveDocument(execution::par, 4);
+    check_same("black cat dog"s);
+    
+    string exString{};
+    try {
+        server.SetDocumentStatus(10, DocumentStatus::BANNED);
+    } catch (const out_of_range& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+    
+    server.SetStatusPartitioning(false);
+    ASSERT_EQUAL(server.GetMemoryUsage().status_postings.bytes, 0u);
+    check_same("white cat"s);
+}
+
+void TestDocumentFilter() {
+    SearchServer server("the"s);
+    const vector<DocumentStatus> statuses{DocumentStatus::ACTUAL, 
+                                          DocumentStatus::IRRELEVANT,
+                                          DocumentStatus::BANNED, 
+                                          DocumentStatus::REMOVED};
+    // more rows than a SIMD step, ids out of order
+    for (int i = 0; i < 37; ++i) {
+        const int document_id = (i * 17) % 37;
+        const string text = document_id % 3 == 0 ? "cat"s : "cat dog"s;
+        server.AddDocument(document_id, text, statuses[document_id % 4], 
+                           {document_id % 7 - 3});
+    }
+    
+    const auto check_same = [&server](const DocumentFilter& filter) {
+        for (const string& query : {"cat"s, "dog"s, "cat -dog"s}) {
+            const auto expected = server.FindTopDocuments(
+                        query, [&filter](int id, DocumentStatus status, int rating) {
+                return filter(id, status, rating);
+            });
+            const auto found = server.FindTopDocuments(query, filter);
+            const auto found_par = server.FindTopDocuments(execution::par, query, 
+                                                           filter);
+            ASSERT_EQUAL(found.size(), expected.size());
+            ASSERT_EQUAL(found_par.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT(abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                ASSERT_EQUAL(found_par[i].id, expected[i].id);
+            }
+        }
+    };
+    check_same(DocumentFilter{});
+    check_same(DocumentFilter{.min_rating = 1});
+    check_same(DocumentFilter{.min_id = 10, .max_id = 30, .max_rating = 2});
+    check_same(DocumentFilter{.statuses = StatusMask({DocumentStatus::BANNED,
+                                                      DocumentStatus::REMOVED})});
+    check_same(DocumentFilter{.statuses = StatusMask({DocumentStatus::IRRELEVANT})});
+    check_same(DocumentFilter{.ids = {1, 2, 5, 9, 13, 33}});
+    check_same(DocumentFilter{.min_rating = 5, .max_rating = 4});
+    
+    const DocumentFilter banned{.min_rating = 0, 
+                                .statuses = StatusMask({DocumentStatus::BANNED})};
+    const auto documents = server.FindTopDocuments("cat"s, banned);
+    ASSERT(!documents.empty());
+    for (const Document& document : documents) {
+        ASSERT_EQUAL(document.id % 4, 2);
+        ASSERT(document.rating >= 0);
+    }
+    
+    // the columns follow the changes of the documents
+    server.SetDocumentStatus(3, DocumentStatus::BANNED);
+    server.RemoveDocument(6);
+    server.RemoveDocument(execution::par, 10);
+    server.AddDocument(40, "cat dog"s, DocumentStatus::BANNED, {3});
+    check_same(banned);
+    server.SetStatusPartitioning(true);
+    check_same(banned);
+    check_same(DocumentFilter{.max_id = 20});
+    
+    SearchServer::QueryContext context;
+    const auto& context_documents = server.FindTopDocuments(context, "dog"s, banned);
+    ASSERT_EQUAL(context_documents.size(), server.FindTopDocuments("dog"s, banned).size());
+}
+
+void TestDocumentColumnsRemoval() {
+    DocumentColumns columns{pmr::get_default_resource()};
+    for (int document_id = 0; document_id < 16; ++document_id) {
+        columns.Add(document_id, DocumentStatus::ACTUAL, document_id, 1);
+    }
+    // below a quarter of the rows the removed ones stay as tombstones
+    columns.Remove(3);
+    columns.Remove(4);
+    columns.Remove(9);
+    ASSERT_EQUAL(columns.GetRowCount(), 16u);
+    ASSERT_EQUAL(columns.GetIds()[columns.FindRow(3)], 5);
+    ASSERT_EQUAL(columns.GetIds()[columns.FindRow(9)], 10);
+    string exString{};
+    try {
+        columns.SetStatus(9, DocumentStatus::BANNED);
+    } catch (const exception &e) {
+        ASSERT_EQUAL(typeid(e).name(), "St12out_of_range"s);
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+    
+    vector<uint64_t> bitmap;
+    columns.Evaluate(DocumentFilter{}, bitmap);
+    ASSERT_EQUAL(bitmap[0], uint64_t{0xffff} & ~uint64_t{(1 << 3) | (1 << 4) | (1 << 9)});
+    
+    // a removed id takes its row again
+    columns.Add(4, DocumentStatus::BANNED, 7, 2);
+    ASSERT_EQUAL(columns.GetRowCount(), 16u);
+    ASSERT_EQUAL(columns.FindRow(4), 4u);
+    ASSERT_EQUAL(columns.GetRatings()[4], 7);
+    columns.Evaluate(DocumentFilter{.statuses = StatusMask({DocumentStatus::BANNED})}, 
+                     bitmap);
+    ASSERT_EQUAL(bitmap[0], uint64_t{1} << 4);
+    
+    // more than a quarter of the rows removed compacts the columns
+    columns.Remove(0);
+    columns.Remove(1);
+    ASSERT_EQUAL(columns.GetRowCount(), 16u);
+    columns.Remove(15);
+    ASSERT_EQUAL(columns.GetRowCount(), 11u);
+    const vector<int> ids(columns.GetIds().begin(), columns.GetIds().end());
+    ASSERT_EQUAL(ids, (vector<int>{2, 4, 5, 6, 7, 8, 10, 11, 12, 13, 14}));
+    ASSERT_EQUAL(columns.FindRow(9), 6u);
+    columns.Evaluate(DocumentFilter{}, bitmap);
+    ASSERT_EQUAL(bitmap[0], uint64_t{0x7ff});
+}
+
+void TestScoringModes() {
+    SearchServer server("and"s);
+    const vector<string> vocabulary{"cat"s, "dog"s, "bird"s, "fish"s, "white"s,
+                                    "black"s, "big"s, "small"s, "and"s, "old"s};
+    uint32_t seed = 12345;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    // more rows than a block and lengths from 1 to 12 words
+    for (int document_id = 0; document_id < 700; ++document_id) {
+        string text;
+        const uint32_t word_count = 1 + next(12);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            text += vocabulary[next(vocabulary.size())] + ' ';
+        }
+        server.AddDocument(document_id * 2, text, 
+                           static_cast<DocumentStatus>(next(4)), 
+                           {static_cast<int>(next(10))});
+    }
+    SearchServer accumulating{server};
+    accumulating.SetScoringMode(ScoringMode::ACCUMULATE);
+    SearchServer single{server};
+    single.SetScoringMode(ScoringMode::ACCUMULATE_FLOAT);
+    ASSERT(single.GetScoringMode() == ScoringMode::ACCUMULATE_FLOAT);
+    
+    const auto all = [](int , DocumentStatus , int ) { return true; };
+    const DocumentFilter filter{.min_rating = 3, 
+                                .statuses = StatusMask({DocumentStatus::ACTUAL,
+                                                        DocumentStatus::BANNED})};
+    const vector<string> queries{"cat"s, "white cat -dog"s, "big small old fish"s,
+                                 "bird -black -white"s, "cat dog bird fish"s};
+    // documents may change places only with a document of the same
+    // relevance within EPSILON
+    const auto check_ranking = [](const vector<Document>& expected,
+                                  const vector<Document>& found) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT(abs(found[i].relevance - expected[i].relevance) < EPSILON);
+        }
+    };
+    for (const string& query : queries) {
+        for (const auto& [merge, accumulate, accumulate_float] : {
+             tuple{server.FindTopDocuments(query), 
+                   accumulating.FindTopDocuments(query),
+                   single.FindTopDocuments(query)},
+             tuple{server.FindTopDocuments(query, all), 
+                   accumulating.FindTopDocuments(query, all),
+                   single.FindTopDocuments(query, all)},
+             tuple{server.FindTopDocuments(query, filter), 
+                   accumulating.FindTopDocuments(query, filter),
+                   single.FindTopDocuments(query, filter)},
+             tuple{server.FindTopDocuments(Bm25Scorer{}, query, all), 
+                   accumulating.FindTopDocuments(Bm25Scorer{}, query, all),
+                   single.FindTopDocuments(Bm25Scorer{}, query, all)}}) {
+            ASSERT_EQUAL(accumulate.size(), merge.size());
+            for (size_t i = 0; i < merge.size(); ++i) {
+                ASSERT_EQUAL(accumulate[i].id, merge[i].id);
+                ASSERT(abs(accumulate[i].relevance - merge[i].relevance) < EPSILON);
+            }
+            check_ranking(accumulate, accumulate_float);
+        }
+    }
+    
+    // phrases are merged
+    SearchServer phrases("and"s);
+    phrases.SetPositionalIndex(true);
+    phrases.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    phrases.AddDocument(2, "cat white"s, DocumentStatus::ACTUAL, {1});
+    phrases.SetScoringMode(ScoringMode::ACCUMULATE);
+    const auto documents = phrases.FindTopDocuments("\"white cat\""s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 1);
+}
+
+void TestTermCounts() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat cat cat dog and bird bird"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog dog cat"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, {3});
+    // the postings hold counts, the frequencies are count / length
+    const auto& frequencies = server.GetWordFrequencies(1);
+    ASSERT(abs(frequencies.at("cat"s) - 3.0 / 6) < EPSILON);
+    ASSERT(abs(frequencies.at("bird"s) - 2.0 / 6) < EPSILON);
+    
+    const double idf = log(3.0 / 2);
+    const auto documents = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT(abs(documents[0].relevance - frequencies.at("cat"s) * idf) < EPSILON);
+    const auto par_documents = server.FindTopDocuments(
+                execution::par, "cat"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(par_documents[0].relevance, documents[0].relevance);
+    
+    // the partitions copy the counts
+    SearchServer partitioned{server};
+    partitioned.SetStatusPartitioning(true);
+    ASSERT_EQUAL(partitioned.FindTopDocuments("cat"s, DocumentStatus::ACTUAL)[0].relevance,
+                 documents[0].relevance);
+    partitioned.SetDocumentStatus(2, DocumentStatus::ACTUAL);
+    const auto moved = partitioned.FindTopDocuments("dog"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(moved.size(), 2u);
+    ASSERT_EQUAL(moved[0].id, 2);
+    ASSERT(abs(moved[0].relevance - 2.0 / 3 * idf) < EPSILON);
+}
+
+void TestMatchModes() {
+    SearchServer server("and"s);
+    const vector<string> vocabulary{"cat"s, "dog"s, "bird"s, "fish"s, "white"s,
+                                    "black"s, "big"s, "small"s, "and"s, "old"s};
+    uint32_t seed = 4321;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    for (int document_id = 0; document_id < 400; ++document_id) {
+        string text;
+        const uint32_t word_count = 1 + next(8);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            text += vocabulary[next(vocabulary.size())] + ' ';
+        }
+        server.AddDocument(document_id * 3, text, 
+                           static_cast<DocumentStatus>(next(2)), 
+                           {static_cast<int>(next(10))});
+    }
+    SearchServer conjunctive{server};
+    conjunctive.SetMatchMode(MatchMode::ALL);
+    ASSERT(conjunctive.GetMatchMode() == MatchMode::ALL);
+    
+    // the results are the best of the documents with all the plus words,
+    // with the relevance of the disjunctive query
+    const vector<tuple<string, vector<string>, string>> queries{
+        {"cat dog"s, {"cat"s, "dog"s}, ""s},
+        {"white cat -black"s, {"white"s, "cat"s}, "black"s},
+        {"big small old"s, {"big"s, "small"s, "old"s}, ""s},
+        {"fish -dog"s, {"fish"s}, "dog"s}};
+    for (const auto& [query, words, minus_word] : queries) {
+        vector<Document> expected;
+        for (const int document_id : server) {
+            const auto& frequencies = server.GetWordFrequencies(document_id);
+            const bool has_words = all_of(words.begin(), words.end(), 
+                                          [&frequencies](const string& word) {
+                return frequencies.count(word) > 0;
+            });
+            if (!has_words || frequencies.count(minus_word) > 0) {
+                continue;
+            }
+            DocumentFilter filter{.statuses = StatusMask({DocumentStatus::ACTUAL}),
+                                  .ids = {document_id}};
+            const auto found = server.FindTopDocuments(query, filter);
+            if (!found.empty()) {
+                expected.push_back(found[0]);
+            }
+        }
+        const auto documents = conjunctive.FindTopDocuments(query);
+        ASSERT_EQUAL(documents.size(), min(expected.size(), 
+                                           size_t{MAX_RESULT_DOCUMENT_COUNT}));
+        sort(expected.begin(), expected.end(), 
+             [](const Document& lhs, const Document& rhs) {
+            return lhs.relevance > rhs.relevance;
+        });
+        for (size_t i = 0; i < documents.size(); ++i) {
+            ASSERT(abs(documents[i].relevance - expected[i].relevance) < EPSILON);
+            ASSERT(any_of(expected.begin(), expected.end(), 
+                          [&documents, i](const Document& document) {
+                return document.id == documents[i].id 
+                        && document.relevance == documents[i].relevance;
+            }));
+        }
+        const auto par_documents = conjunctive.FindTopDocuments(execution::par, 
+                                                                query);
+        ASSERT_EQUAL(par_documents.size(), documents.size());
+    }
+    
+    SearchServer small("and"s);
+    small.SetPositionalIndex(true);
+    small.SetMatchMode(MatchMode::ALL);
+    small.AddDocument(1, "white cat and black dog"s, DocumentStatus::ACTUAL, {1});
+    small.AddDocument(2, "white dog"s, DocumentStatus::ACTUAL, {2});
+    small.AddDocument(3, "black cat"s, DocumentStatus::ACTUAL, {3});
+    ASSERT(small.FindTopDocuments("white cat parrot"s).empty());
+    ASSERT_EQUAL(small.FindTopDocuments("white dog"s).size(), 2u);
+    ASSERT_EQUAL(small.FindTopDocuments("\"black dog\" white"s).size(), 1u);
+    ASSERT(small.FindTopDocuments("\"white dog\" cat"s).empty());
+    // a prefix is optional, without plain words any word matches
+    ASSERT_EQUAL(small.FindTopDocuments("cat bl*"s).size(), 2u);
+    ASSERT_EQUAL(small.FindTopDocuments("wh* bl*"s).size(), 3u);
+    
+    const auto [matched_words, status] = small.MatchDocument("white cat"s, 2);
+    ASSERT(matched_words.empty());
+    const auto [par_words, par_status] = small.MatchDocument(execution::par, 
+                                                             "white cat"s, 1);
+    ASSERT_EQUAL(par_words.size(), 2u);
+}
+
+SearchServer GetBooleanSearchServer() {
+    SearchServer server("and"s);
+    server.SetQuerySyntax(QuerySyntax::BOOLEAN);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black cat"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "black dog bird"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "bird"s, DocumentStatus::ACTUAL, {5});
+    return server;
+}
+
+set<int> FindIds(const SearchServer& server, const string& query) {
+    set<int> ids;
+    for (const Document& document : server.FindTopDocuments(query)) {
+        ids.insert(document.id);
+    }
+    return ids;
+}
+
+void TestBooleanQueryAndOr() {
+    const SearchServer server = GetBooleanSearchServer();
+    ASSERT(server.GetQuerySyntax() == QuerySyntax::BOOLEAN);
+    ASSERT_EQUAL(FindIds(server, "cat AND white"s), (set<int>{1}));
+    ASSERT_EQUAL(FindIds(server, "cat OR dog"s), (set<int>{1, 2, 3, 4}));
+    ASSERT_EQUAL(FindIds(server, "bl* AND dog"s), (set<int>{4}));
+    ASSERT_EQUAL(FindIds(server, "(white and) AND cat"s), (set<int>{1}));
+    ASSERT(FindIds(server, "cat AND parrot"s).empty());
+}
+
+void TestBooleanQueryPrecedence() {
+    const SearchServer server = GetBooleanSearchServer();
+    // AND binds tighter than OR, NOT than AND
+    ASSERT_EQUAL(FindIds(server, "white AND cat OR bird"s), (set<int>{1, 4, 5}));
+    ASSERT_EQUAL(FindIds(server, "white AND (cat OR bird)"s), (set<int>{1}));
+    ASSERT_EQUAL(FindIds(server, "dog OR cat AND black"s), (set<int>{2, 3, 4}));
+    ASSERT_EQUAL(FindIds(server, "NOT black AND cat"s), (set<int>{1}));
+}
+
+void TestBooleanQueryExclusion() {
+    const SearchServer server = GetBooleanSearchServer();
+    ASSERT_EQUAL(FindIds(server, "(cat OR dog) AND NOT black"s), (set<int>{1, 3}));
+    ASSERT_EQUAL(FindIds(server, "(cat OR dog)AND(NOT black)"s), (set<int>{1, 3}));
+    ASSERT_EQUAL(FindIds(server, "+dog -bird"s), (set<int>{3}));
+    ASSERT_EQUAL(FindIds(server, "-(white OR bird) +(cat OR dog)"s), (set<int>{2}));
+    ASSERT(FindIds(server, "NOT cat"s).empty());
+}
+
+void TestBooleanQueryOptionalWords() {
+    const SearchServer server = GetBooleanSearchServer();
+    // optional words of a group with required ones add relevance only
+    const auto documents = server.FindTopDocuments("+dog bird"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents[0].id, 4);
+    ASSERT_EQUAL(documents[1].id, 3);
+    ASSERT_EQUAL(server.FindTopDocuments(execution::par, "+dog bird"s)[0].id, 4);
+}
+
+void TestBooleanQueryMatchModeAll() {
+    SearchServer server = GetBooleanSearchServer();
+    // unmarked words are required with MatchMode::ALL
+    ASSERT_EQUAL(FindIds(server, "white (cat OR bird)"s), (set<int>{1, 2, 3, 4, 5}));
+    server.SetMatchMode(MatchMode::ALL);
+    ASSERT_EQUAL(FindIds(server, "white (cat OR bird)"s), (set<int>{1}));
+}
+
+void TestBooleanQueryMatchDocument() {
+    const SearchServer server = GetBooleanSearchServer();
+    const auto [words, status] = server.MatchDocument("(cat OR dog) AND NOT black"s, 1);
+    ASSERT_EQUAL(words, (vector<string_view>{"cat"sv}));
+    ASSERT(get<0>(server.MatchDocument("(cat OR dog) AND NOT black"s, 2)).empty());
+    ASSERT_EQUAL(get<0>(server.MatchDocument(execution::par, "+dog bird"s, 4)),
+                 (vector<string_view>{"bird"sv, "dog"sv}));
+}
+
+void TestBooleanQueryParsingErrors() {
+    const SearchServer server = GetBooleanSearchServer();
+    for (const string& query : {"(cat"s, "cat)"s, "cat AND"s, "OR cat"s, 
+                                "NOT NOT cat"s, "+"s, "()"s, 
+                                "\"white cat\" AND dog"s}) {
+        const auto found = server.FindTopDocuments(nothrow, query);
+        ASSERT(!found);
+        ASSERT_EQUAL(found.GetError(), SearchError::INVALID_QUERY);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "cat AND --dog"s).GetError(),
+                 SearchError::INVALID_MINUS_WORD);
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, "cat AND d\x12og"s).GetError(),
+                 SearchError::INVALID_CHARACTERS);
+}
+
+void TestBooleanQueryParsingExceptions() {
+    const SearchServer server = GetBooleanSearchServer();
+    string exString{};
+    try {
+        server.FindTopDocuments("(cat OR dog"s);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+    try {
+        server.FindTopDocuments("NOT NOT cat"s);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT_EQUAL(exString, "NOT is invalid"s);
+}
+
+void TestBooleanQueryNestingDepth() {
+    const SearchServer server = GetBooleanSearchServer();
+    // the nesting is bounded, so a deep query fails instead of the stack
+    const string nested = string(MAX_BOOLEAN_QUERY_DEPTH, '(') + "cat"s 
+            + string(MAX_BOOLEAN_QUERY_DEPTH, ')');
+    ASSERT_EQUAL(FindIds(server, nested), (set<int>{1, 2}));
+    for (const string& query : {"("s + nested + ")"s, 
+                                string(100000, '(') + "cat"s,
+                                string(100000, '(') + "cat"s + string(100000, ')'),
+                                "-("s + nested + ")"s}) {
+        ASSERT_EQUAL(server.FindTopDocuments(nothrow, query).GetError(),
+                     SearchError::INVALID_QUERY);
+    }
+}
+
+void TestBooleanQueryNegationDepth() {
+    const SearchServer server = GetBooleanSearchServer();
+    string negations;
+    for (int i = 0; i < 100000; ++i) {
+        negations += "NOT "s;
+    }
+    ASSERT_EQUAL(server.FindTopDocuments(nothrow, negations + "cat"s).GetError(),
+                 SearchError::INVALID_QUERY);
+}
+
+void TestBooleanQueryPlainSyntax() {
+    SearchServer server = GetBooleanSearchServer();
+    // without the boolean syntax the operators are words
+    server.SetQuerySyntax(QuerySyntax::PLAIN);
+    ASSERT_EQUAL(server.FindTopDocuments("cat AND white"s).size(), 3u);
+}
+
+void TestBooleanQueryParenthesizedPlainQuery() {
+    // a plain query in parentheses scores as the plain query
+    SearchServer corpus("and"s);
+    corpus.SetQuerySyntax(QuerySyntax::BOOLEAN);
+    const vector<string> vocabulary{"cat"s, "dog"s, "bird"s, "fish"s, "white"s,
+                                    "black"s, "big"s, "small"s, "and"s, "old"s};
+    uint32_t seed = 777;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    for (int document_id = 0; document_id < 300; ++document_id) {
+        string text;
+        const uint32_t word_count = 1 + next(8);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            text += vocabulary[next(vocabulary.size())] + ' ';
+        }
+        corpus.AddDocument(document_id, text, DocumentStatus::ACTUAL, 
+                           {static_cast<int>(next(10))});
+    }
+    for (const string& query : {"cat dog -bird"s, "white bi* -old"s, 
+                                "fish small big old"s}) {
+        const auto expected = corpus.FindTopDocuments(query);
+        const auto found = corpus.FindTopDocuments("("s + query + ")"s);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+        }
+    }
+}
+
+SearchServer GetPagedSearchServer() {
+    SearchServer server("and"s);
+    const vector<string> vocabulary{"cat"s, "dog"s, "bird"s, "fish"s, "white"s,
+                                    "black"s, "big"s, "small"s, "and"s, "old"s};
+    uint32_t seed = 2024;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    for (int document_id = 0; document_id < 200; ++document_id) {
+        string text;
+        const uint32_t word_count = 1 + next(6);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            text += vocabulary[next(vocabulary.size())] + ' ';
+        }
+        server.AddDocument(document_id, text, 
+                           static_cast<DocumentStatus>(next(2)), 
+                           {static_cast<int>(next(3))});
+    }
+    return server;
+}
+
+vector<int> GetDocumentIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+void TestDocumentsPageWholeRanking() {
+    const SearchServer server = GetPagedSearchServer();
+    const string query = "cat white -fish"s;
+    // a page of all the documents is the whole ranking
+    const DocumentPage all = server.FindDocumentsPage(query, 0, 1000);
+    ASSERT(!all.next);
+    size_t matched_count = 0;
+    for (const int document_id : server) {
+        const auto [words, status] = server.MatchDocument(query, document_id);
+        matched_count += !words.empty() && status == DocumentStatus::ACTUAL;
+    }
+    ASSERT(matched_count > 20);
+    ASSERT_EQUAL(all.documents.size(), matched_count);
+    const auto top = server.FindTopDocuments(query);
+    for (size_t i = 0; i < all.documents.size(); ++i) {
+        if (i < top.size()) {
+            ASSERT(abs(all.documents[i].relevance - top[i].relevance) < EPSILON);
+        }
+        if (i > 0) {
+            const Document& previous = all.documents[i - 1];
+            const Document& current = all.documents[i];
+            ASSERT(previous.relevance >= current.relevance);
+            if (previous.relevance == current.relevance) {
+                ASSERT(previous.rating > current.rating 
+                       || (previous.rating == current.rating 
+                           && previous.id < current.id));
+            }
+        }
+    }
+}
+
+void TestDocumentsPageNumbered() {
+    const SearchServer server = GetPagedSearchServer();
+    const string query = "cat white -fish"s;
+    const vector<int> expected = GetDocumentIds(
+                server.FindDocumentsPage(query, 0, 1000).documents);
+    // numbered pages cut the whole ranking
+    const size_t page_size = 7;
+    vector<int> by_number;
+    for (size_t page = 0; page * page_size < expected.size(); ++page) {
+        const DocumentPage numbered = server.FindDocumentsPage(query, page, page_size);
+        ASSERT_EQUAL(static_cast<bool>(numbered.next), 
+                     (page + 1) * page_size < expected.size());
+        for (const Document& document : numbered.documents) {
+            by_number.push_back(document.id);
+        }
+    }
+    ASSERT_EQUAL(by_number, expected);
+}
+
+void TestDocumentsPageCursorRoundTrip() {
+    const SearchServer server = GetPagedSearchServer();
+    const string query = "cat white -fish"s;
+    const vector<int> expected = GetDocumentIds(
+                server.FindDocumentsPage(query, 0, 1000).documents);
+    // pages after the cursor cut the same ranking as numbered ones
+    const size_t page_size = 7;
+    DocumentPage page = server.FindDocumentsPage(query, 0, page_size);
+    vector<int> by_cursor = GetDocumentIds(page.documents);
+    while (page.next) {
+        // the cursor goes through its string
+        const optional<SearchCursor> cursor = SearchCursor::FromString(
+                    page.next->ToString());
+        ASSERT(cursor.has_value());
+        page = server.FindDocumentsPage(query, *cursor, page_size);
+        for (const Document& document : page.documents) {
+            by_cursor.push_back(document.id);
+        }
+    }
+    ASSERT_EQUAL(by_cursor, expected);
+}
+
+void TestDocumentsPagePastTheEnd() {
+    const SearchServer server = GetPagedSearchServer();
+    const string query = "cat white -fish"s;
+    const DocumentPage page = server.FindDocumentsPage(query, 1000, 7);
+    ASSERT(page.documents.empty());
+    ASSERT(!page.next);
+    ASSERT(server.FindDocumentsPage(query, numeric_limits<size_t>::max(), 
+                                    7).documents.empty());
+}
+
+void TestDocumentsPageWithPredicate() {
+    const SearchServer server = GetPagedSearchServer();
+    const string query = "cat white -fish"s;
+    const auto irrelevant = server.FindDocumentsPage(query, 0, 1000, 
+                                                     DocumentStatus::IRRELEVANT);
+    ASSERT(!irrelevant.documents.empty());
+    const auto even = server.FindDocumentsPage(
+                query, 0, 1000, [](int document_id, DocumentStatus , int ) {
+        return document_id % 2 == 0;
+    });
+    ASSERT(!even.documents.empty());
+    ASSERT(all_of(even.documents.begin(), even.documents.end(), 
+                  [](const Document& document) { return document.id % 2 == 0; }));
+}
+
+void TestDocumentsPageZeroSize() {
+    const SearchServer server = GetPagedSearchServer();
+    string exString{};
+    try {
+        server.FindDocumentsPage("cat white -fish"s, 0, 0);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+}
+
+void TestSearchCursorFromInvalidString() {
+    ASSERT(!SearchCursor::FromString("cursor"s).has_value());
+    ASSERT(!SearchCursor::FromString(""s).has_value());
+}
+
+void TestDocumentsPageExactRelevances() {
+    // the pages compare relevances exactly, FindTopDocuments takes those
+    // within EPSILON for equal and ranks them by rating
+    SearchServer near_ties("and"s);
+    near_ties.AddDocument(1, "x y z"s, DocumentStatus::ACTUAL, {9});
+    string text;
+    for (int i = 0; i < 11; ++i) {
+        text += "x y z "s;
+    }
+    near_ties.AddDocument(2, text, DocumentStatus::ACTUAL, {1});
+    near_ties.AddDocument(3, "w"s, DocumentStatus::ACTUAL, {5});
+    const auto near_top = near_ties.FindTopDocuments("x"s);
+    ASSERT_EQUAL(near_top.size(), 2u);
+    ASSERT(abs(near_top[0].relevance - near_top[1].relevance) < EPSILON);
+    ASSERT(near_top[0].relevance != near_top[1].relevance);
+    ASSERT_EQUAL(near_top[0].id, 1);
+    const Document& higher = near_top[0].relevance > near_top[1].relevance 
+            ? near_top[0] : near_top[1];
+    const DocumentPage near_page = near_ties.FindDocumentsPage("x"s, 0, 1);
+    ASSERT_EQUAL(near_page.documents[0].id, higher.id);
+    const DocumentPage near_next = near_ties.FindDocumentsPage("x"s, 
+                                                               *near_page.next, 1);
+    ASSERT_EQUAL(near_next.documents.size(), 1u);
+    ASSERT(near_next.documents[0].id != higher.id);
+    ASSERT(!near_next.next);
+}
+
+SearchServer GetRangeSearchServer() {
+    SearchServer server("and"s);
+    const vector<string> vocabulary{"cat"s, "dog"s, "bird"s, "fish"s, "white"s,
+                                    "black"s, "big"s, "small"s, "and"s, "old"s};
+    uint32_t seed = 7;
+    const auto next = [&seed](uint32_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % bound;
+    };
+    for (int document_id = 0; document_id < 300; ++document_id) {
+        string text;
+        const uint32_t word_count = 1 + next(6);
+        for (uint32_t i = 0; i < word_count; ++i) {
+            text += vocabulary[next(vocabulary.size())] + ' ';
+        }
+        server.AddDocument(document_id * 3, text, 
+                           static_cast<DocumentStatus>(next(2)), 
+                           {static_cast<int>(next(5))});
+    }
+    return server;
+}
+
+bool IsActualDocument(int , DocumentStatus status, int ) {
+    return status == DocumentStatus::ACTUAL;
+}
+
+bool IsRatedDocument(int , DocumentStatus , int rating) {
+    return rating > 1;
+}
+
+// The range finds the same documents and relevance as the ranking, in
+// the order of ids; returns their number
+template <typename DocumentPredicate>
+size_t CheckDocumentRange(const SearchServer& server, const string& query, 
+                          DocumentPredicate document_predicate) {
+    auto ranked = server.FindDocumentsPage(query, 0, 1000, 
+                                           document_predicate).documents;
+    sort(ranked.begin(), ranked.end(), 
+         [](const Document& lhs, const Document& rhs) {
+        return lhs.id < rhs.id;
+    });
+    vector<Document> found;
+    for (const Document& document : server.FindAllDocumentsRange(
+             query, document_predicate)) {
+        found.push_back(document);
+    }
+    ASSERT_EQUAL(found.size(), ranked.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(found[i].id, ranked[i].id);
+        ASSERT_EQUAL(found[i].relevance, ranked[i].relevance);
+        ASSERT_EQUAL(found[i].rating, ranked[i].rating);
+    }
+    return found.size();
+}
+
+vector<string> GetDocumentRangeQueries() {
+    return {"cat"s, "cat white -fish"s, "bi* -dog"s, "and"s, "-cat"s, 
+            "cat cat c* old"s, "horse"s};
+}
+
+void TestDocumentRangeMatchesRanking() {
+    const SearchServer server = GetRangeSearchServer();
+    static_assert(ranges::input_range<
+            decltype(server.FindAllDocumentsRange("cat"s))>);
+    for (const string& query : GetDocumentRangeQueries()) {
+        CheckDocumentRange(server, query, IsActualDocument);
+        CheckDocumentRange(server, query, IsRatedDocument);
+    }
+    ASSERT(CheckDocumentRange(server, "cat white -fish"s, IsActualDocument) > 20);
+    ASSERT_EQUAL(CheckDocumentRange(server, "horse"s, IsActualDocument), 0u);
+}
+
+void TestDocumentRangeMatchModeAll() {
+    SearchServer server = GetRangeSearchServer();
+    server.SetMatchMode(MatchMode::ALL);
+    for (const string& query : GetDocumentRangeQueries()) {
+        CheckDocumentRange(server, query, IsActualDocument);
+    }
+    ASSERT(CheckDocumentRange(server, "white big"s, IsRatedDocument) > 0);
+    ASSERT_EQUAL(CheckDocumentRange(server, "cat horse"s, IsActualDocument), 0u);
+}
+
+void TestDocumentRangeBooleanQuery() {
+    SearchServer server = GetRangeSearchServer();
+    server.SetQuerySyntax(QuerySyntax::BOOLEAN);
+    for (const string& query : {"(cat OR dog) AND NOT black"s, "+white bi*"s,
+                                "cat AND (big OR small) -old"s}) {
+        ASSERT(CheckDocumentRange(server, query, IsActualDocument) > 0);
+    }
+}
+
+void TestDocumentRangeFuzzyMatching() {
+    SearchServer server = GetRangeSearchServer();
+    server.SetFuzzyMatching({1, 0.5});
+    ASSERT(CheckDocumentRange(server, "cot white"s, IsActualDocument) > 0);
+}
+
+void TestDocumentRangeStatusPartition() {
+    SearchServer server = GetRangeSearchServer();
+    // a status reads its partition
+    server.SetStatusPartitioning(true);
+    size_t irrelevant_count = 0;
+    for (const Document& document : server.FindAllDocumentsRange(
+             "cat white"s, DocumentStatus::IRRELEVANT)) {
+        const auto [words, status] = server.MatchDocument("cat white"s, document.id);
+        ASSERT(!words.empty());
+        ASSERT(status == DocumentStatus::IRRELEVANT);
+        ++irrelevant_count;
+    }
+    ASSERT(irrelevant_count > 0);
+    ASSERT_EQUAL(CheckDocumentRange(server, "cat white -fish"s, IsActualDocument), 
+                 static_cast<size_t>(ranges::distance(
+                     server.FindAllDocumentsRange("cat white -fish"s))));
+}
+
+void TestDocumentRangeEarlyBreak() {
+    const SearchServer server = GetRangeSearchServer();
+    // a break ends the search, the range goes on from the document
+    // it stopped at
+    auto range = server.FindAllDocumentsRange("cat white"s);
+    vector<int> ids;
+    for (const Document& document : range) {
+        ids.push_back(document.id);
+        if (ids.size() == 3) {
+            break;
+        }
+    }
+    auto it = range.begin();
+    ASSERT_EQUAL(it->id, ids.back());
+    for (++it; it != range.end(); ++it) {
+        ids.push_back(it->id);
+    }
+    vector<int> expected;
+    for (const Document& document : server.FindAllDocumentsRange("cat white"s)) {
+        expected.push_back(document.id);
+    }
+    ASSERT(ids.size() > 3);
+    ASSERT_EQUAL(ids, expected);
+    ASSERT(is_sorted(ids.begin(), ids.end()));
+}
+
+void TestDocumentRangeInvalidQuery() {
+    const SearchServer server = GetRangeSearchServer();
+    string exString{};
+    try {
+        server.FindAllDocumentsRange("cat --white"s);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+}
+
+void TestDocumentRangePhraseQuery() {
+    string exString{};
+    SearchServer positional("and"s);
+    positional.SetPositionalIndex(true);
+    positional.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    try {
+        positional.FindAllDocumentsRange("\"white cat\""s);
+    } catch (const invalid_argument& e) {
+        exString = e.what();
+    }
+    ASSERT(!exString.empty());
+}
+
+void TestFuzzyMatching() {
+    SearchServer server("the"s);
+    server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "bat"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(2, "house"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(3, "mouse"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, {5});
+    
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    ASSERT(server.FindTopDocuments("cet"s).empty());
+    ASSERT_EQUAL(server.GetMemoryUsage().fuzzy_index.allocations, 0u);
+    const double exact_relevance = server.FindTopDocuments("cat"s)[0].relevance;
+    
+    server.SetFuzzyMatching({1, 0.5});
+    ASSERT(server.GetMemoryUsage().fuzzy_index.bytes > 0u);
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("cet"s)), vector<int>{0});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("cat"s)), (vector<int>{0, 1}));
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("hous"s)), vector<int>{2});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments(execution::par, "cet"s)), vector<int>{0});
+    
+    // an exact match ranks above a fuzzy one, which pays the penalty
+    const auto documents = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(documents[0].id, 0);
+    ASSERT(abs(documents[0].relevance - exact_relevance) < EPSILON);
+    ASSERT(abs(documents[1].relevance - 0.5 * exact_relevance) < EPSILON);
+    
+    ASSERT_EQUAL(get<0>(server.MatchDocument("cet"s, 0)), vector<string_view>{"cat"sv});
+    ASSERT_EQUAL(get<0>(server.MatchDocument(execution::par, "cet"s, 0)), 
+                 vector<string_view>{"cat"sv});
+    // minus words stay exact
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("cat -bet"s)), (vector<int>{0, 1}));
+    
+    server.SetFuzzyMatching({2, 0.5});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("hause"s)), (vector<int>{2, 3}));
+    server.AddDocument(5, "horse"s, DocumentStatus::ACTUAL, {6});
+    ASSERT_EQUAL(get_ids(server.FindTopDocuments("hause"s)), (vector<int>{2, 3, 5}));
+    {
+        const SearchServer copy{server};
+        ASSERT_EQUAL(get_ids(copy.FindTopDocuments("hause"s)), (vector<int>{2, 3, 5}));
+    }
+    
+    server.SetFuzzyMatching({});
+    ASSERT(server.FindTopDocuments("cet"s).empty());
+    ASSERT_EQUAL(server.GetMemoryUsage().fuzzy_index.bytes, 0u);
+    
+    ASSERT_EQUAL(ComputeBoundedEditDistance("kitten"sv, "sitting"sv, 2), 3);
+    ASSERT_EQUAL(ComputeBoundedEditDistance("kitten"sv, "sittin"sv, 2), 2);
+    ASSERT_EQUAL(ComputeBoundedEditDistance("abc"sv, "abc"sv, 2), 0);
+}
+
+void TestSnapshot() {
+    const auto get_ids = [](const vector<Document>& documents) {
+        vector<int> ids;
+        for (const Document& document : documents) {
+            ids.push_back(document.id);
+        }
+        sort(ids.begin(), ids.end());
+        return ids;
+    };
+    
+    auto original = make_unique<SearchServer>("the"s);
+    original->SetStatusPartitioning(true);
+    original->AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    original->AddDocument(2, "black cat"s, DocumentStatus::ACTUAL, {2});
+    original->AddDocument(3, "the white dog"s, DocumentStatus::ACTUAL, {3});
+    const size_t index_bytes = original->GetMemoryUsage().GetTotal().bytes;
+    
+    // the snapshot shares the index, it allocates nothing up front
+    SearchServer snapshot{*original};
+    ASSERT_EQUAL(snapshot.GetMemoryUsage().GetTotal().bytes, index_bytes);
+    ASSERT_EQUAL(original->GetMemoryUsage().GetTotal().bytes, index_bytes);
+    
+    snapshot.RemoveDocument(1);
+    ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("white"s)), vector<int>{3});
+    ASSERT_EQUAL(get_ids(original->FindTopDocuments("white"s)), (vector<int>{1, 3}));
+    ASSERT_EQUAL(original->GetDocumentCount(), 3);
+    
+    // new words stay on the side which added them
+    snapshot.AddDocument(4, "red fox"s, DocumentStatus::ACTUAL, {4});
+    original->AddDocument(5, "grey fox"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("fox"s)), vector<int>{4});
+    ASSERT_EQUAL(get_ids(original->FindTopDocuments("fox"s)), vector<int>{5});
+    ASSERT(snapshot.FindTopDocuments("grey"s).empty());
+    ASSERT(original->FindTopDocuments("red"s).empty());
+    
+    snapshot.SetDocumentStatus(2, DocumentStatus::BANNED);
+    ASSERT(snapshot.FindTopDocuments("black"s).empty());
+    ASSERT_EQUAL(get_ids(original->FindTopDocuments("black"s)), vector<int>{2});
+    
+    SearchServer nested{snapshot};
+    nested.RemoveDocument(execution::par, 3);
+    ASSERT(nested.FindTopDocuments("dog"s).empty());
+    ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("dog"s)), vector<int>{3});
+    
+    // the views of the snapshot outlive the original
+    original.reset();
+    const auto [matched_words, status] = snapshot.MatchDocument("white dog fox"s, 3);
+    ASSERT_EQUAL(matched_words, (vector<string_view>{"dog"sv, "white"sv}));
+    snapshot.AddDocument(6, "grey cat"s, DocumentStatus::ACTUAL, {6});
+    ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("grey"s)), vector<int>{6});
+    ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("cat"s, DocumentStatus::BANNED)), 
+                 vector<int>{2});
+    ASSERT_EQUAL(snapshot.GetDocumentCount(), 4);
+    ASSERT_EQUAL(nested.GetDocumentCount(), 2);
+    
+    // a copy to a resource shares nothing
+    AccountingResource resource;
+    {
+        SearchServer copy{snapshot, &resource};
+        ASSERT_EQUAL(resource.GetUsage().bytes, copy.GetMemoryUsage().GetTotal().bytes);
+        copy.RemoveDocument(6);
+        ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments("grey"s)), vector<int>{6});
+    }
+    ASSERT_EQUAL(resource.GetUsage().bytes, 0u);
+    
+    // the words added next to short-lived snapshots stay valid in the
+    // snapshots kept and in the server
+    vector<SearchServer> kept;
+    for (int document_id = 10; document_id < 40; ++document_id) {
+        SearchServer short_lived{snapshot};
+        if (document_id % 10 == 0) {
+            kept.push_back(short_lived);
+        }
+        snapshot.AddDocument(document_id, "word"s + to_string(document_id), 
+                             DocumentStatus::ACTUAL, {1});
+    }
+    for (int document_id = 10; document_id < 40; ++document_id) {
+        const string word = "word"s + to_string(document_id);
+        ASSERT_EQUAL(get_ids(snapshot.FindTopDocuments(word)), vector<int>{document_id});
+        ASSERT_EQUAL(get<0>(snapshot.MatchDocument(word, document_id)),
+                     vector<string_view>{word});
+    }
+    ASSERT_EQUAL(get_ids(kept.back().FindTopDocuments("word29"s)), vector<int>{29});
+    ASSERT(kept.back().FindTopDocuments("word30"s).empty());
+    
+    // an assignment replaces the index, the old one is released
+    AccountingResource assigned_resource;
+    SearchServer assigned{"the"s, &assigned_resource};
+    assigned.AddDocument(100, "old index"s, DocumentStatus::ACTUAL, {1});
+    assigned = kept.front();
+    ASSERT_EQUAL(assigned_resource.GetUsage().bytes, 0u);
+    ASSERT_EQUAL(assigned.GetDocumentCount(), kept.front().GetDocumentCount());
+    ASSERT(assigned.FindTopDocuments("old"s).empty());
+    assigned.AddDocument(100, "new index"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(kept.front().FindTopDocuments("new"s).empty());
+    
+    SearchServer moved{move(assigned)};
+    ASSERT_EQUAL(get_ids(moved.FindTopDocuments("new"s)), vector<int>{100});
+    assigned = move(moved);
+    ASSERT_EQUAL(get_ids(assigned.FindTopDocuments("new"s)), vector<int>{100});
+    assigned = assigned;
+    ASSERT_EQUAL(assigned.GetDocumentCount(), kept.front().GetDocumentCount() + 1);
+}
+
+void TestSnapshotLatencyStats() {
+    SearchServer server("the"s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.SetLatencyStats(true);
+    server.FindTopDocuments("cat"s);
+    
+    // the snapshot shares the histograms instead of copying them
+    const size_t warm_allocation_count = allocation_count;
+    SearchServer snapshot{server};
+    ASSERT(allocation_count - warm_allocation_count < 4u);
+    ASSERT(snapshot.IsLatencyStatsEnabled());
+    
+    snapshot.FindTopDocuments("cat"s);
+    server.FindTopDocuments("white"s);
+    const auto count = [](const SearchServer& server) {
+        return server.GetLatencyStats().at(SearchOperation::FIND_TOP_DOCUMENTS_SEQ).count;
+    };
+    ASSERT_EQUAL(count(server), 3u);
+    ASSERT_EQUAL(count(snapshot), 3u);
+    
+    // disabling drops the histograms of one server only
+    snapshot.SetLatencyStats(false);
+    server.FindTopDocuments("cat"s);
+    ASSERT(snapshot.GetLatencyStats().empty());
+    ASSERT_EQUAL(count(server), 4u);
+}
+
+void TestFindTopDocumentsAsync() {
+    const SearchServer server = GetSearchServer();
+
+    const auto expected = server.FindTopDocuments("cat"s);
+    const auto found_docs = SyncWait(server.FindTopDocumentsAsync("cat"s));
+
+    ASSERT_EQUAL(found_docs.size(), expected.size());
+    for (size_t i = 0; i < found_docs.size(); ++i) {
+        ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+    }
+
+    const auto even_docs = SyncWait(server.FindTopDocumentsAsync(
+            "cat"s, [](int document_id, DocumentStatus, int) {
+                return document_id % 2 == 0;
+            }));
+    ASSERT_EQUAL(even_docs.size(), 2u);
+    ASSERT_EQUAL(even_docs[0].id, 10);
+}
+
+void TestMatchDocumentAsync() {
+    SearchServer server(""s);
+    server.AddDocument(1, "cat in the city. cat is full and happy"s, DocumentStatus::BANNED,
+                       {1});
+
+    const auto [matched_words, status] = SyncWait(server.MatchDocumentAsync("happy cat"s, 1));
+
+    ASSERT_EQUAL(matched_words, (vector<string_view>{"cat"sv, "happy"sv}));
+    ASSERT(status == DocumentStatus::BANNED);
+
+    bool is_thrown = false;
+    try {
+        SyncWait(server.MatchDocumentAsync("cat"s, 2));
+    } catch (const out_of_range &) {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+}
+
+void TestAsyncSearchCancellation() {
+    const SearchServer server = GetSearchServer();
+
+    {
+        stop_source source;
+        source.request_stop();
+        bool is_cancelled = false;
+        try {
+            SyncWait(server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL,
+                                                  source.get_token()));
+        } catch (const OperationCancelled &) {
+            is_cancelled = true;
+        }
+        ASSERT(is_cancelled);
+    }
+
+    {
+        // the request is abandoned while the first word is being scored
+        stop_source source;
+        int predicate_calls = 0;
+        bool is_cancelled = false;
+        try {
+            SyncWait(server.FindTopDocumentsAsync(
+                    "cat dog"s,
+                    [&source, &predicate_calls](int, DocumentStatus, int) {
+                        ++predicate_calls;
+                        source.request_stop();
+                        return true;
+                    },
+                    source.get_token()));
+        } catch (const OperationCancelled &) {
+            is_cancelled = true;
+        }
+        ASSERT(is_cancelled);
+        ASSERT(predicate_calls < 6);
+    }
+}
+
 void TestAll() {
     TestRunner tr;
 
@@ -621,11 +2525,69 @@ void TestAll() {
     RUN_TEST(tr, TestPaginator);
 
     RUN_TEST(tr, TestRequestQueue);
+    RUN_TEST(tr, TestRequestStatisticsWindow);
+    RUN_TEST(tr, TestConcurrentRequestQueue);
 
     RUN_TEST(tr, TestRemoveDuplicates);
+    RUN_TEST(tr, TestFindDuplicates);
+    RUN_TEST(tr, TestDuplicateDetectionOnAdd);
+    RUN_TEST(tr, TestFindNearDuplicates);
 
     RUN_TEST(tr, TestProcessQueries);
     RUN_TEST(tr, TestProcessQueriesJoined);
+
+    RUN_TEST(tr, TestLatencyHistogram);
+    RUN_TEST(tr, TestSearchServerLatencyStats);
+    RUN_TEST(tr, TestQueryTracerChromeExport);
+    RUN_TEST(tr, TestMemoryUsage);
+    RUN_TEST(tr, TestCopyOwnsWords);
+    RUN_TEST(tr, TestCustomMemoryResource);
+    RUN_TEST(tr, TestQueryContextDoesNotAllocate);
+    RUN_TEST(tr, TestNothrowApi);
+    RUN_TEST(tr, TestPhraseQuery);
+    RUN_TEST(tr, TestPrefixQuery);
+    RUN_TEST(tr, TestFuzzyMatching);
+    RUN_TEST(tr, TestScorer);
+    RUN_TEST(tr, TestStatusPartitions);
+    RUN_TEST(tr, TestDocumentFilter);
+    RUN_TEST(tr, TestDocumentColumnsRemoval);
+    RUN_TEST(tr, TestScoringModes);
+    RUN_TEST(tr, TestTermCounts);
+    RUN_TEST(tr, TestMatchModes);
+    RUN_TEST(tr, TestBooleanQueryAndOr);
+    RUN_TEST(tr, TestBooleanQueryPrecedence);
+    RUN_TEST(tr, TestBooleanQueryExclusion);
+    RUN_TEST(tr, TestBooleanQueryOptionalWords);
+    RUN_TEST(tr, TestBooleanQueryMatchModeAll);
+    RUN_TEST(tr, TestBooleanQueryMatchDocument);
+    RUN_TEST(tr, TestBooleanQueryParsingErrors);
+    RUN_TEST(tr, TestBooleanQueryParsingExceptions);
+    RUN_TEST(tr, TestBooleanQueryNestingDepth);
+    RUN_TEST(tr, TestBooleanQueryNegationDepth);
+    RUN_TEST(tr, TestBooleanQueryPlainSyntax);
+    RUN_TEST(tr, TestBooleanQueryParenthesizedPlainQuery);
+    RUN_TEST(tr, TestDocumentsPageWholeRanking);
+    RUN_TEST(tr, TestDocumentsPageNumbered);
+    RUN_TEST(tr, TestDocumentsPageCursorRoundTrip);
+    RUN_TEST(tr, TestDocumentsPagePastTheEnd);
+    RUN_TEST(tr, TestDocumentsPageWithPredicate);
+    RUN_TEST(tr, TestDocumentsPageZeroSize);
+    RUN_TEST(tr, TestSearchCursorFromInvalidString);
+    RUN_TEST(tr, TestDocumentsPageExactRelevances);
+    RUN_TEST(tr, TestDocumentRangeMatchesRanking);
+    RUN_TEST(tr, TestDocumentRangeMatchModeAll);
+    RUN_TEST(tr, TestDocumentRangeBooleanQuery);
+    RUN_TEST(tr, TestDocumentRangeFuzzyMatching);
+    RUN_TEST(tr, TestDocumentRangeStatusPartition);
+    RUN_TEST(tr, TestDocumentRangeEarlyBreak);
+    RUN_TEST(tr, TestDocumentRangeInvalidQuery);
+    RUN_TEST(tr, TestDocumentRangePhraseQuery);
+    RUN_TEST(tr, TestSnapshot);
+    RUN_TEST(tr, TestSnapshotLatencyStats);
+
+    RUN_TEST(tr, TestFindTopDocumentsAsync);
+    RUN_TEST(tr, TestMatchDocumentAsync);
+    RUN_TEST(tr, TestAsyncSearchCancellation);
 }
 
 int main() {